@@ -1,9 +1,55 @@
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+
 #include "c2048.h"
 
-int main()
+int main(int argc, char* argv[])
 {
-	c2048 game;
-	game.ConstructConsole(30, 30, 16, 16);
+	// Random games unless a seed is given with --seed
+	uint64_t nSeed = ((uint64_t)random_device()() << 32) ^ (uint64_t)chrono::steady_clock::now().time_since_epoch().count();
+
+	// Weights for the n-tuple AI, written by train2048
+	string sWeightsFile = "ntuple.weights";
+
+	// Weights for the expectimax heuristic, written by tune2048
+	string sHeuristicFile = "heuristic.weights";
+
+	// Games are only recorded if a replay file is given with --record
+	string sReplayFile;
+
+	// Frames per second, --fps 0 runs them as fast as possible
+	float fFrameRate = 60.0f;
+
+	// --stats 1 prints what the frames cost on exit
+	bool bPrintStats = false;
+
+	for (int i = 1; i + 1 < argc; i++) {
+		if (string(argv[i]) == "--seed")
+			nSeed = strtoull(argv[i + 1], nullptr, 10);
+		else if (string(argv[i]) == "--weights")
+			sWeightsFile = argv[i + 1];
+		else if (string(argv[i]) == "--heuristic")
+			sHeuristicFile = argv[i + 1];
+		else if (string(argv[i]) == "--record")
+			sReplayFile = argv[i + 1];
+		else if (string(argv[i]) == "--fps")
+			fFrameRate = strtof(argv[i + 1], nullptr);
+		else if (string(argv[i]) == "--stats")
+			bPrintStats = atoi(argv[i + 1]) != 0;
+	}
+
+	c2048 game(nSeed, sWeightsFile, sHeuristicFile, sReplayFile);
+	if (!game.ConstructConsole(30, 30, 16, 16))
+		return 1;
+	game.SetPrintStats(bPrintStats);
+
+	// The game updates in steps of one frame and slows down in the background
+	if (fFrameRate > 0.0f) {
+		game.SetFrameRate(fFrameRate, min(fFrameRate, 10.0f));
+		game.SetFixedTimestep(1.0f / fFrameRate);
+	}
 	game.Start();
 	return 0;
 }
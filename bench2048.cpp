@@ -0,0 +1,1320 @@
+/**
+ * Micro benchmarks for the headless game logic
+ *
+ * Usage: bench2048 <benchmark> [--seed N] [--boards N] [--rounds N]
+ *                  [--threads N] [--depth N] [--searches N] [--replay FILE]
+ *                  [--budget MS] [--animation MS]
+ *
+ * Benchmarks:
+ *   simd      moves batches of boards with every cBoardSimd path
+ *   sizes     plays random games on 3x3 to 6x6 boards with cBoardN
+ *   parallel  expectimax speedup from 1 to --threads threads
+ *   symmetry  canonical boards: speed, and how many positions of random
+ *             games (or of --replay) and searches they save
+ *   heuristic evaluations/sec of cHeuristic, full and incremental, and
+ *             the time to change its weights
+ *   sliced    cTimeSlicedSearch with --budget ms per frame against the
+ *             blocking search
+ *   hint      plays --searches moves with cHintWorker and --animation ms
+ *             per move, with and without prefetching the spawns
+ *   arena     builds explicit expectimax trees on 1 to --threads threads,
+ *             the nodes from new/delete against a cArena per thread
+ *   cells     logic passes over --boards boards stored as the game's old
+ *             36 byte cells, as exponent arrays and as bitboards, with
+ *             cache misses where perf events are available
+ *   terminal  presents the frames of --boards moves of a random game on
+ *             cTerminal, only the changed cells against full redraws:
+ *             bytes per frame and the time to encode and write them
+ *   dirty     an app which draws only what changes on screens up to
+ *             320x120, presented from the whole screen and from the
+ *             dirty rectangles of its draws
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+using namespace std;
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "cArena.h"
+#include "cBoard.h"
+#include "cBoardN.h"
+#include "cBoardSimd.h"
+#include "cDirtyRects.h"
+#include "cExpectimax.h"
+#include "cHeuristic.h"
+#include "cHintWorker.h"
+#include "cRandom.h"
+#include "cReplay.h"
+#include "cTerminal.h"
+#include "cTimeSlicedSearch.h"
+
+struct sBenchOptions {
+	uint64_t nSeed = 1;
+	int nBoards = 4096;
+	int nRounds = 200;
+	int nThreads = 0;
+	int nDepth = 4;
+	int nSearches = 20;
+	string sReplayFile;
+	float fBudgetMs = 2.0f;
+	float fAnimationMs = 100.0f;
+};
+
+/**
+ * Plays random games until nCount positions are collected, so the
+ * benchmarks work on boards that look like real games
+ */
+static vector<board_t> CreatePositions(uint64_t nSeed, int nCount)
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	cRandom rng(nSeed);
+	vector<board_t> aBoards;
+	aBoards.reserve(nCount);
+
+	board_t nBoard = 0;
+	while ((int)aBoards.size() < nCount) {
+		int nEmpty = cBoard::CountEmpty(nBoard);
+		nBoard = cBoard::AddTile(nBoard, (int)rng.NextBelow(nEmpty), rng.NextBelow(10) == 0 ? 2 : 1);
+		aBoards.push_back(nBoard);
+
+		if (!cBoard::CanMove(nBoard)) {
+			nBoard = 0;
+			continue;
+		}
+
+		// Keep trying random directions, at least one of them is legal
+		board_t nMoved = nBoard;
+		while (nMoved == nBoard)
+			nMoved = cBoard::Move(nBoard, aDirections[rng.NextBelow(4)]);
+		nBoard = nMoved;
+	}
+
+	return aBoards;
+}
+
+static void BenchSimd(const sBenchOptions& options)
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+	static const int aBatchSizes[3] = { 4, 16, cBoardSimd::MAX_BOARDS };
+
+	vector<board_t> aBoards = CreatePositions(options.nSeed, options.nBoards);
+	vector<board_t> aResults(aBoards.size());
+	vector<int> aScores(aBoards.size());
+
+	// The scalar reference, one board at a time
+	{
+		uint64_t nCheck = 0;
+		auto tp1 = chrono::steady_clock::now();
+
+		for (int r = 0; r < options.nRounds; r++) {
+			ROTATION nDir = aDirections[r & 3];
+			for (size_t i = 0; i < aBoards.size(); i++) {
+				aResults[i] = cBoard::Move(aBoards[i], nDir, aScores[i]);
+				nCheck += aResults[i] + aScores[i];
+			}
+		}
+
+		auto tp2 = chrono::steady_clock::now();
+		double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+		printf("%-8s %5s  %12.0f boards/sec  (check %016llx)\n", "single", "1",
+			(double)aBoards.size() * options.nRounds / fSeconds, (unsigned long long)nCheck);
+	}
+
+	cBoardSimd::PATH nBest = cBoardSimd::GetBestPath();
+	for (int p = cBoardSimd::PATH_SCALAR; p <= nBest; p++) {
+		cBoardSimd::SetPath((cBoardSimd::PATH)p);
+
+		for (int nBatchSize : aBatchSizes) {
+			uint64_t nCheck = 0;
+			auto tp1 = chrono::steady_clock::now();
+
+			for (int r = 0; r < options.nRounds; r++) {
+				ROTATION nDir = aDirections[r & 3];
+				for (size_t i = 0; i + nBatchSize <= aBoards.size(); i += nBatchSize) {
+					uint32_t nMoved = cBoardSimd::Move(&aBoards[i], &aResults[i], &aScores[i], nBatchSize, nDir);
+					nCheck += nMoved;
+				}
+				nCheck += aResults[r % aResults.size()] + aScores[r % aScores.size()];
+			}
+
+			auto tp2 = chrono::steady_clock::now();
+			double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+			long long nMovedBoards = (long long)(aBoards.size() / nBatchSize * nBatchSize) * options.nRounds;
+			printf("%-8s %5d  %12.0f boards/sec  (check %016llx)\n", cBoardSimd::GetPathName((cBoardSimd::PATH)p),
+				nBatchSize, nMovedBoards / fSeconds, (unsigned long long)nCheck);
+		}
+	}
+
+	cBoardSimd::SetPath(nBest);
+}
+
+/**
+ * Plays random games on a W x H board, --boards is the number of games
+ */
+template<int W, int H>
+static void BenchSize(const sBenchOptions& options)
+{
+	typedef cBoardN<W, H> board;
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	board::InitTables();
+	cRandom rng(options.nSeed);
+
+	long long nMoves = 0, nScore = 0;
+	int aMaxTile[16] = { 0 };
+	auto tp1 = chrono::steady_clock::now();
+
+	for (int nGame = 0; nGame < options.nBoards; nGame++) {
+		typename board::bits_t nBoard = board::Empty();
+		nBoard = board::AddTile(nBoard, (int)rng.NextBelow(board::CountEmpty(nBoard)), 1);
+
+		while (true) {
+			int nEmpty = board::CountEmpty(nBoard);
+			if (nEmpty > 0)
+				nBoard = board::AddTile(nBoard, (int)rng.NextBelow(nEmpty), rng.NextBelow(10) == 0 ? 2 : 1);
+
+			// Try the moves in order, starting with a random one
+			uint64_t nFirst = rng.Next();
+			bool bMoved = false;
+			for (int k = 0; k < 4 && !bMoved; k++) {
+				int nMoveScore = 0;
+				typename board::bits_t nMoved = board::Move(nBoard, aDirections[(nFirst + k) & 3], nMoveScore);
+				if (nMoved != nBoard) {
+					nBoard = nMoved;
+					nScore += nMoveScore;
+					bMoved = true;
+				}
+			}
+
+			if (!bMoved)
+				break;
+			nMoves++;
+		}
+
+		aMaxTile[board::GetMaxExponent(nBoard)]++;
+	}
+
+	auto tp2 = chrono::steady_clock::now();
+	double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+
+	int nBest = 0;
+	for (int i = 0; i < 16; i++) {
+		if (aMaxTile[i] > 0)
+			nBest = i;
+	}
+
+	printf("%dx%d  %2d bytes  %12.0f moves/sec  avg moves %8.1f  avg score %9.1f  best tile %d\n",
+		W, H, (int)sizeof(typename board::bits_t), nMoves / fSeconds,
+		(double)nMoves / options.nBoards, (double)nScore / options.nBoards, 1 << nBest);
+}
+
+static void BenchSizes(const sBenchOptions& options)
+{
+	BenchSize<3, 3>(options);
+	BenchSize<4, 4>(options);
+	BenchSize<5, 5>(options);
+	BenchSize<6, 6>(options);
+}
+
+/**
+ * Searches the same positions with 1, 2, 4, ... threads. Every thread
+ * count starts with an empty transposition table.
+ */
+static void BenchParallel(const sBenchOptions& options)
+{
+	int nMaxThreads = options.nThreads > 0 ? options.nThreads : max(1, (int)thread::hardware_concurrency());
+
+	// Positions from the middle of random games have the most spawns
+	vector<board_t> aAll = CreatePositions(options.nSeed, options.nSearches * 64);
+	vector<board_t> aBoards;
+	for (size_t i = 32; i < aAll.size(); i += 64) {
+		if (cBoard::CanMove(aAll[i]))
+			aBoards.push_back(aAll[i]);
+	}
+
+	vector<int> aThreadCounts;
+	for (int n = 1; n < nMaxThreads; n *= 2)
+		aThreadCounts.push_back(n);
+	aThreadCounts.push_back(nMaxThreads);
+
+	printf("depth %d, %d positions, %u cores\n\n", options.nDepth, (int)aBoards.size(), thread::hardware_concurrency());
+	printf("threads      time   nodes/sec   speedup  efficiency   tasks  steals  same move\n");
+
+	vector<ROTATION> aReference;
+	double fReferenceSeconds = 0.0;
+
+	for (int nThreads : aThreadCounts) {
+		cExpectimax search(options.nDepth, 0.0001f, 64);
+		search.SetThreadCount(nThreads);
+
+		vector<ROTATION> aMoves;
+		auto tp1 = chrono::steady_clock::now();
+
+		for (board_t nBoard : aBoards) {
+			ROTATION nMove = LEFT;
+			search.ChooseMove(nBoard, nMove);
+			aMoves.push_back(nMove);
+		}
+
+		auto tp2 = chrono::steady_clock::now();
+		double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+
+		if (aReference.empty()) {
+			aReference = aMoves;
+			fReferenceSeconds = fSeconds;
+		}
+
+		// Threads may find deeper results in the table first, which can
+		// change a close decision
+		int nSame = 0;
+		for (size_t i = 0; i < aMoves.size(); i++)
+			nSame += aMoves[i] == aReference[i];
+
+		const sSearchStats& stats = search.GetStats();
+		printf("%7d  %7.3f s  %10.0f  %7.2fx  %9.1f %%  %6lld  %6lld  %4d/%d\n", nThreads, fSeconds, stats.nNodes / fSeconds,
+			fReferenceSeconds / fSeconds, 100.0 * fReferenceSeconds / fSeconds / nThreads,
+			stats.tasks.nTasks, stats.tasks.nSteals, nSame, (int)aMoves.size());
+	}
+}
+
+/**
+ * Every position of every game in a replay file
+ */
+static vector<board_t> ReadReplayPositions(const char* sFileName)
+{
+	vector<board_t> aBoards;
+	cReplayReader reader;
+	if (!reader.Open(sFileName))
+		return aBoards;
+
+	sReplayBlock block;
+	sReplayMove move;
+	while (reader.NextBlock(block)) {
+		aBoards.push_back(block.nBoard);
+		while (reader.NextMove(move))
+			aBoards.push_back(move.nBoard);
+	}
+
+	return aBoards;
+}
+
+static void BenchSymmetry(const sBenchOptions& options)
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	vector<board_t> aBoards = options.sReplayFile.empty()
+		? CreatePositions(options.nSeed, options.nBoards) : ReadReplayPositions(options.sReplayFile.c_str());
+	if (aBoards.empty()) {
+		printf("no positions in %s\n", options.sReplayFile.c_str());
+		return;
+	}
+
+	// Every symmetry has to map back, have the same canonical board
+	// and move the same way
+	long long nErrors = 0;
+	for (board_t nBoard : aBoards) {
+		board_t nCanonical = cBoard::Canonicalize(nBoard);
+		for (int s = 0; s < cBoard::SYMMETRY_COUNT; s++) {
+			board_t nSymmetric = cBoard::ApplySymmetry(nBoard, s);
+			nErrors += cBoard::Canonicalize(nSymmetric) != nCanonical;
+			nErrors += cBoard::ApplySymmetry(nSymmetric, cBoard::InvertSymmetry(s)) != nBoard;
+
+			for (ROTATION nDir : aDirections) {
+				board_t nMoved = cBoard::Move(nSymmetric, cBoard::ApplySymmetry(nDir, s));
+				nErrors += nMoved != cBoard::ApplySymmetry(cBoard::Move(nBoard, nDir), s);
+			}
+		}
+	}
+
+	uint64_t nCheck = 0;
+	auto tp1 = chrono::steady_clock::now();
+	for (int r = 0; r < options.nRounds; r++) {
+		for (board_t nBoard : aBoards)
+			nCheck += cBoard::Canonicalize(nBoard ^ (board_t)r);
+	}
+	auto tp2 = chrono::steady_clock::now();
+	double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+
+	unordered_set<board_t> boards(aBoards.begin(), aBoards.end());
+	unordered_set<board_t> canonical;
+	for (board_t nBoard : boards)
+		canonical.insert(cBoard::Canonicalize(nBoard));
+
+	printf("positions        %zu from %s\n", aBoards.size(), options.sReplayFile.empty() ? "random games" : options.sReplayFile.c_str());
+	printf("errors           %lld\n", nErrors);
+	printf("canonical/sec    %.0f  (check %016llx)\n", (double)aBoards.size() * options.nRounds / fSeconds, (unsigned long long)nCheck);
+	printf("distinct boards  %zu\n", boards.size());
+	printf("distinct canon.  %zu  (%.2fx fewer)\n", canonical.size(), (double)boards.size() / canonical.size());
+
+	// Table memory for one entry per distinct position
+	size_t nEntrySize = 16;
+	printf("table memory     %.1f MB -> %.1f MB\n\n", boards.size() * nEntrySize / 1048576.0, canonical.size() * nEntrySize / 1048576.0);
+
+	// The same searches with and without the canonical table
+	printf("search    time       nodes  tt hit rate   tt stores\n");
+	for (int nSymmetric = 0; nSymmetric < 2; nSymmetric++) {
+		cExpectimax search(options.nDepth, 0.0001f, 64);
+		search.SetSymmetricTable(nSymmetric != 0);
+
+		size_t nStep = max((size_t)1, aBoards.size() / options.nSearches);
+		auto tp3 = chrono::steady_clock::now();
+		for (size_t i = 0; i < aBoards.size(); i += nStep) {
+			ROTATION nMove;
+			search.ChooseMove(aBoards[i], nMove);
+		}
+		auto tp4 = chrono::steady_clock::now();
+
+		const sSearchStats& stats = search.GetStats();
+		printf("%-8s  %6.3f s  %10lld  %9.1f %%  %10lld\n", nSymmetric ? "canon." : "plain",
+			chrono::duration<double>(tp4 - tp3).count(), stats.nNodes, 100.0 * stats.HitRate(),
+			stats.table.nStores);
+	}
+}
+
+static void BenchHeuristic(const sBenchOptions& options)
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	vector<board_t> aBoards = CreatePositions(options.nSeed, options.nBoards);
+	cHeuristic heuristic;
+	long long nCount = (long long)aBoards.size() * options.nRounds;
+
+	vector<float> aScores(aBoards.size());
+	float fCheck = 0.0f;
+
+	auto tp1 = chrono::steady_clock::now();
+	for (int r = 0; r < options.nRounds; r++) {
+		for (size_t i = 0; i < aBoards.size(); i++)
+			fCheck += heuristic.Evaluate(aBoards[i] ^ (board_t)r);
+	}
+	auto tp2 = chrono::steady_clock::now();
+	printf("evaluate     %12.0f boards/sec\n", nCount / chrono::duration<double>(tp2 - tp1).count());
+
+	for (size_t i = 0; i < aBoards.size(); i++)
+		aScores[i] = heuristic.Evaluate(aBoards[i]);
+
+	// A move, then the score of every possible spawn from the moved board
+	long long nSpawns = 0;
+	float fMaxError = 0.0f;
+	tp1 = chrono::steady_clock::now();
+	for (int r = 0; r < options.nRounds; r++) {
+		ROTATION nDir = aDirections[r & 3];
+		for (size_t i = 0; i < aBoards.size(); i++) {
+			board_t nMoved = cBoard::Move(aBoards[i], nDir);
+			float fMoved = heuristic.Update(aScores[i], aBoards[i], nMoved);
+
+			uint32_t nEmptyMask = cBoard::GetEmptyMask(nMoved);
+			for (uint32_t m = nEmptyMask; m != 0; m &= m - 1) {
+				fCheck += heuristic.AddTile(fMoved, nMoved, cBoard::LowestBit(m), 1);
+				nSpawns++;
+			}
+
+			if (r == 0)
+				fMaxError = max(fMaxError, fabsf(fMoved - heuristic.Evaluate(nMoved)));
+		}
+	}
+	tp2 = chrono::steady_clock::now();
+	printf("incremental  %12.0f boards/sec  (max error %.3f)\n",
+		(nCount + nSpawns) / chrono::duration<double>(tp2 - tp1).count(), fMaxError);
+
+	sHeuristicWeights weights = heuristic.GetWeights();
+	weights.fEmptyWeight += 1.0f;
+	tp1 = chrono::steady_clock::now();
+	heuristic.SetWeights(weights);
+	tp2 = chrono::steady_clock::now();
+	weights.fSumPower += 0.1f;
+	heuristic.SetWeights(weights);
+	auto tp3 = chrono::steady_clock::now();
+
+	printf("new weights  %8.3f ms\n", chrono::duration<double>(tp2 - tp1).count() * 1000.0);
+	printf("new powers   %8.3f ms  (check %g)\n", chrono::duration<double>(tp3 - tp2).count() * 1000.0, fCheck);
+}
+
+/**
+ * Runs the time sliced search one frame at a time like the game does
+ */
+static void BenchSliced(const sBenchOptions& options)
+{
+	vector<board_t> aAll = CreatePositions(options.nSeed, options.nSearches * 64);
+	vector<board_t> aBoards;
+	for (size_t i = 32; i < aAll.size(); i += 64) {
+		if (cBoard::CanMove(aAll[i]))
+			aBoards.push_back(aAll[i]);
+	}
+
+	cExpectimax blocking(options.nDepth, 0.0001f, 64);
+	cTimeSlicedSearch sliced(options.nDepth, 0.0001f, 64);
+
+	double fLongestBlocking = 0.0, fLongestStep = 0.0, fStepSeconds = 0.0;
+	long long nFrames = 0, nFirstMoveFrames = 0;
+	int nSame = 0;
+
+	for (board_t nBoard : aBoards) {
+		ROTATION nBlockingMove = LEFT;
+		auto tp1 = chrono::steady_clock::now();
+		blocking.ChooseMove(nBoard, nBlockingMove);
+		auto tp2 = chrono::steady_clock::now();
+		fLongestBlocking = max(fLongestBlocking, chrono::duration<double>(tp2 - tp1).count());
+
+		sliced.Start(nBoard);
+		bool bDone = false;
+		while (!bDone) {
+			auto tp3 = chrono::steady_clock::now();
+			bDone = sliced.Step(options.fBudgetMs / 1000.0f);
+			auto tp4 = chrono::steady_clock::now();
+
+			double fSeconds = chrono::duration<double>(tp4 - tp3).count();
+			fLongestStep = max(fLongestStep, fSeconds);
+			fStepSeconds += fSeconds;
+			nFrames++;
+			nFirstMoveFrames += sliced.GetCompletedDepth() == 0;
+		}
+
+		ROTATION nSlicedMove = LEFT;
+		sliced.GetBestMove(nSlicedMove);
+		nSame += nSlicedMove == nBlockingMove;
+	}
+
+	printf("depth %d, %d positions, budget %.2f ms per frame\n\n", options.nDepth, (int)aBoards.size(), options.fBudgetMs);
+	printf("longest blocking search  %8.3f ms\n", fLongestBlocking * 1000.0);
+	printf("longest step             %8.3f ms\n", fLongestStep * 1000.0);
+	printf("average step             %8.3f ms\n", fStepSeconds * 1000.0 / max(1LL, nFrames));
+	printf("frames per search        %8.1f\n", (double)nFrames / aBoards.size());
+	printf("frames without a move    %8lld\n", nFirstMoveFrames);
+	printf("same move                %4d/%d\n", nSame, (int)aBoards.size());
+}
+
+/**
+ * Plays like the game on autoplay: the move animates while the worker
+ * searches, then the game waits for the result of the new board
+ */
+static void PlayWithWorker(const sBenchOptions& options, bool bPrefetch)
+{
+	cTimeSlicedSearch search(options.nDepth, 0.0001f, 64);
+	cHintWorker worker(search);
+	cRandom rng(options.nSeed);
+
+	auto Spawn = [&](board_t nBoard) {
+		return cBoard::AddTile(nBoard, (int)rng.NextBelow(cBoard::CountEmpty(nBoard)), rng.NextBelow(10) == 0 ? 2 : 1);
+	};
+
+	board_t nBoard = Spawn(Spawn(0));
+	worker.Search(nBoard);
+
+	double fWaitSeconds = 0.0, fLongestWait = 0.0;
+	auto tpStart = chrono::steady_clock::now();
+
+	for (int nMove = 0; nMove < options.nSearches; nMove++) {
+		sHintResult result;
+		auto tp1 = chrono::steady_clock::now();
+		while (!worker.GetResult(nBoard, result) || !result.bDone)
+			this_thread::sleep_for(chrono::microseconds(100));
+		auto tp2 = chrono::steady_clock::now();
+
+		double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+		fWaitSeconds += fSeconds;
+		fLongestWait = max(fLongestWait, fSeconds);
+
+		if (!result.bHasMove) {
+			nBoard = Spawn(Spawn(0));
+			worker.Search(nBoard);
+			continue;
+		}
+
+		board_t nMoved = cBoard::Move(nBoard, result.nMove);
+		if (bPrefetch)
+			worker.Prefetch(nMoved);
+
+		this_thread::sleep_for(chrono::duration<float, milli>(options.fAnimationMs));
+
+		nBoard = Spawn(nMoved);
+		worker.Search(nBoard);
+	}
+
+	double fTotal = chrono::duration<double>(chrono::steady_clock::now() - tpStart).count();
+	sHintWorkerStats stats = worker.GetStats();
+
+	printf("%-11s %8.2f %9.2f %10.2f %9lld %9lld %9lld\n", bPrefetch ? "prefetch" : "no prefetch",
+		fWaitSeconds * 1000.0 / options.nSearches, fLongestWait * 1000.0, options.nSearches / fTotal,
+		stats.nPrefetched, stats.nPrefetchHits, stats.nCancelled);
+}
+
+static void BenchHint(const sBenchOptions& options)
+{
+	printf("depth %d, %d moves, %.0f ms animation\n\n", options.nDepth, options.nSearches, options.fAnimationMs);
+	printf("%-11s %8s %9s %10s %9s %9s %9s\n", "", "wait ms", "worst ms", "moves/sec", "prefetched", "hits", "cancelled");
+
+	PlayWithWorker(options, false);
+	PlayWithWorker(options, true);
+}
+
+struct sTreeNode {
+	board_t nBoard;
+	float fValue;
+	int nChildren;
+	sTreeNode* pChildren;
+};
+
+// Tree nodes from the default allocator
+struct sHeapNodes {
+	long long nNodes = 0;
+
+	sTreeNode* Allocate(int nCount) { nNodes += nCount; return new sTreeNode[nCount]; }
+	void NextMove() {}
+
+	void Free(sTreeNode& node)
+	{
+		for (int i = 0; i < node.nChildren; i++)
+			Free(node.pChildren[i]);
+		delete[] node.pChildren;
+	}
+};
+
+// Tree nodes from an arena which is reset for every move
+struct sArenaNodes {
+	long long nNodes = 0;
+	cArena arena;
+
+	sTreeNode* Allocate(int nCount) { nNodes += nCount; return arena.Allocate<sTreeNode>(nCount); }
+	void NextMove() { arena.Reset(); }
+	void Free(sTreeNode&) {}
+};
+
+template <typename NODES>
+static float BuildSpawnNode(NODES& nodes, sTreeNode& node, int nDepth, float fProbability);
+
+/**
+ * A naive expectimax which keeps the whole tree instead of recursing
+ * over values, so every node is an allocation
+ */
+template <typename NODES>
+static float BuildMoveNode(NODES& nodes, sTreeNode& node, int nDepth, float fProbability)
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	board_t aMoved[4];
+	int nMoves = 0;
+	for (ROTATION nDir : aDirections) {
+		board_t nMoved = cBoard::Move(node.nBoard, nDir);
+		if (nMoved != node.nBoard)
+			aMoved[nMoves++] = nMoved;
+	}
+
+	node.nChildren = nMoves;
+	node.pChildren = nMoves > 0 ? nodes.Allocate(nMoves) : nullptr;
+	node.fValue = 0.0f;
+
+	for (int i = 0; i < nMoves; i++) {
+		node.pChildren[i].nBoard = aMoved[i];
+		node.fValue = max(node.fValue, BuildSpawnNode(nodes, node.pChildren[i], nDepth - 1, fProbability));
+	}
+
+	return node.fValue;
+}
+
+template <typename NODES>
+static float BuildSpawnNode(NODES& nodes, sTreeNode& node, int nDepth, float fProbability)
+{
+	node.nChildren = 0;
+	node.pChildren = nullptr;
+
+	if (nDepth <= 0 || fProbability < 0.0001f) {
+		node.fValue = cHeuristic::GetDefault().Evaluate(node.nBoard);
+		return node.fValue;
+	}
+
+	sSpawn aSpawns[cBoard::MAX_SPAWNS];
+	int nSpawns = cBoard::GetSpawns(node.nBoard, aSpawns);
+	if (nSpawns == 0)
+		return BuildMoveNode(nodes, node, nDepth, fProbability);
+
+	node.nChildren = nSpawns;
+	node.pChildren = nodes.Allocate(nSpawns);
+	node.fValue = 0.0f;
+
+	for (int i = 0; i < nSpawns; i++) {
+		node.pChildren[i].nBoard = aSpawns[i].nBoard;
+		node.fValue += aSpawns[i].fProbability * BuildMoveNode(nodes, node.pChildren[i], nDepth, fProbability * aSpawns[i].fProbability);
+	}
+
+	return node.fValue;
+}
+
+/**
+ * Every thread builds and frees the trees of its share of the positions
+ */
+template <typename NODES>
+static void BenchNodes(const char* sName, const vector<board_t>& aBoards, int nDepth, int nThreads, double& fReferenceSeconds)
+{
+	vector<NODES> aNodes(nThreads);
+	vector<double> aValues(nThreads, 0.0);
+	vector<thread> aThreads;
+
+	auto tp1 = chrono::steady_clock::now();
+
+	for (int t = 0; t < nThreads; t++) {
+		aThreads.push_back(thread([&, t] {
+			for (size_t i = t; i < aBoards.size(); i += nThreads) {
+				aNodes[t].NextMove();
+
+				sTreeNode root;
+				root.nBoard = aBoards[i];
+				aValues[t] += BuildMoveNode(aNodes[t], root, nDepth, 1.0f);
+				aNodes[t].Free(root);
+			}
+		}));
+	}
+
+	for (thread& t : aThreads)
+		t.join();
+
+	auto tp2 = chrono::steady_clock::now();
+	double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+	if (fReferenceSeconds == 0.0)
+		fReferenceSeconds = fSeconds;
+
+	long long nNodes = 0;
+	double fCheck = 0.0;
+	for (int t = 0; t < nThreads; t++) {
+		nNodes += aNodes[t].nNodes;
+		fCheck += aValues[t];
+	}
+
+	printf("%-6s %7d  %7.3f s  %10.0f  %7.2fx  (check %.6g)\n", sName, nThreads, fSeconds, nNodes / fSeconds,
+		fReferenceSeconds / fSeconds, fCheck);
+}
+
+static void BenchArena(const sBenchOptions& options)
+{
+	int nMaxThreads = options.nThreads > 0 ? options.nThreads : max(1, (int)thread::hardware_concurrency());
+
+	vector<board_t> aAll = CreatePositions(options.nSeed, options.nSearches * 64);
+	vector<board_t> aBoards;
+	for (size_t i = 32; i < aAll.size(); i += 64) {
+		if (cBoard::CanMove(aAll[i]))
+			aBoards.push_back(aAll[i]);
+	}
+
+	vector<int> aThreadCounts;
+	for (int n = 1; n < nMaxThreads; n *= 2)
+		aThreadCounts.push_back(n);
+	aThreadCounts.push_back(nMaxThreads);
+
+	printf("depth %d, %d positions, %u cores, %zu bytes per node\n\n", options.nDepth, (int)aBoards.size(),
+		thread::hardware_concurrency(), sizeof(sTreeNode));
+	printf("nodes  threads      time   nodes/sec   against new/delete on 1 thread\n");
+
+	double fReferenceSeconds = 0.0;
+	for (int nThreads : aThreadCounts) {
+		BenchNodes<sHeapNodes>("new", aBoards, options.nDepth, nThreads, fReferenceSeconds);
+		BenchNodes<sArenaNodes>("arena", aBoards, options.nDepth, nThreads, fReferenceSeconds);
+	}
+
+	// The arena of one thread after all its moves
+	sArenaNodes nodes;
+	for (board_t nBoard : aBoards) {
+		nodes.NextMove();
+		sTreeNode root;
+		root.nBoard = nBoard;
+		BuildMoveNode(nodes, root, options.nDepth, 1.0f);
+	}
+
+	sArenaStats stats = nodes.arena.GetStats();
+	printf("\narena: peak %.1f MB, %.1f MB in %lld blocks, %lld allocations, %lld resets\n",
+		stats.nPeakBytes / 1048576.0, stats.nReservedBytes / 1048576.0, stats.nBlocks, stats.nAllocations, stats.nResets);
+}
+
+// A cell of the game before its tile was split from its animation
+struct sFatCell {
+	int nValue;
+	int nPosX;
+	int nPosY;
+	int nDestinationCellIndex;
+	bool bNeedsAnimation;
+	float fAnimOffsetX;
+	float fAnimOffsetY;
+	bool bHasSpecialAnimation;
+	bool bHasBeenMerged;
+	float fAnimationTime;
+};
+
+/**
+ * Counts the L1 data and last level cache misses of this thread with
+ * perf events, where the kernel allows it
+ */
+class cMissCounter
+{
+public:
+	cMissCounter()
+	{
+#if defined(__linux__)
+		m_nL1 = Open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+		m_nLast = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+	}
+
+	~cMissCounter()
+	{
+#if defined(__linux__)
+		if (m_nL1 >= 0)
+			close(m_nL1);
+		if (m_nLast >= 0)
+			close(m_nLast);
+#endif
+	}
+
+	void Start()
+	{
+#if defined(__linux__)
+		for (int nCounter : { m_nL1, m_nLast }) {
+			if (nCounter >= 0) {
+				ioctl(nCounter, PERF_EVENT_IOC_RESET, 0);
+				ioctl(nCounter, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+#endif
+	}
+
+	// -1 for a counter which is not available
+	void Stop(long long& nL1Misses, long long& nLastMisses)
+	{
+		nL1Misses = Read(m_nL1);
+		nLastMisses = Read(m_nLast);
+	}
+
+private:
+#if defined(__linux__)
+	static int Open(uint32_t nType, uint64_t nConfig)
+	{
+		perf_event_attr attr = {};
+		attr.size = sizeof(attr);
+		attr.type = nType;
+		attr.config = nConfig;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+#endif
+
+	static long long Read(int nCounter)
+	{
+		long long nCount = -1;
+#if defined(__linux__)
+		if (nCounter >= 0) {
+			ioctl(nCounter, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(nCounter, &nCount, sizeof(nCount)) != sizeof(nCount))
+				nCount = -1;
+		}
+#endif
+		return nCount;
+	}
+
+private:
+	int m_nL1 = -1;
+	int m_nLast = -1;
+};
+
+/**
+ * Runs the same logic pass as the game's tiles need it (empty cells,
+ * biggest tile, sum of the tiles) over all boards of one layout
+ */
+template<typename PASS>
+static void BenchCellLayout(const char* sName, size_t nBytesPerBoard, size_t nBoards, int nRounds, PASS pass)
+{
+	cMissCounter counter;
+	long long nCheck = 0;
+
+	counter.Start();
+	auto tp1 = chrono::steady_clock::now();
+
+	for (int r = 0; r < nRounds; r++)
+		nCheck += pass();
+
+	auto tp2 = chrono::steady_clock::now();
+	long long nL1Misses, nLastMisses;
+	counter.Stop(nL1Misses, nLastMisses);
+
+	double fPasses = (double)nBoards * nRounds;
+	double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+	auto formatMisses = [fPasses](long long nMisses) {
+		char sText[32] = "n/a";
+		if (nMisses >= 0)
+			snprintf(sText, sizeof(sText), "%.3f", nMisses / fPasses);
+		return string(sText);
+	};
+
+	printf("%-10s %6zu %10.2f %11.3f %10.2f %14s %14s  (check %lld)\n", sName, nBytesPerBoard, nBoards * nBytesPerBoard / 1048576.0,
+		nBytesPerBoard / 64.0, fSeconds * 1e9 / fPasses, formatMisses(nL1Misses).c_str(), formatMisses(nLastMisses).c_str(), nCheck);
+}
+
+static void BenchCells(const sBenchOptions& options)
+{
+	static const int CELLS = 16;
+
+	vector<board_t> aBoards = CreatePositions(options.nSeed, options.nBoards);
+	size_t nBoards = aBoards.size();
+
+	vector<sFatCell> aFatCells(nBoards * CELLS);
+	vector<uint8_t> aExponents(nBoards * CELLS);
+	for (size_t b = 0; b < nBoards; b++) {
+		for (int i = 0; i < CELLS; i++) {
+			sFatCell& cell = aFatCells[b * CELLS + i];
+			cell = sFatCell();
+			cell.nValue = cBoard::GetValue(aBoards[b], i);
+			cell.nPosX = i % 4 * 6;
+			cell.nPosY = i / 4 * 6;
+			cell.nDestinationCellIndex = -1;
+			aExponents[b * CELLS + i] = (uint8_t)cBoard::GetExponent(aBoards[b], i);
+		}
+	}
+
+	// Lines are the 64 byte cache lines a pass reads per board, misses
+	// are only counted where the kernel allows perf events
+	printf("layout      bytes         MB lines/board   ns/board  L1 miss/board LLC miss/board\n");
+
+	BenchCellLayout("fat cells", sizeof(sFatCell) * CELLS, nBoards, options.nRounds, [&]() {
+		long long nCheck = 0;
+		for (size_t b = 0; b < nBoards; b++) {
+			const sFatCell* pCells = &aFatCells[b * CELLS];
+			int nEmpty = 0, nMax = 0;
+			for (int i = 0; i < CELLS; i++) {
+				nEmpty += pCells[i].nValue == 0;
+				nMax = max(nMax, pCells[i].nValue);
+			}
+			nCheck += nEmpty + nMax;
+		}
+		return nCheck;
+	});
+
+	BenchCellLayout("exponents", sizeof(uint8_t) * CELLS, nBoards, options.nRounds, [&]() {
+		long long nCheck = 0;
+		for (size_t b = 0; b < nBoards; b++) {
+			const uint8_t* pExponents = &aExponents[b * CELLS];
+			int nEmpty = 0, nMax = 0;
+			for (int i = 0; i < CELLS; i++) {
+				nEmpty += pExponents[i] == 0;
+				nMax = max(nMax, (int)pExponents[i]);
+			}
+			nCheck += nEmpty + (1 << nMax);
+		}
+		return nCheck;
+	});
+
+	BenchCellLayout("bitboard", sizeof(board_t), nBoards, options.nRounds, [&]() {
+		long long nCheck = 0;
+		for (size_t b = 0; b < nBoards; b++)
+			nCheck += cBoard::CountEmpty(aBoards[b]) + (1 << cBoard::GetMaxExponent(aBoards[b]));
+		return nCheck;
+	});
+}
+
+/**
+ * The game's screen, drawn the way c2048 draws it: a 30x30 console with
+ * the field of 5x5 tiles, their values and the score below
+ */
+class cBenchScreen
+{
+public:
+	static const int WIDTH = 30;
+	static const int HEIGHT = 30;
+	static const int TILE_SIZE = 5;
+	static const int FIELD_SIZE = (TILE_SIZE + 1) * 4 + 1;
+	static const int FIELD_OFFSET_X = WIDTH / 2 - FIELD_SIZE / 2;
+
+	cBenchScreen() : m_aCells(WIDTH * HEIGHT) {}
+
+	const sTerminalCell* GetCells() const { return m_aCells.data(); }
+
+	void Fill(int x1, int y1, int x2, int y2, wchar_t c, uint16_t nColour)
+	{
+		for (int y = max(0, y1); y < min(HEIGHT, y2); y++) {
+			for (int x = max(0, x1); x < min(WIDTH, x2); x++) {
+				m_aCells[y * WIDTH + x].Char.UnicodeChar = c;
+				m_aCells[y * WIDTH + x].Attributes = nColour;
+			}
+		}
+	}
+
+	void DrawString(int x, int y, const wstring& sText, uint16_t nColour)
+	{
+		for (size_t i = 0; i < sText.size(); i++)
+			Fill(x + (int)i, y, x + (int)i + 1, y + 1, sText[i], nColour);
+	}
+
+	// Empty field, and the score line below it
+	void DrawField(int nScore)
+	{
+		Fill(0, 0, WIDTH, HEIGHT, L' ', 0x00);
+		Fill(0, 0, WIDTH, FIELD_SIZE, 0x2588, 0x08);
+		for (int i = 0; i < 16; i++)
+			Fill(GetPosX(i), GetPosY(i), GetPosX(i) + TILE_SIZE, GetPosY(i) + TILE_SIZE, 0x2588, 0x00);
+		DrawString(1, FIELD_SIZE + 1, L"Score: " + to_wstring(nScore), 0x0F);
+	}
+
+	void DrawTile(int nCell, int nExponent, int nOffsetX, int nOffsetY)
+	{
+		// Foreground colours of the game's tiles from 2 to 2048
+		static const uint16_t aColours[12] = { 0x0, 0xE, 0x6, 0xC, 0x4, 0x9, 0x1, 0xA, 0x2, 0xB, 0x3, 0xF };
+
+		int x = GetPosX(nCell) + nOffsetX;
+		int y = GetPosY(nCell) + nOffsetY;
+		uint16_t nColour = aColours[min(nExponent, 11)];
+		Fill(x, y, x + TILE_SIZE, y + TILE_SIZE, 0x2588, nColour);
+
+		wstring sValue = to_wstring(1 << nExponent);
+		DrawString(x + TILE_SIZE / 2 - (int)sValue.size() / 2, y + TILE_SIZE / 2, sValue, (uint16_t)(nColour << 4));
+	}
+
+	void DrawBoard(board_t nBoard, int nScore)
+	{
+		DrawField(nScore);
+		for (int i = 0; i < 16; i++) {
+			if (cBoard::GetExponent(nBoard, i) > 0)
+				DrawTile(i, cBoard::GetExponent(nBoard, i), 0, 0);
+		}
+	}
+
+	// A frame of the slide, fProgress of the way from the cells of plan.nBoard
+	void DrawSlide(const sMovePlan& plan, float fProgress, int nScore)
+	{
+		DrawField(nScore);
+
+		uint32_t nMoving = 0;
+		for (int m = 0; m < plan.nCount; m++)
+			nMoving |= 1u << plan.aMoves[m].nFrom;
+
+		for (int i = 0; i < 16; i++) {
+			if (cBoard::GetExponent(plan.nBoard, i) > 0 && !(nMoving & (1u << i)))
+				DrawTile(i, cBoard::GetExponent(plan.nBoard, i), 0, 0);
+		}
+
+		for (int m = 0; m < plan.nCount; m++) {
+			const sTileMove& move = plan.aMoves[m];
+			int nOffsetX = (int)((GetPosX(move.nTo) - GetPosX(move.nFrom)) * fProgress);
+			int nOffsetY = (int)((GetPosY(move.nTo) - GetPosY(move.nFrom)) * fProgress);
+			DrawTile(move.nFrom, cBoard::GetExponent(plan.nBoard, move.nFrom), nOffsetX, nOffsetY);
+		}
+	}
+
+private:
+	static int GetPosX(int nCell) { return 1 + FIELD_OFFSET_X + nCell % 4 * (TILE_SIZE + 1); }
+	static int GetPosY(int nCell) { return 1 + nCell / 4 * (TILE_SIZE + 1); }
+
+	vector<sTerminalCell> m_aCells;
+};
+
+/**
+ * What the frames of one kind wrote, and how long they took
+ */
+struct sPresentStats {
+	long long nFrames = 0;
+	long long nBytes = 0;
+	size_t nMaxBytes = 0;
+	double fEncodeSeconds = 0.0;
+	double fWriteSeconds = 0.0;
+
+	void Print(const char* sFrames, const char* sMode) const
+	{
+		double fFrames = (double)max(1LL, nFrames);
+		printf("%-7s %-5s %8lld %12.1f %10zu %10.2f %10.2f %11.2f\n", sFrames, sMode, nFrames, nBytes / fFrames, nMaxBytes,
+			fEncodeSeconds * 1e6 / fFrames, fWriteSeconds * 1e6 / fFrames, (fEncodeSeconds + fWriteSeconds) * 1e6 / fFrames);
+	}
+};
+
+/**
+ * Idle frames are the same board again, like the game draws it while it
+ * waits for a key. A move slides the tiles in 8 frames and then shows
+ * the board with its new tile. The frames go to the null device, which
+ * is the cost of the syscall but not of a terminal drawing the bytes.
+ */
+static void BenchTerminal(const sBenchOptions& options)
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+	static const int SLIDE_FRAMES = 8;
+	static const int IDLE_FRAMES = 8;
+	enum { IDLE, MOVE };
+
+#if defined(_WIN32)
+	FILE* pOut = fopen("NUL", "wb");
+#else
+	FILE* pOut = fopen("/dev/null", "wb");
+#endif
+	if (pOut == nullptr) {
+		fprintf(stderr, "Could not open the null device\n");
+		return;
+	}
+	// Every frame is one write, like cTerminal::Present does it
+	setvbuf(pOut, nullptr, _IONBF, 0);
+
+	// Only the changed cells, and every cell
+	cTerminal aTerminals[2];
+	sPresentStats aStats[2][2];
+	string sFrame;
+	for (cTerminal& terminal : aTerminals)
+		terminal.SetSize(cBenchScreen::WIDTH, cBenchScreen::HEIGHT);
+
+	auto present = [&](int nKind, const cBenchScreen& screen) {
+		for (int nMode = 0; nMode < 2; nMode++) {
+			auto tp1 = chrono::steady_clock::now();
+			sFrame.clear();
+			aTerminals[nMode].Encode(screen.GetCells(), sFrame, nMode == 1);
+			auto tp2 = chrono::steady_clock::now();
+			if (!sFrame.empty())
+				fwrite(sFrame.data(), 1, sFrame.size(), pOut);
+			auto tp3 = chrono::steady_clock::now();
+
+			sPresentStats& stats = aStats[nKind][nMode];
+			stats.nFrames++;
+			stats.nBytes += sFrame.size();
+			stats.nMaxBytes = max(stats.nMaxBytes, sFrame.size());
+			stats.fEncodeSeconds += chrono::duration<double>(tp2 - tp1).count();
+			stats.fWriteSeconds += chrono::duration<double>(tp3 - tp2).count();
+		}
+	};
+
+	cBenchScreen screen;
+	cRandom rng(options.nSeed);
+	board_t nBoard = 0;
+	int nScore = 0;
+	int nMoves = 0;
+
+	while (nMoves < options.nBoards) {
+		if (nBoard == 0 || !cBoard::CanMove(nBoard)) {
+			nBoard = cBoard::AddTile(0, (int)rng.NextBelow(16), 1);
+			nScore = 0;
+		}
+
+		screen.DrawBoard(nBoard, nScore);
+		for (int f = 0; f < IDLE_FRAMES; f++)
+			present(IDLE, screen);
+
+		sMovePlan plan;
+		while (!cBoard::PlanMove(nBoard, aDirections[rng.NextBelow(4)], plan))
+			;
+
+		for (int f = 1; f <= SLIDE_FRAMES; f++) {
+			screen.DrawSlide(plan, (float)f / SLIDE_FRAMES, nScore);
+			present(MOVE, screen);
+		}
+
+		nScore += plan.nScore;
+		nBoard = cBoard::AddTile(plan.nResult, (int)rng.NextBelow(cBoard::CountEmpty(plan.nResult)), rng.NextBelow(10) == 0 ? 2 : 1);
+		nMoves++;
+	}
+
+	fclose(pOut);
+
+	printf("%dx%d screen, %d moves\n\n", cBenchScreen::WIDTH, cBenchScreen::HEIGHT, nMoves);
+	printf("frames  mode    frames  bytes/frame  max bytes  encode us   write us  present us\n");
+	aStats[IDLE][0].Print("idle", "diff");
+	aStats[IDLE][1].Print("idle", "full");
+	aStats[MOVE][0].Print("move", "diff");
+	aStats[MOVE][1].Print("move", "full");
+}
+
+/**
+ * A screen of any size which marks what is drawn, like the console engine
+ */
+class cBenchCanvas
+{
+public:
+	cBenchCanvas(int nWidth, int nHeight) : m_nWidth(nWidth), m_nHeight(nHeight), m_aCells(nWidth * nHeight)
+	{
+		dirty.SetSize(nWidth, nHeight);
+	}
+
+	const sTerminalCell* GetCells() const { return m_aCells.data(); }
+	sTerminalCell* GetCells() { return m_aCells.data(); }
+
+	void Fill(int x1, int y1, int x2, int y2, wchar_t c, uint16_t nColour)
+	{
+		dirty.Add(x1, y1, x2, y2);
+		for (int y = max(0, y1); y < min(m_nHeight, y2); y++) {
+			for (int x = max(0, x1); x < min(m_nWidth, x2); x++) {
+				m_aCells[y * m_nWidth + x].Char.UnicodeChar = c;
+				m_aCells[y * m_nWidth + x].Attributes = nColour;
+			}
+		}
+	}
+
+	void DrawString(int x, int y, const wstring& sText, uint16_t nColour)
+	{
+		for (size_t i = 0; i < sText.size(); i++)
+			Fill(x + (int)i, y, x + (int)i + 1, y + 1, sText[i], nColour);
+	}
+
+	cDirtyRects dirty;
+
+private:
+	int m_nWidth;
+	int m_nHeight;
+	vector<sTerminalCell> m_aCells;
+};
+
+/**
+ * The app draws its background once, and then every frame moves a
+ * sprite by one cell, counts the frames in the corner and blinks a line
+ * of text. "screen" diffs the whole screen against the last frame,
+ * "dirty" only the rectangles which were drawn to. Cells is what a
+ * presenter looks at, written what it would give WriteConsoleOutput.
+ */
+static void BenchDirty(const sBenchOptions& options)
+{
+	static const int SIZES[3][2] = { { 30, 30 }, { 160, 60 }, { 320, 120 } };
+	int nFrames = max(1, options.nRounds) * 10;
+
+	printf("%d frames\n\n", nFrames);
+	printf("screen   mode      cells/frame  written/frame  rects/frame  bytes/frame  present us\n");
+
+	for (const auto& size : SIZES) {
+		int nWidth = size[0], nHeight = size[1];
+
+		for (int nMode = 0; nMode < 2; nMode++) {
+			cBenchCanvas canvas(nWidth, nHeight);
+			cDirtyRects changed;
+			changed.SetSize(nWidth, nHeight);
+			vector<sTerminalCell> aPresented(nWidth * nHeight);
+			cTerminal terminal;
+			terminal.SetSize(nWidth, nHeight);
+
+			string sFrame;
+			long long nCells = 0, nWritten = 0, nRects = 0, nBytes = 0;
+			double fSeconds = 0.0;
+
+			canvas.Fill(0, 0, nWidth, nHeight, L' ', 0x10);
+			canvas.Fill(0, 0, nWidth, 1, 0x2588, 0x08);
+			canvas.DrawString(2, nHeight - 1, L"Press SPACE to start", 0x0F);
+
+			int nSpriteX = 0, nSpriteY = nHeight / 2, nStepX = 1;
+			for (int f = 0; f < nFrames; f++) {
+				canvas.Fill(nSpriteX, nSpriteY, nSpriteX + 6, nSpriteY + 3, L' ', 0x10);
+				if (nSpriteX + nStepX < 0 || nSpriteX + nStepX + 6 > nWidth)
+					nStepX = -nStepX;
+				nSpriteX += nStepX;
+				canvas.Fill(nSpriteX, nSpriteY, nSpriteX + 6, nSpriteY + 3, 0x2588, 0x0E);
+				canvas.DrawString(nWidth - 8, 0, to_wstring(f % 100000), 0x8F);
+				canvas.DrawString(2, nHeight - 1, L"Press SPACE to start", f / 15 % 2 ? 0x17 : 0x1F);
+
+				auto tp1 = chrono::steady_clock::now();
+				sFrame.clear();
+				if (nMode == 0) {
+					terminal.Encode(canvas.GetCells(), sFrame);
+					nCells += nWidth * nHeight;
+					nWritten += nWidth * nHeight;
+					nRects++;
+				}
+				else {
+					nCells += canvas.dirty.GetArea();
+					changed.Clear();
+					changed.AddChanged(canvas.dirty, canvas.GetCells(), aPresented.data());
+					terminal.Encode(canvas.GetCells(), changed.GetRects(), changed.GetCount(), sFrame);
+					nWritten += changed.GetArea();
+					nRects += changed.GetCount();
+				}
+				canvas.dirty.Clear();
+				fSeconds += chrono::duration<double>(chrono::steady_clock::now() - tp1).count();
+				nBytes += sFrame.size();
+			}
+
+			char sSize[16];
+			snprintf(sSize, sizeof(sSize), "%dx%d", nWidth, nHeight);
+			printf("%-8s %-6s %14.1f %14.1f %12.2f %12.1f %11.2f\n", sSize, nMode == 0 ? "screen" : "dirty", (double)nCells / nFrames,
+				(double)nWritten / nFrames, (double)nRects / nFrames, (double)nBytes / nFrames, fSeconds * 1e6 / nFrames);
+		}
+	}
+}
+
+struct sBenchmark {
+	const char* sName;
+	void (*pRun)(const sBenchOptions& options);
+};
+
+static const sBenchmark s_aBenchmarks[] = {
+	{ "simd", BenchSimd },
+	{ "sizes", BenchSizes },
+	{ "parallel", BenchParallel },
+	{ "symmetry", BenchSymmetry },
+	{ "heuristic", BenchHeuristic },
+	{ "sliced", BenchSliced },
+	{ "hint", BenchHint },
+	{ "arena", BenchArena },
+	{ "cells", BenchCells },
+	{ "terminal", BenchTerminal },
+	{ "dirty", BenchDirty },
+};
+
+static bool ParseOptions(int argc, char* argv[], sBenchOptions& options)
+{
+	for (int i = 2; i < argc; i++) {
+		string sArg = argv[i];
+		const char* sValue = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (sValue == nullptr)
+			return false;
+
+		if (sArg == "--seed")
+			options.nSeed = strtoull(sValue, nullptr, 10);
+		else if (sArg == "--boards")
+			options.nBoards = atoi(sValue);
+		else if (sArg == "--rounds")
+			options.nRounds = atoi(sValue);
+		else if (sArg == "--threads")
+			options.nThreads = atoi(sValue);
+		else if (sArg == "--depth")
+			options.nDepth = atoi(sValue);
+		else if (sArg == "--searches")
+			options.nSearches = atoi(sValue);
+		else if (sArg == "--replay")
+			options.sReplayFile = sValue;
+		else if (sArg == "--budget")
+			options.fBudgetMs = (float)atof(sValue);
+		else if (sArg == "--animation")
+			options.fAnimationMs = (float)atof(sValue);
+		else
+			return false;
+
+		i++;
+	}
+
+	return options.nBoards >= cBoardSimd::MAX_BOARDS && options.nRounds > 0 && options.nDepth > 0 && options.nSearches > 0
+		&& options.fBudgetMs > 0.0f && options.fAnimationMs >= 0.0f;
+}
+
+int main(int argc, char* argv[])
+{
+	const sBenchmark* pBenchmark = nullptr;
+	for (const sBenchmark& benchmark : s_aBenchmarks) {
+		if (argc > 1 && string(argv[1]) == benchmark.sName)
+			pBenchmark = &benchmark;
+	}
+
+	sBenchOptions options;
+	if (pBenchmark == nullptr || !ParseOptions(argc, argv, options)) {
+		fprintf(stderr, "Usage: %s <benchmark> [--seed N] [--boards N] [--rounds N]\n"
+			"       [--threads N] [--depth N] [--searches N] [--replay FILE]\n"
+			"       [--budget MS] [--animation MS]\n\nBenchmarks:", argv[0]);
+		for (const sBenchmark& benchmark : s_aBenchmarks)
+			fprintf(stderr, " %s", benchmark.sName);
+		fprintf(stderr, "\n");
+		return 1;
+	}
+
+	cBoard::InitTables();
+	pBenchmark->pRun(options);
+
+	return 0;
+}
@@ -1,13 +1,26 @@
 #include "c2048.h"
 
-c2048::c2048() : m_aGrid(16)
+c2048::c2048(uint64_t nSeed, const string& sWeightsFile, const string& sHeuristicFile, const string& sReplayFile) : m_nSeed(nSeed), m_rng(nSeed), m_expectimax(5), m_hintWorker(m_expectimax), m_monteCarlo(200)
 {
 	m_sAppName = L"2048";
+	m_pAI = &m_expectimax;
+	m_expectimax.SetHeuristic(&m_heuristic);
+	cBoard::InitTables();
+
+	// The n-tuple AI is only offered if its weights could be loaded
+	m_ntuple.Load(sWeightsFile.c_str());
+
+	// The expectimax keeps the default weights unless tune2048 wrote some
+	m_heuristic.LoadWeights(sHeuristicFile.c_str());
+
+	if (!sReplayFile.empty() && m_replayWriter.Open(sReplayFile.c_str()))
+		m_recorder.SetWriter(&m_replayWriter);
 }
 
 bool c2048::OnUserCreate()
 {
-	// Hide blinking cursor
+#if defined(_WIN32)
+	// Hide blinking cursor, the terminal backend hides it by itself
 	CONSOLE_CURSOR_INFO cursorInfo;
 	GetConsoleCursorInfo(m_hConsole, &cursorInfo);
 	cursorInfo.bVisible = false; // set the cursor visibility
@@ -16,6 +29,7 @@ bool c2048::OnUserCreate()
 	// Make window not resizable!
 	HWND consoleWindow = GetConsoleWindow();
 	SetWindowLong(consoleWindow, GWL_STYLE, GetWindowLong(consoleWindow, GWL_STYLE) & ~WS_MAXIMIZEBOX & ~WS_SIZEBOX);
+#endif
 
 	// Initialise title graphic
 	m_sTitleGraphic += L".####...####......#...####.";
@@ -29,7 +43,7 @@ bool c2048::OnUserCreate()
 	// Divide the length by 7 rows
 	m_nTitleGraphicWidth = (int)m_sTitleGraphic.length() / 7;
 
-	m_nFieldSize = (m_nTileSize + 1) * 4 + 1;
+	m_nFieldSize = (m_nTileSize + 1) * GRID_SIZE + 1;
 	m_nFieldOffsetX = (int)(ScreenWidth() / 2 - m_nFieldSize / 2);
 
 	return true;
@@ -37,7 +51,7 @@ bool c2048::OnUserCreate()
 
 bool c2048::OnUserDestroy()
 {
-	m_aGrid.clear();
+	m_pAnimation.reset();
 	return true;
 }
 
@@ -75,59 +89,66 @@ int c2048::GetCellIndex(int x, int y, ROTATION nRotation)
 	};
 
 	// Clamp position
-	x = clamp(x, 0, 3);
-	y = clamp(y, 0, 3);
+	x = clamp(x, 0, GRID_SIZE - 1);
+	y = clamp(y, 0, GRID_SIZE - 1);
 
 	int nReturn = 0;
 
 	switch (nRotation)
 	{
-	case LEFT:             			//  0  1  2  3
-		nReturn = y * 4 + x;		//  4  5  6  7
-		break;						//  8  9 10 11
-									// 12 13 14 15
-
-	case RIGHT:               		//  3  2  1  0
-		nReturn = y * 4 + (3 - x);	//  7  6  5  4
-		break;						// 11 10  9  8
-									// 15 14 13 12
-
-	case TOP:               		//  0  4  8 12
-		nReturn = x * 4 + y;		//  1  5  9 13
-		break;						//  2  6 10 14
-									//  3  7 11 15
-
-	case DOWN:               		// 12  8  4  0
-		nReturn = (3 - x) * 4 + y;	// 13  9  5  1
-		break;						// 14 10  6  2
-	}								// 15 11  7  3
+	case LEFT:             									//  0  1  2  3
+		nReturn = y * GRID_SIZE + x;						//  4  5  6  7
+		break;												//  8  9 10 11
+															// 12 13 14 15
+
+	case RIGHT:               								//  3  2  1  0
+		nReturn = y * GRID_SIZE + (GRID_SIZE - 1 - x);		//  7  6  5  4
+		break;												// 11 10  9  8
+															// 15 14 13 12
+
+	case TOP:               								//  0  4  8 12
+		nReturn = x * GRID_SIZE + y;						//  1  5  9 13
+		break;												//  2  6 10 14
+															//  3  7 11 15
+
+	case DOWN:               								// 12  8  4  0
+		nReturn = (GRID_SIZE - 1 - x) * GRID_SIZE + y;		// 13  9  5  1
+		break;												// 14 10  6  2
+	}														// 15 11  7  3
 
 	return nReturn;
 }
 
+int c2048::GetCellPosX(int nCellIndex)
+{
+	return 1 + m_nFieldOffsetX + (nCellIndex % GRID_SIZE) * (m_nTileSize + 1);
+}
+
+int c2048::GetCellPosY(int nCellIndex)
+{
+	return 1 + (nCellIndex / GRID_SIZE) * (m_nTileSize + 1);
+}
+
 /**
- * Draws a cell
+ * Draws a tile, exponents beyond 2048 are exploding tiles
  */
-void c2048::DrawCell(int nCellIndex, short nChar)
+void c2048::DrawCell(int nCellIndex, int nExponent, short nChar, bool bMerged, int nOffsetX, int nOffsetY)
 {
-	sCell oCell = m_aGrid[nCellIndex];
-
 	short nCellColor;
 	short nTextColor;
 	short nPrevBgColor;
 
-	GetCellColor(oCell.nValue, nCellColor, nTextColor, nPrevBgColor);
+	int nValue = nExponent == 0 ? 0 : 1 << nExponent;
+	GetCellColor(nValue, nCellColor, nTextColor, nPrevBgColor);
 
-	int nValue = oCell.nValue;
-	if (oCell.bHasBeenMerged) {
+	if (bMerged) {
 		nCellColor |= nPrevBgColor;
 		if (nChar == L' ' || nChar == PIXEL_QUARTER || nChar == PIXEL_HALF)
 			nValue = 0;
 	}
-		
 
-	int nPosX = oCell.nPosX + (int)oCell.fAnimOffsetX;
-	int nPosY = oCell.nPosY + (int)oCell.fAnimOffsetY;
+	int nPosX = GetCellPosX(nCellIndex) + nOffsetX;
+	int nPosY = GetCellPosY(nCellIndex) + nOffsetY;
 
 	// Just draw a colored rectangle
 	Fill(nPosX, nPosY, nPosX + m_nTileSize, nPosY + m_nTileSize, nChar, nCellColor);
@@ -142,21 +163,17 @@ void c2048::DrawCell(int nCellIndex, short nChar)
 	}
 }
 
-void c2048::ResetCell(int nCellIndex)
+/**
+ * Switches to GAME_STATE_ANIMATE, with a new animation unless one is
+ * running already
+ */
+sTileAnimation& c2048::StartAnimation()
 {
-	int x = nCellIndex % 4;
-	int y = nCellIndex / 4;
-
-	m_aGrid[nCellIndex].nValue = 0;
-	m_aGrid[nCellIndex].nPosX = 1 + m_nFieldOffsetX + (x * (m_nTileSize + 1));
-	m_aGrid[nCellIndex].nPosY = 1 + y * (m_nTileSize + 1);
-	m_aGrid[nCellIndex].nDestinationCellIndex = -1;
-	m_aGrid[nCellIndex].bNeedsAnimation = false;
-	m_aGrid[nCellIndex].fAnimOffsetX = 0.0f;
-	m_aGrid[nCellIndex].fAnimOffsetY = 0.0f;
-	m_aGrid[nCellIndex].bHasSpecialAnimation = false;
-	m_aGrid[nCellIndex].fAnimationTime = 0.0f;
-	m_aGrid[nCellIndex].bHasBeenMerged = false;
+	if (!m_pAnimation)
+		m_pAnimation.reset(new sTileAnimation());
+
+	m_nGameState = GAME_STATE_ANIMATE;
+	return *m_pAnimation;
 }
 
 /**
@@ -164,20 +181,20 @@ void c2048::ResetCell(int nCellIndex)
  */
 void c2048::ResetGameData(GAME_STATE state)
 {
-	// Seed random number generator
-	srand(clock());
-
-	// Reset complete grid
-	for (int x = 0; x < 4; x++) {
-		for (int y = 0; y < 4; y++) {
-			int nCellIndex = GetCellIndex(x, y);
-
-			ResetCell(nCellIndex);
-		}
-	}
-
+	m_nBoard = 0;
 	m_nScore = 0;
 	m_nGameState = state;
+	m_pAnimation.reset();
+	m_bHasHint = false;
+	m_bHintRequested = false;
+
+	// Every game draws its own seed from the stream of the session seed,
+	// so the same seed and the same moves always lead to the same games.
+	// The spawns only depend on the seed of the game, which is recorded
+	uint64_t nGameSeed = m_rng.Next();
+	m_spawnRng.Seed(nGameSeed);
+	m_monteCarlo.NewGame(m_rng.Next());
+	m_recorder.StartGame(nGameSeed);
 
 	// Add 2 numbers in random cells
 	AddNewNumber();
@@ -185,54 +202,32 @@ void c2048::ResetGameData(GAME_STATE state)
 }
 
 /**
- * Calculate all available cells
- */
-vector<int> c2048::GetAvailableCells()
-{
-	vector<int> aAvailableCells;
-
-	for (int x = 0; x < 4; x++) {
-		for (int y = 0; y < 4; y++) {
-			int nCellIndex = GetCellIndex(x, y);
-			if (m_aGrid[nCellIndex].nValue == 0) {
-				aAvailableCells.push_back(nCellIndex);
-			}
-		}
-	}
-
-	return aAvailableCells;
-}
-
-/**
- * Adds a new number to the grid
+ * Adds a new number to a random available cell of the grid
  * 90% it should be a 2 and 10% it should be a 4
+ *
+ * The cell is drawn before the value, the same draws cGame makes, so
+ * the seed of the game plays the same spawns in sim2048.
  */
 void c2048::AddNewNumber(bool bAnimate)
 {
-	int nCellValue = (rand() < RAND_MAX * 0.9f) ? 2 : 4;
-	AddNewNumber(nCellValue, bAnimate);
-}
+	uint32_t nEmptyMask = cBoard::GetEmptyMask(m_nBoard);
 
-/**
- * Adds the number specified in nValue to a random location to the grid.
- * But only to available spots.
- */
-void c2048::AddNewNumber(int nValue, bool bAnimate)
-{
-	vector<int> aAvailableCells = GetAvailableCells();
-
-	if (aAvailableCells.empty())
+	if (nEmptyMask == 0)
 		return;
 
-	// Get random available cell
-	int nCellIndex = aAvailableCells[rand() % aAvailableCells.size()];
+	int nCellIndex = cBoard::SelectBit(nEmptyMask, m_spawnRng.NextBelow(cBoard::CountBits(nEmptyMask)));
+	int nValue = (m_spawnRng.NextBelow(10) != 0) ? 2 : 4;
 
-	m_aGrid[nCellIndex].nValue = nValue;
-	m_aGrid[nCellIndex].nDestinationCellIndex = -1;
-	m_aGrid[nCellIndex].bHasSpecialAnimation = bAnimate;
+	m_nBoard = cBoard::SetExponent(m_nBoard, nCellIndex, cBoard::ExponentFromValue(nValue));
+	m_recorder.RecordSpawn(nCellIndex, cBoard::ExponentFromValue(nValue));
+	RequestHint();
 
 	if (bAnimate) {
-		m_nGameState = GAME_STATE_ANIMATE;
+		// The new tile takes over the cell of an explosion
+		sTileAnimation& animation = StartAnimation();
+		animation.nEffectMask |= 1u << nCellIndex;
+		animation.nExplodedMask &= ~(1u << nCellIndex);
+		animation.aEffectTime[nCellIndex] = 0.0f;
 	}
 }
 
@@ -242,16 +237,27 @@ void c2048::AddNewNumber(int nValue, bool bAnimate)
 void c2048::AddNewNumber(int nValue, int x, int y, bool bAnimate)
 {
 	int nCellIndex = GetCellIndex(x, y, LEFT);
-	m_aGrid[nCellIndex].nValue = nValue;
-	m_aGrid[nCellIndex].nDestinationCellIndex = -1;
-	m_aGrid[nCellIndex].bHasSpecialAnimation = bAnimate;
+	m_nBoard = cBoard::SetExponent(m_nBoard, nCellIndex, cBoard::ExponentFromValue(nValue));
+	m_recorder.RecordSpawn(nCellIndex, cBoard::ExponentFromValue(nValue));
+	RequestHint();
 
 	if (bAnimate) {
-		m_nGameState = GAME_STATE_ANIMATE;
+		sTileAnimation& animation = StartAnimation();
+		animation.nEffectMask |= 1u << nCellIndex;
+		animation.nExplodedMask &= ~(1u << nCellIndex);
+		animation.aEffectTime[nCellIndex] = 0.0f;
 		m_fAnimationTime = 0;
 	}
 }
 
+/**
+ * Scores the board with the heuristic of the AI
+ */
+float c2048::EvaluateGrid()
+{
+	return m_heuristic.Evaluate(m_nBoard);
+}
+
 /**
  * Gets the foreground color, background color and text color
  * for a specific value of a cell
@@ -340,136 +346,114 @@ void c2048::GetCellColor(int nValue, short& cellColor, short& textColor, short&
 	}
 }
 
+wstring c2048::GetDirectionName(ROTATION nDir)
+{
+	switch (nDir) {
+	case LEFT:
+		return L"left";
+
+	case TOP:
+		return L"up";
+
+	case RIGHT:
+		return L"right";
+
+	default:
+		return L"down";
+	}
+}
+
+wstring c2048::GetAIName()
+{
+	if (m_pAI == &m_expectimax)
+		return L"expectimax";
+	if (m_pAI == &m_monteCarlo)
+		return L"montecarlo";
+	return L"ntuple";
+}
+
+/**
+ * Hands a new board to the expectimax worker as soon as it is known
+ */
+void c2048::RequestHint()
+{
+	m_fThinkTime = 0.0f;
+	m_nHintDepth = 0;
+
+	if (m_pAI == &m_expectimax)
+		m_hintWorker.Search(m_nBoard);
+}
+
+/**
+ * Sets the hint once the AI knows its move
+ *
+ * The expectimax worker has usually finished while the new tile was
+ * animating. Otherwise its result is taken once it reached its depth,
+ * or once m_fMaxThinkTime has passed and at least depth 2 is done. The
+ * other AIs are quick enough to answer at once.
+ */
+void c2048::ThinkAI(float fElapsedTime)
+{
+	if (m_pAI != &m_expectimax) {
+		m_bHasHint = m_pAI->ChooseMove(m_nBoard, m_nHint);
+		m_bHintRequested = false;
+		return;
+	}
+
+	m_fThinkTime += fElapsedTime;
+
+	sHintResult result;
+	if (!m_hintWorker.GetResult(m_nBoard, result))
+		return;
+
+	m_nHintDepth = result.nDepth;
+	if (!result.bDone && (m_fThinkTime < m_fMaxThinkTime || result.nDepth < 2))
+		return;
+
+	m_bHasHint = result.bHasMove;
+	m_nHint = result.nMove;
+	m_bHintRequested = false;
+}
+
 /**
  * Moves and combines cells
  *
+ * cBoard::PlanMove works out the new board, the score and where every
+ * tile travels in one pass. The animation and ApplyMovePlan only go
+ * through the tiles of that plan.
+ *
  * Returns true if something has been done
  */
 bool c2048::MoveCells(ROTATION dir)
 {
-	bool bHasMoved = false;
-
-	// For each row (if we think of a rotated grid)
-	for (int y = 0; y < 4; y++) {
-		int nLastCellMovedIndex = -1;
-		int nLastCellValue = -1;
-		int nLastReceiverCellIndex = -1;
-		int nStartPrevX = 0;
-		bool bLastCellMerged = false;
-
-		for (int x = 0; x < 4; x++) {
-			int nCurrentCellIndex = GetCellIndex(x, y, dir);
-
-			// If first cell just safe the values and continue
-			if (x == 0) {
-				nLastCellMovedIndex = -1;
-				nLastCellValue = m_aGrid[nCurrentCellIndex].nValue;
-				bLastCellMerged = false;
-				continue;
-			}
-
-			// Cell is empty - so nothing todo
-			if (m_aGrid[nCurrentCellIndex].nValue == 0)
-				continue;
-
-			// Iterate over all the previous cells to check if we find a space
-			// or a way to merge
-			bool bCellFinished = false;
-			for (int prevX = nStartPrevX; prevX < x && !bCellFinished; prevX++) {
-				int nPreviousCellIndex = GetCellIndex(prevX, y, dir);
-
-				if (m_aGrid[nCurrentCellIndex].nValue == nLastCellValue && !bLastCellMerged) {
-					// Last cell value is the same as our current cell
-					// So we can merge
-					m_aGrid[nCurrentCellIndex].nDestinationCellIndex = nPreviousCellIndex;
-					m_aGrid[nCurrentCellIndex].bNeedsAnimation = true;
-
-					nLastReceiverCellIndex = nPreviousCellIndex;
-
-					bHasMoved = true;
-					bCellFinished = true;
-
-					nStartPrevX = prevX + 1;
-					nLastCellValue = 0;
-					bLastCellMerged = true;
-				}
-				else if (m_aGrid[nPreviousCellIndex].nValue == 0 && (nLastReceiverCellIndex != nPreviousCellIndex || nLastCellValue == 0)) {
-					// Cell is empty so we use it directly
-					m_aGrid[nCurrentCellIndex].nDestinationCellIndex = nPreviousCellIndex;
-					m_aGrid[nCurrentCellIndex].bNeedsAnimation = true;
-
-					nLastReceiverCellIndex = nPreviousCellIndex;
-
-					bHasMoved = true;
-					bCellFinished = true;
-
-					nStartPrevX = prevX;
-					nLastCellValue = m_aGrid[nCurrentCellIndex].nValue;
-					bLastCellMerged = false;
-				}
-				else if (nLastCellMovedIndex == nPreviousCellIndex) {
-					// Cell has already been moved so it is considered empty
-					m_aGrid[nCurrentCellIndex].nDestinationCellIndex = nPreviousCellIndex;
-					m_aGrid[nCurrentCellIndex].bNeedsAnimation = true;
-
-					nLastReceiverCellIndex = nPreviousCellIndex;
-
-					bHasMoved = true;
-					bCellFinished = true;
-
-					nStartPrevX = prevX;
-					nLastCellValue = m_aGrid[nCurrentCellIndex].nValue;
-					bLastCellMerged = false;
-				}
-			}
-
-			if (!bCellFinished) {
-				// Cell had not been moved
-				nLastCellValue = m_aGrid[nCurrentCellIndex].nValue;
-				bLastCellMerged = false;
-				nLastReceiverCellIndex = nCurrentCellIndex;
-				nStartPrevX = x;
-			}
-			else {
-				nLastCellMovedIndex = nCurrentCellIndex;
-			}
-		}
-	}
+	if (!cBoard::PlanMove(m_nBoard, dir, m_movePlan))
+		return false;
 
-	return bHasMoved;
+	sTileAnimation& animation = StartAnimation();
+	animation.bIsMoving = true;
+	animation.nMovingMask = (uint32_t)((1ULL << m_movePlan.nCount) - 1);
+	return true;
 }
 
 /**
- * Executes the precalculated cell movement
+ * Makes the board of the plan the game state once all tiles have
+ * arrived, and starts the merge and explosion animations
  */
-void c2048::CalculateCellMovement(ROTATION dir)
+void c2048::ApplyMovePlan()
 {
-	for (int x = 0; x < 4; x++) {
-		for (int y = 0; y < 4; y++) {
-			int nCurrentCellIndex = GetCellIndex(x, y, dir);
-			int nTargetCellIndex = m_aGrid[nCurrentCellIndex].nDestinationCellIndex;
-			
-			if (nTargetCellIndex == -1)
-				continue;
-
-			if (m_aGrid[nTargetCellIndex].nValue == m_aGrid[nCurrentCellIndex].nValue) {
-				// Combine those two cells
-				m_aGrid[nTargetCellIndex].nValue += m_aGrid[nCurrentCellIndex].nValue;
-				m_aGrid[nTargetCellIndex].bHasBeenMerged = !(m_aGrid[nTargetCellIndex].nValue > 2048);
-				m_aGrid[nTargetCellIndex].bHasSpecialAnimation = true;
-				m_nGameState = GAME_STATE_ANIMATE;
-			}
-			else
-				// Move the cell
-				m_aGrid[nTargetCellIndex].nValue = m_aGrid[nCurrentCellIndex].nValue;
-
-			m_aGrid[nCurrentCellIndex].nDestinationCellIndex = -1;
-			m_aGrid[nCurrentCellIndex].nValue = 0;
-			m_aGrid[nCurrentCellIndex].bNeedsAnimation = false;
-			m_aGrid[nCurrentCellIndex].fAnimOffsetX = 0.0f;
-			m_aGrid[nCurrentCellIndex].fAnimOffsetY = 0.0f;
-		}
-	}
+	sTileAnimation& animation = *m_pAnimation;
+	uint32_t nEffects = m_movePlan.nMergedMask | m_movePlan.nExplodedMask;
+
+	for (uint32_t nMask = nEffects; nMask != 0; nMask &= nMask - 1)
+		animation.aEffectTime[cBoard::LowestBit(nMask)] = 0.0f;
+
+	animation.nEffectMask |= nEffects;
+	animation.nMergedMask |= m_movePlan.nMergedMask;
+	animation.nExplodedMask |= m_movePlan.nExplodedMask;
+	animation.bIsMoving = false;
+
+	m_nBoard = m_movePlan.nResult;
+	m_nScore += m_movePlan.nScore;
 }
 
 /**
@@ -487,33 +471,76 @@ void c2048::GameStateStart(float fElapsedTime)
 		return;
 	}
 
-	if (GetKey(VK_RIGHT).bReleased) {
-		m_nAnimationDirection = RIGHT;
-		m_bHasMoved = MoveCells(RIGHT);
-	}
-	else if (GetKey(VK_LEFT).bReleased) {
-		m_nAnimationDirection = LEFT;
-		m_bHasMoved = MoveCells(LEFT);
+	if (GetKey(L'A').bReleased)
+		m_bAutoplay = !m_bAutoplay;
+
+	if (GetKey(L'M').bReleased) {
+		if (m_pAI == &m_expectimax)
+			m_pAI = &m_monteCarlo;
+		else if (m_pAI == &m_monteCarlo && m_ntuple.HasWeights())
+			m_pAI = &m_ntuple;
+		else
+			m_pAI = &m_expectimax;
+		m_bHasHint = false;
+
+		if (m_pAI == &m_expectimax)
+			RequestHint();
+		else
+			m_hintWorker.Cancel();
 	}
-	else if (GetKey(VK_UP).bReleased) {
-		m_nAnimationDirection = TOP;
-		m_bHasMoved = MoveCells(TOP);
-	}
-	else if (GetKey(VK_DOWN).bReleased) {
-		m_nAnimationDirection = DOWN;
-		m_bHasMoved = MoveCells(DOWN);
+
+	if (GetKey(L'H').bReleased)
+		m_bHintRequested = true;
+
+	// The move of the AI is the hint, autoplay plays it once it is known
+	if ((m_bHintRequested || m_bAutoplay) && !m_bHasHint)
+		ThinkAI(fElapsedTime);
+
+	bool bMove = true;
+	ROTATION nDir = LEFT;
+
+	if (GetKey(VK_RIGHT).bReleased)
+		nDir = RIGHT;
+	else if (GetKey(VK_LEFT).bReleased)
+		nDir = LEFT;
+	else if (GetKey(VK_UP).bReleased)
+		nDir = TOP;
+	else if (GetKey(VK_DOWN).bReleased)
+		nDir = DOWN;
+	else if (m_bAutoplay && m_bHasHint)
+		nDir = m_nHint;
+	else
+		bMove = false;
+
+	if (bMove) {
+		m_bHasMoved = MoveCells(nDir);
+
+		if (m_bHasMoved) {
+			m_recorder.RecordMove(m_movePlan.nDir);
+
+			// Searches the likely new tiles while the move is animating
+			if (m_pAI == &m_expectimax)
+				m_hintWorker.Prefetch(m_movePlan.nResult);
+		}
 	}
 
 	// If something has moved start the animation
 	if (m_bHasMoved) {
+		m_bHasHint = false;
+		m_bHintRequested = false;
 		m_nGameState = GAME_STATE_ANIMATE;
 		return;
 	}
 
 	DrawGameField();
-	for (int x = 0; x < 4; x++)
-		for (int y = 0; y < 4; y++)
-			DrawCell(GetCellIndex(x, y));
+	for (uint32_t nMask = ~cBoard::GetEmptyMask(m_nBoard) & 0xFFFF; nMask != 0; nMask &= nMask - 1) {
+		int nCellIndex = cBoard::LowestBit(nMask);
+		DrawCell(nCellIndex, cBoard::GetExponent(m_nBoard, nCellIndex));
+	}
+
+	// Nothing changes on screen until a key is pressed
+	if (!m_bAutoplay && !m_bHintRequested)
+		WaitForInput();
 }
 
 /**
@@ -524,8 +551,8 @@ void c2048::DrawGameField()
 	// Draw the field
 	Fill(0, 0, 30, m_nFieldSize, PIXEL_SOLID, FG_DARK_GREY);
 
-	for (int x = 0; x < 4; x++) {
-		for (int y = 0; y < 4; y++) {
+	for (int x = 0; x < GRID_SIZE; x++) {
+		for (int y = 0; y < GRID_SIZE; y++) {
 			int nPosX = 1 + m_nFieldOffsetX + (x * (m_nTileSize + 1));
 			int nPosY = 1 + y * (m_nTileSize + 1);
 
@@ -538,6 +565,20 @@ void c2048::DrawGameField()
 	sScoreString.append(to_wstring(m_nScore));
 	DrawString(1, m_nFieldSize + 1, sScoreString, FG_WHITE);
 
+	// Print how the AI rates the position, in thousands
+	wstring sEvalString = L"Eval " + to_wstring((int)(EvaluateGrid() / 1000.0f)) + L"k";
+	DrawString(ScreenWidth() - 1 - (int)sEvalString.length(), m_nFieldSize + 1, sEvalString, FG_DARK_GREY);
+
+	// Print hint or autoplay state
+	if (m_bAutoplay)
+		DrawString(1, m_nFieldSize + 2, L"Autoplay " + GetAIName() + L" (A)", FG_GREY);
+	else if (m_bHasHint)
+		DrawString(1, m_nFieldSize + 2, L"Hint " + GetAIName() + L": " + GetDirectionName(m_nHint), FG_GREY);
+	else if (m_bHintRequested)
+		DrawString(1, m_nFieldSize + 2, L"Thinking, depth " + to_wstring(m_nHintDepth), FG_GREY);
+	else
+		DrawString(1, m_nFieldSize + 2, L"H:hint A:auto M:" + GetAIName(), FG_GREY);
+
 	// Print exit help
 	DrawString(1, m_nFieldSize + 3, L"Press ESC to exit", FG_WHITE);
 
@@ -587,129 +628,110 @@ void c2048::GameStateTitle(float fElapsedTime)
 	// Draw the text
 	wstring sBlinkText = L"Press Space to start";
 	DrawString((int)(ScreenWidth() / 2 - sBlinkText.length() / 2), nOffsetBlinkTextY, sBlinkText, m_nBlinkAnimation[nAnimationIndex]);
+
+	// Show the seed so the games can be replayed with --seed
+	DrawString(1, ScreenHeight() - 2, L"Seed: " + to_wstring(m_nSeed), FG_DARK_GREY);
+
+	// The text only changes colour at the next animation index
+	WaitForInput((floor(m_fAnimationTime) + 1.0f - m_fAnimationTime) / m_nBlinkAnimationSpeed);
 }
 
 /**
  * Handle for the game state GAME_STATE_ANIMATE
  *
- * Animates the moving tiles
+ * First the tiles of the move plan slide to their cells, then the new
+ * tile, merged tiles and explosions are animated. Only the tiles which
+ * are animated are looked at, all others are just drawn.
  */
 void c2048::GameStateAnimate(float fElapsedTime)
 {
-	bool bNeedsMoreAnimation = false;
-	bool bNeedNewNumber = true;
+	sTileAnimation& animation = *m_pAnimation;
 
-	auto CellIsFinished = [&](int nCurrent, int nTarget, float fOffset) -> bool {
-		int nBoundLeft = nTarget - 1;
-		int nBoundRight = nTarget + 1;
-		float fNewCurrent = nCurrent + fOffset;
+	DrawGameField();
 
-		return nBoundLeft < fNewCurrent && fNewCurrent < nBoundRight;
-	};
+	uint32_t nStillMask = ~cBoard::GetEmptyMask(m_nBoard) & 0xFFFF & ~animation.nEffectMask;
+	if (animation.bIsMoving) {
+		for (int k = 0; k < m_movePlan.nCount; k++)
+			nStillMask &= ~(1u << m_movePlan.aMoves[k].nFrom);
+	}
 
-	DrawGameField();
+	for (uint32_t nMask = nStillMask; nMask != 0; nMask &= nMask - 1) {
+		int nCellIndex = cBoard::LowestBit(nMask);
+		DrawCell(nCellIndex, cBoard::GetExponent(m_nBoard, nCellIndex));
+	}
 
-	for (int x = 0; x < 4; x++) {
-		for (int y = 0; y < 4; y++) {
-			int nCurrentCellIndex = GetCellIndex(x, y, m_nAnimationDirection);
+	if (animation.bIsMoving) {
+		// Every tile takes the same time, however far it goes
+		const float fSpeedFactor = 6.0f;
+		ROTATION nDir = m_movePlan.nDir;
+		bool bHorizontal = nDir == LEFT || nDir == RIGHT;
+		float fSign = (nDir == LEFT || nDir == TOP) ? -1.0f : 1.0f;
 
-			if (m_aGrid[nCurrentCellIndex].bNeedsAnimation == false && m_aGrid[nCurrentCellIndex].nValue > 0 && !m_aGrid[nCurrentCellIndex].bHasSpecialAnimation) {
-				// Cell needs no animation but has a value
-				DrawCell(nCurrentCellIndex);
-			}
-			else if (m_aGrid[nCurrentCellIndex].bNeedsAnimation) {
-				// Cell needs to be animated
-				float fSpeedFactor = 6.0f;
-				float fMovementSpeed = 1.0f;
-				int nTargetCellIndex = m_aGrid[nCurrentCellIndex].nDestinationCellIndex;
-
-				if (m_nAnimationDirection == LEFT || m_nAnimationDirection == RIGHT)
-					fMovementSpeed = (float)abs(m_aGrid[nCurrentCellIndex].nPosX - m_aGrid[nTargetCellIndex].nPosX);
-				else
-					fMovementSpeed = (float)abs(m_aGrid[nCurrentCellIndex].nPosY - m_aGrid[nTargetCellIndex].nPosY);
-
-				float fAddition = fMovementSpeed * fElapsedTime * fSpeedFactor;
-				bool bIsFinished = false;
-
-				switch (m_nAnimationDirection) {
-				case LEFT:
-					m_aGrid[nCurrentCellIndex].fAnimOffsetX -= fAddition;
-					DrawCell(nCurrentCellIndex);
-					bIsFinished = CellIsFinished(m_aGrid[nCurrentCellIndex].nPosX, m_aGrid[nTargetCellIndex].nPosX, m_aGrid[nCurrentCellIndex].fAnimOffsetX);
-					break;
-
-				case RIGHT:
-					m_aGrid[nCurrentCellIndex].fAnimOffsetX += fAddition;
-					DrawCell(nCurrentCellIndex);
-					bIsFinished = CellIsFinished(m_aGrid[nCurrentCellIndex].nPosX, m_aGrid[nTargetCellIndex].nPosX, m_aGrid[nCurrentCellIndex].fAnimOffsetX);
-					break;
-
-				case TOP:
-					m_aGrid[nCurrentCellIndex].fAnimOffsetY -= fAddition;
-					DrawCell(nCurrentCellIndex);
-					bIsFinished = CellIsFinished(m_aGrid[nCurrentCellIndex].nPosY, m_aGrid[nTargetCellIndex].nPosY, m_aGrid[nCurrentCellIndex].fAnimOffsetY);
-					break;
-
-				case DOWN:
-					m_aGrid[nCurrentCellIndex].fAnimOffsetY += fAddition;
-					DrawCell(nCurrentCellIndex);
-					bIsFinished = CellIsFinished(m_aGrid[nCurrentCellIndex].nPosY, m_aGrid[nTargetCellIndex].nPosY, m_aGrid[nCurrentCellIndex].fAnimOffsetY);
-					break;
-				}
-
-				if (bIsFinished)
-					m_aGrid[nCurrentCellIndex].bNeedsAnimation = false;
-				else
-					bNeedsMoreAnimation = true;				
-			}
-			else if (m_aGrid[nCurrentCellIndex].bHasSpecialAnimation) {
-				vector<short>* vecAnimation = nullptr;
-				int* nAnimationSpeed = nullptr;
-
-				if (m_aGrid[nCurrentCellIndex].nValue > 2048) {
-					vecAnimation = &m_nExplosionAnimation;
-					nAnimationSpeed = &m_nExplosionAnimationSpeed;
-				}
-				else if (m_aGrid[nCurrentCellIndex].bHasBeenMerged == true) {
-					vecAnimation = &m_nMergeAnimation;
-					nAnimationSpeed = &m_nMergeAnimationSpeed;
-				}
-				else {
-					vecAnimation = &m_nNewTileAnimation;
-					nAnimationSpeed = &m_nNewTileAnimationSpeed;
-				}
-
-				if (nAnimationSpeed == nullptr || vecAnimation == nullptr)
-					return;
-
-				m_aGrid[nCurrentCellIndex].fAnimationTime += fElapsedTime * *nAnimationSpeed;
-				int nAnimationIndex = ((int)m_aGrid[nCurrentCellIndex].fAnimationTime) % vecAnimation->size();
-
-				DrawCell(nCurrentCellIndex, vecAnimation->at(nAnimationIndex));
-
-				if (nAnimationIndex == vecAnimation->size() - 1) {
-					// Animation finished
-					m_aGrid[nCurrentCellIndex].bHasSpecialAnimation = false;
-					m_aGrid[nCurrentCellIndex].bHasBeenMerged = false;
-					m_aGrid[nCurrentCellIndex].fAnimationTime = 0.0f;
-
-					if (m_aGrid[nCurrentCellIndex].nValue > 2048)
-						ResetCell(nCurrentCellIndex);
-				}
-				else
-					bNeedsMoreAnimation = true;
-
-				bNeedNewNumber = false;
+		for (int k = 0; k < m_movePlan.nCount; k++) {
+			const sTileMove& move = m_movePlan.aMoves[k];
+			float& fOffset = animation.aSlideOffset[k];
+
+			if (animation.nMovingMask & (1u << k)) {
+				int nCurrent = bHorizontal ? GetCellPosX(move.nFrom) : GetCellPosY(move.nFrom);
+				int nTarget = bHorizontal ? GetCellPosX(move.nTo) : GetCellPosY(move.nTo);
+
+				fOffset += fSign * abs(nCurrent - nTarget) * fElapsedTime * fSpeedFactor;
+
+				float fNewCurrent = nCurrent + fOffset;
+				if (nTarget - 1 < fNewCurrent && fNewCurrent < nTarget + 1)
+					animation.nMovingMask &= ~(1u << k);
 			}
+
+			int nExponent = cBoard::GetExponent(m_nBoard, move.nFrom);
+			if (bHorizontal)
+				DrawCell(move.nFrom, nExponent, PIXEL_SOLID, false, (int)fOffset, 0);
+			else
+				DrawCell(move.nFrom, nExponent, PIXEL_SOLID, false, 0, (int)fOffset);
+		}
+
+		if (animation.nMovingMask == 0) {
+			ApplyMovePlan();
+			AddNewNumber();
 		}
+		return;
 	}
 
-	if (!bNeedsMoreAnimation && bNeedNewNumber) {
-		CalculateCellMovement(m_nAnimationDirection);
-		AddNewNumber();
-	} 
-	else if (!bNeedsMoreAnimation) {
+	for (uint32_t nMask = animation.nEffectMask; nMask != 0; nMask &= nMask - 1) {
+		int nCellIndex = cBoard::LowestBit(nMask);
+		uint32_t nBit = 1u << nCellIndex;
+		bool bMerged = (animation.nMergedMask & nBit) != 0;
+		int nExponent = cBoard::GetExponent(m_nBoard, nCellIndex);
+
+		const vector<short>* vecAnimation = &m_nNewTileAnimation;
+		int nAnimationSpeed = m_nNewTileAnimationSpeed;
+
+		if (animation.nExplodedMask & nBit) {
+			vecAnimation = &m_nExplosionAnimation;
+			nAnimationSpeed = m_nExplosionAnimationSpeed;
+			nExponent = cBoard::MAX_EXPONENT + 1;
+		}
+		else if (bMerged) {
+			vecAnimation = &m_nMergeAnimation;
+			nAnimationSpeed = m_nMergeAnimationSpeed;
+		}
+
+		float& fTime = animation.aEffectTime[nCellIndex];
+		fTime += fElapsedTime * nAnimationSpeed;
+		int nAnimationIndex = ((int)fTime) % vecAnimation->size();
+
+		DrawCell(nCellIndex, nExponent, vecAnimation->at(nAnimationIndex), bMerged);
+
+		if (nAnimationIndex == vecAnimation->size() - 1) {
+			// Animation finished
+			animation.nEffectMask &= ~nBit;
+			animation.nMergedMask &= ~nBit;
+			animation.nExplodedMask &= ~nBit;
+		}
+	}
+
+	if (animation.nEffectMask == 0) {
+		m_pAnimation.reset();
 		m_nGameState = GAME_STATE_START;
 		m_bHasMoved = false;
 	}
-}
\ No newline at end of file
+}
@@ -1,10 +1,20 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <string>
 using namespace std;
 
 #include "olcConsoleGameEngineOOP.h"
+#include "cBoard.h"
+#include "cExpectimax.h"
+#include "cHeuristic.h"
+#include "cHintWorker.h"
+#include "cMonteCarlo.h"
+#include "cNTuple.h"
+#include "cRandom.h"
+#include "cReplay.h"
+#include "cTimeSlicedSearch.h"
 
 enum GAME_STATE {
 	GAME_STATE_TITLE	= 0x01,
@@ -13,37 +23,46 @@ enum GAME_STATE {
 	GAME_STATE_ANIMATE	= 0x04
 };
 
-enum ROTATION {
-	LEFT = 0,
-	TOP = 90,
-	RIGHT = 180,
-	DOWN = 270
-};
-
-struct sCell {
-	int nValue;
-	int nPosX;
-	int nPosY;
-	int nDestinationCellIndex;
-	bool bNeedsAnimation;
-	float fAnimOffsetX;
-	float fAnimOffsetY;
-	bool bHasSpecialAnimation;
-	bool bHasBeenMerged;
-	float fAnimationTime;
+/**
+ * Everything that is only needed to animate the tiles
+ *
+ * Only exists while GAME_STATE_ANIMATE is active. The tiles themselves
+ * are the exponents of the board, so logic never touches this. Slides
+ * are indexed like the tiles of the move plan, effects (new, merged and
+ * exploding tiles) by cell.
+ */
+struct sTileAnimation {
+	bool bIsMoving = false;
+	uint32_t nMovingMask = 0;	// bit k until tile k of the plan has arrived
+	uint32_t nEffectMask = 0;
+	uint32_t nMergedMask = 0;
+	uint32_t nExplodedMask = 0;	// the board is empty there already
+	float aSlideOffset[16] = {};
+	float aEffectTime[16] = {};
 };
 
 class c2048 : public olcConsoleGameEngineOOP
 {
 public:
-	c2048();
+	// The game runs on cBoard, which is always 4x4. Other sizes are
+	// available headless through cBoardN
+	static const int GRID_SIZE = 4;
+
+public:
+	// Games are recorded to sReplayFile unless it is empty
+	c2048(uint64_t nSeed, const string& sWeightsFile, const string& sHeuristicFile, const string& sReplayFile);
 
 private:
 	GAME_STATE m_nGameState = GAME_STATE_TITLE;
-	vector<sCell> m_aGrid;
+	uint64_t m_nSeed;
+	cRandom m_rng;
+	cRandom m_spawnRng;		// seeded for every game from m_rng
+	board_t m_nBoard = 0;
 	int m_nScore;
 	int m_nNumberSystem = 30;
-	bool m_bIsMoving = false;
+
+	sMovePlan m_movePlan;
+	unique_ptr<sTileAnimation> m_pAnimation;
 
 	wstring m_sTitleGraphic = L"";
 	int m_nTitleGraphicWidth = 0;
@@ -64,7 +83,26 @@ private:
 	float m_fAnimationTime = 0.0f;
 
 	bool m_bHasMoved = false;
-	ROTATION m_nAnimationDirection;
+
+	cHeuristic m_heuristic;
+	// Only searched by m_hintWorker, on its own thread and a single core.
+	// The parallel cExpectimax searches wider but cannot be paused, and
+	// its threads would compete with the frames for the cores
+	cTimeSlicedSearch m_expectimax;
+	cHintWorker m_hintWorker;
+	cMonteCarlo m_monteCarlo;
+	cNTuple m_ntuple;
+	cPlayer* m_pAI = nullptr;
+	bool m_bAutoplay = false;
+	bool m_bHasHint = false;
+	bool m_bHintRequested = false;
+	ROTATION m_nHint = LEFT;
+	int m_nHintDepth = 0;
+	float m_fThinkTime = 0.0f;
+	float m_fMaxThinkTime = 0.25f;
+
+	cReplayWriter m_replayWriter;
+	cReplayRecorder m_recorder;
 
 protected:
 	virtual bool OnUserCreate();
@@ -73,18 +111,23 @@ protected:
 
 private:
 	int GetCellIndex(int x, int y, ROTATION nRotation = LEFT);
-	void DrawCell(int nCellIndex, short nChar = PIXEL_SOLID);
+	int GetCellPosX(int nCellIndex);
+	int GetCellPosY(int nCellIndex);
+	void DrawCell(int nCellIndex, int nExponent, short nChar = PIXEL_SOLID, bool bMerged = false, int nOffsetX = 0, int nOffsetY = 0);
 	void DrawGameField();
 	void ResetGameData(GAME_STATE state = GAME_STATE_TITLE);
-	void ResetCell(int nCellIndex);
-	vector<int> GetAvailableCells();
+	sTileAnimation& StartAnimation();
 	void AddNewNumber(bool bAnimate = true);
-	void AddNewNumber(int nValue, bool bAnimate = true);
 	void AddNewNumber(int nValue, int x, int y, bool bAnimate = true);
+	float EvaluateGrid();
 	void GetCellColor(int nValue, short& cellColor, short& textColor, short& prevBgColor);
+	wstring GetDirectionName(ROTATION nDir);
+	wstring GetAIName();
+	void RequestHint();
+	void ThinkAI(float fElapsedTime);
 	void GameStateStart(float fElapsedTime);
 	void GameStateTitle(float fElapsedTime);
 	void GameStateAnimate(float fElapsedTime);
 	bool MoveCells(ROTATION dir);
-	void CalculateCellMovement(ROTATION dir);
+	void ApplyMovePlan();
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <new>
+
+#include "cArena.h"
+
+// Blocks start on a cache line
+static const size_t BLOCK_ALIGNMENT = 64;
+
+void sArenaStats::Add(const sArenaStats& other)
+{
+	nPeakBytes += other.nPeakBytes;
+	nReservedBytes += other.nReservedBytes;
+	nAllocations += other.nAllocations;
+	nBlocks += other.nBlocks;
+	nResets += other.nResets;
+}
+
+cArena::cArena(size_t nBlockSize) : m_nBlockSize(nBlockSize)
+{
+}
+
+cArena::~cArena()
+{
+	for (sBlock& block : m_aBlocks)
+		operator delete(block.pData, align_val_t(BLOCK_ALIGNMENT));
+}
+
+cArena::cArena(cArena&& other) noexcept
+	: m_nBlockSize(other.m_nBlockSize), m_aBlocks(move(other.m_aBlocks)), m_nBlock(other.m_nBlock),
+	m_nOffset(other.m_nOffset), m_nUsedBefore(other.m_nUsedBefore), m_stats(other.m_stats)
+{
+	other.m_aBlocks.clear();
+	other.Reset();
+}
+
+void cArena::Rewind(const sMark& mark)
+{
+	UpdatePeak();
+	m_nBlock = mark.nBlock;
+	m_nOffset = mark.nOffset;
+	m_nUsedBefore = mark.nUsedBefore;
+}
+
+void cArena::Reset()
+{
+	UpdatePeak();
+	m_nBlock = 0;
+	m_nOffset = 0;
+	m_nUsedBefore = 0;
+	m_stats.nResets++;
+}
+
+sArenaStats cArena::GetStats() const
+{
+	sArenaStats stats = m_stats;
+	stats.nPeakBytes = max(stats.nPeakBytes, GetUsedBytes());
+	return stats;
+}
+
+void cArena::UpdatePeak()
+{
+	m_stats.nPeakBytes = max(m_stats.nPeakBytes, GetUsedBytes());
+}
+
+/**
+ * Continues in the next block, which is either one kept from before a
+ * reset or a new one. A block which is too small for the request is
+ * skipped, a request bigger than the block size gets a block of its own.
+ */
+void* cArena::AllocateSlow(size_t nBytes, size_t nAlignment)
+{
+	while (true) {
+		// Only the very first allocation has no current block to leave
+		if (m_nBlock < m_aBlocks.size()) {
+			m_nUsedBefore += m_aBlocks[m_nBlock].nSize;
+			m_nBlock++;
+		}
+		m_nOffset = 0;
+
+		if (m_nBlock == m_aBlocks.size()) {
+			size_t nSize = max(m_nBlockSize, nBytes + nAlignment);
+			m_aBlocks.push_back(sBlock{ (char*)operator new(nSize, align_val_t(BLOCK_ALIGNMENT)), nSize });
+			m_stats.nBlocks++;
+			m_stats.nReservedBytes += nSize;
+		}
+
+		const sBlock& block = m_aBlocks[m_nBlock];
+		if (nBytes + nAlignment <= block.nSize)
+			return Allocate(nBytes, nAlignment);
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+struct sArenaStats {
+	size_t nPeakBytes = 0;		// most bytes in use at once
+	size_t nReservedBytes = 0;	// blocks taken from the system
+	long long nAllocations = 0;
+	long long nBlocks = 0;
+	long long nResets = 0;
+
+	// Peaks of different arenas add up, they are in use at the same time
+	void Add(const sArenaStats& other);
+};
+
+/**
+ * Bump allocator for the scratch memory of a search
+ *
+ * Allocating moves a pointer through a block and only takes a new block
+ * from the system when the current one is full. Nothing is freed on its
+ * own: Reset hands everything back at once in O(1) and keeps the blocks
+ * for the next move, Rewind goes back to a mark, so a recursive search
+ * can free its scratch memory in the order it allocated it.
+ *
+ * An arena belongs to one thread. Destructors are never run, so only
+ * trivially destructible types can be allocated.
+ */
+class cArena
+{
+public:
+	static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	struct sMark {
+		size_t nBlock;
+		size_t nOffset;
+		size_t nUsedBefore;
+	};
+
+public:
+	cArena(size_t nBlockSize = DEFAULT_BLOCK_SIZE);
+	~cArena();
+	cArena(const cArena&) = delete;
+	cArena& operator=(const cArena&) = delete;
+	cArena(cArena&& other) noexcept;
+
+	void* Allocate(size_t nBytes, size_t nAlignment = alignof(max_align_t));
+
+	// Uninitialized room for nCount objects
+	template <typename T>
+	T* Allocate(size_t nCount = 1)
+	{
+		static_assert(is_trivially_destructible<T>::value, "the arena never runs destructors");
+		return (T*)Allocate(sizeof(T) * nCount, alignof(T));
+	}
+
+	sMark GetMark() const { return sMark{ m_nBlock, m_nOffset, m_nUsedBefore }; }
+	// Frees everything allocated after the mark was taken
+	void Rewind(const sMark& mark);
+	void Reset();
+
+	size_t GetUsedBytes() const { return m_nUsedBefore + m_nOffset; }
+	sArenaStats GetStats() const;
+
+private:
+	struct sBlock {
+		char* pData;
+		size_t nSize;
+	};
+
+	void* AllocateSlow(size_t nBytes, size_t nAlignment);
+	// The peak is only taken before memory is handed back, which keeps
+	// it out of Allocate
+	void UpdatePeak();
+
+private:
+	size_t m_nBlockSize;
+	vector<sBlock> m_aBlocks;
+	size_t m_nBlock = 0;
+	size_t m_nOffset = 0;
+	// Size of the blocks before the current one
+	size_t m_nUsedBefore = 0;
+	sArenaStats m_stats;
+};
+
+inline void* cArena::Allocate(size_t nBytes, size_t nAlignment)
+{
+	if (m_nBlock < m_aBlocks.size()) {
+		const sBlock& block = m_aBlocks[m_nBlock];
+		size_t nStart = (m_nOffset + nAlignment - 1) & ~(nAlignment - 1);
+
+		if (nStart + nBytes <= block.nSize) {
+			m_nOffset = nStart + nBytes;
+			m_stats.nAllocations++;
+			return block.pData + nStart;
+		}
+	}
+
+	return AllocateSlow(nBytes, nAlignment);
+}
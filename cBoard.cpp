@@ -0,0 +1,292 @@
+#include <algorithm>
+
+#include "cBoard.h"
+#include "cTableFile.h"
+
+// Section names in table files, change them when the rules change
+static const char* s_sRowLeftName = "board.rowleft.1";
+static const char* s_sRowRightName = "board.rowright.1";
+
+static cTableFile s_tableFile;
+
+bool cBoard::s_bTablesReady = false;
+const uint32_t* cBoard::s_pRowLeft = nullptr;
+const uint32_t* cBoard::s_pRowRight = nullptr;
+uint32_t cBoard::s_aRowLeft[cBoard::ROW_COUNT];
+uint32_t cBoard::s_aRowRight[cBoard::ROW_COUNT];
+
+/**
+ * Precalculates the result and the score of every possible row, or maps
+ * them from a table file which holds the tables of GetTables
+ *
+ * Returns false if the file could not be used, the tables are built in
+ * memory then.
+ */
+bool cBoard::InitTables(const char* sTableFile)
+{
+	if (s_bTablesReady)
+		return true;
+
+	if (sTableFile != nullptr && s_tableFile.Open(sTableFile)) {
+		s_pRowLeft = (const uint32_t*)s_tableFile.Find(s_sRowLeftName, sizeof(s_aRowLeft));
+		s_pRowRight = (const uint32_t*)s_tableFile.Find(s_sRowRightName, sizeof(s_aRowRight));
+
+		if (s_pRowLeft != nullptr && s_pRowRight != nullptr) {
+			s_bTablesReady = true;
+			return true;
+		}
+		s_tableFile.Close();
+	}
+
+	for (int nRow = 0; nRow < ROW_COUNT; nRow++) {
+		int nScore = 0;
+		row_t nResult = MoveRowLeft((row_t)nRow, nScore);
+		s_aRowLeft[nRow] = nResult | ((uint32_t)(nScore >> 2) << 16);
+	}
+
+	// Moving right is moving the mirrored row left
+	for (int nRow = 0; nRow < ROW_COUNT; nRow++) {
+		uint32_t nEntry = s_aRowLeft[ReverseRow((row_t)nRow)];
+		s_aRowRight[nRow] = ReverseRow((row_t)nEntry) | (nEntry & 0xFFFF0000);
+	}
+
+	s_pRowLeft = s_aRowLeft;
+	s_pRowRight = s_aRowRight;
+	s_bTablesReady = true;
+	return sTableFile == nullptr;
+}
+
+/**
+ * Adds the move tables to a list of tables for cTableFile::Write
+ */
+void cBoard::GetTables(vector<sTableData>& aTables)
+{
+	InitTables();
+
+	aTables.push_back({ s_sRowLeftName, s_pRowLeft, sizeof(s_aRowLeft) });
+	aTables.push_back({ s_sRowRightName, s_pRowRight, sizeof(s_aRowRight) });
+}
+
+bool cBoard::AreTablesMapped()
+{
+	return s_tableFile.IsOpen();
+}
+
+/**
+ * Moves and combines a single row to the left
+ *
+ * Same rules as the interactive game: every tile merges at most once
+ * per move and a merge beyond 2048 leaves an empty cell behind.
+ */
+row_t cBoard::MoveRowLeft(row_t nRow, int& nScore)
+{
+	int aLine[4];
+	int aResult[4] = { 0, 0, 0, 0 };
+
+	for (int x = 0; x < 4; x++)
+		aLine[x] = (nRow >> (x * 4)) & 0xF;
+
+	int nTarget = 0;
+	bool bCanMerge = false;
+
+	for (int x = 0; x < 4; x++) {
+		if (aLine[x] == 0)
+			continue;
+
+		if (bCanMerge && aResult[nTarget - 1] == aLine[x]) {
+			aResult[nTarget - 1]++;
+			nScore += 1 << min(aResult[nTarget - 1], 15);
+			bCanMerge = false;
+		}
+		else {
+			aResult[nTarget++] = aLine[x];
+			bCanMerge = true;
+		}
+	}
+
+	row_t nReturn = 0;
+	for (int x = 0; x < 4; x++) {
+		// Explode tiles which got too big
+		if (aResult[x] > MAX_EXPONENT)
+			aResult[x] = 0;
+
+		nReturn |= (row_t)(aResult[x] << (x * 4));
+	}
+
+	return nReturn;
+}
+
+/**
+ * Moves and combines all cells in the given direction
+ *
+ * nScore receives the sum of all merged tiles
+ */
+board_t cBoard::Move(board_t nBoard, ROTATION nDir, int& nScore)
+{
+	nScore = 0;
+
+	bool bColumns = (nDir == TOP || nDir == DOWN);
+	const uint32_t* pTable = (nDir == RIGHT || nDir == DOWN) ? s_pRowRight : s_pRowLeft;
+
+	if (bColumns)
+		nBoard = Transpose(nBoard);
+
+	board_t nResult = 0;
+	uint32_t nQuarterScore = 0;
+	for (int y = 0; y < 4; y++) {
+		uint32_t nEntry = pTable[(row_t)(nBoard >> (y * 16))];
+		nResult |= (board_t)(row_t)nEntry << (y * 16);
+		nQuarterScore += nEntry >> 16;
+	}
+
+	nScore = (int)(nQuarterScore << 2);
+	return bColumns ? Transpose(nResult) : nResult;
+}
+
+/**
+ * Same result as Move, but also tells where every tile goes, for the
+ * animation. Cell k of line l is the k-th cell from the side the tiles
+ * move to.
+ *
+ * Returns true if the board changes
+ */
+bool cBoard::PlanMove(board_t nBoard, ROTATION nDir, sMovePlan& plan)
+{
+	auto getCellIndex = [nDir](int l, int k) -> int {
+		switch (nDir) {
+		case LEFT:
+			return l * 4 + k;
+		case RIGHT:
+			return l * 4 + 3 - k;
+		case TOP:
+			return k * 4 + l;
+		default:
+			return (3 - k) * 4 + l;
+		}
+	};
+
+	plan.nDir = nDir;
+	plan.nBoard = nBoard;
+	plan.nResult = 0;
+	plan.nScore = 0;
+	plan.nMergedMask = 0;
+	plan.nExplodedMask = 0;
+	plan.nCount = 0;
+
+	for (int l = 0; l < 4; l++) {
+		int nTarget = -1;
+		int nTargetExponent = 0;
+		bool bCanMerge = false;
+
+		for (int k = 0; k < 4; k++) {
+			int nFrom = getCellIndex(l, k);
+			int nExponent = GetExponent(nBoard, nFrom);
+			if (nExponent == 0)
+				continue;
+
+			bool bMerged = bCanMerge && nExponent == nTargetExponent;
+			if (bMerged) {
+				bCanMerge = false;
+			}
+			else {
+				nTarget++;
+				nTargetExponent = nExponent;
+				bCanMerge = true;
+			}
+
+			int nTo = getCellIndex(l, nTarget);
+			if (nTo != nFrom)
+				plan.aMoves[plan.nCount++] = sTileMove{ (uint8_t)nFrom, (uint8_t)nTo, bMerged };
+
+			if (!bMerged) {
+				plan.nResult |= (board_t)nExponent << (nTo * 4);
+				continue;
+			}
+
+			// Tiles which grow beyond 2048 explode
+			plan.nScore += 1 << min(nExponent + 1, 15);
+			if (nExponent + 1 > MAX_EXPONENT) {
+				plan.nResult &= ~(0xFULL << (nTo * 4));
+				plan.nExplodedMask |= 1u << nTo;
+			}
+			else {
+				plan.nResult += 1ULL << (nTo * 4);
+				plan.nMergedMask |= 1u << nTo;
+			}
+		}
+	}
+
+	return plan.HasMoved();
+}
+
+/**
+ * Returns true if at least one direction changes the board
+ */
+bool cBoard::CanMove(board_t nBoard)
+{
+	return Move(nBoard, LEFT) != nBoard || Move(nBoard, RIGHT) != nBoard
+		|| Move(nBoard, TOP) != nBoard || Move(nBoard, DOWN) != nBoard;
+}
+
+int cBoard::ExponentFromValue(int nValue)
+{
+	int nExponent = 0;
+	while (nValue > 1) {
+		nValue >>= 1;
+		nExponent++;
+	}
+	return nExponent;
+}
+
+/**
+ * Counts the empty cells without looking at every cell
+ */
+int cBoard::CountEmpty(board_t nBoard)
+{
+	// Fold every 4 bit cell into its lowest bit which is set if the cell is empty
+	board_t x = ~nBoard;
+	x &= x >> 2;
+	x &= x >> 1;
+	x &= 0x1111111111111111ULL;
+
+	// Sum up those bits
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+/**
+ * Lists every board which can result from spawning a new number,
+ * 90% it is a 2 and 10% it is a 4.
+ *
+ * Returns the number of entries written to aSpawns
+ */
+int cBoard::GetSpawns(board_t nBoard, sSpawn aSpawns[MAX_SPAWNS])
+{
+	uint32_t nMask = GetEmptyMask(nBoard);
+	if (nMask == 0)
+		return 0;
+
+	float fCellProbability = 1.0f / CountBits(nMask);
+	int nCount = 0;
+
+	while (nMask != 0) {
+		int nShift = LowestBit(nMask) * 4;
+		nMask &= nMask - 1;
+
+		aSpawns[nCount++] = { nBoard | (1ULL << nShift), 0.9f * fCellProbability };
+		aSpawns[nCount++] = { nBoard | (2ULL << nShift), 0.1f * fCellProbability };
+	}
+
+	return nCount;
+}
+
+int cBoard::GetMaxExponent(board_t nBoard)
+{
+	int nMax = 0;
+	for (int i = 0; i < 16; i++) {
+		int nExponent = GetExponent(nBoard, i);
+		if (nExponent > nMax)
+			nMax = nExponent;
+	}
+	return nMax;
+}
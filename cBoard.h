@@ -0,0 +1,331 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define BOARD_HAS_PDEP
+#endif
+
+enum ROTATION {
+	LEFT = 0,
+	TOP = 90,
+	RIGHT = 180,
+	DOWN = 270
+};
+
+// Complete 4x4 board, one 4 bit exponent per cell
+typedef uint64_t board_t;
+
+// Single row of the board, one 4 bit exponent per cell
+typedef uint16_t row_t;
+
+struct sTableData;
+
+// One possible outcome of spawning a new number
+struct sSpawn {
+	board_t nBoard;
+	float fProbability;
+};
+
+// A tile which changes its cell in a move. bMerged is set if it merges
+// into the tile which got to nTo before it
+struct sTileMove {
+	uint8_t nFrom;
+	uint8_t nTo;
+	bool bMerged;
+};
+
+/**
+ * Everything one move does, worked out in a single pass
+ *
+ * Tiles which stay where they are have no entry. A cell is in
+ * nMergedMask if two tiles merged into it and in nExplodedMask instead
+ * if the merged tile exploded.
+ */
+struct sMovePlan {
+	ROTATION nDir;
+	board_t nBoard;		// before the move
+	board_t nResult;	// after the move, before the new tile
+	int nScore;
+	uint32_t nMergedMask;
+	uint32_t nExplodedMask;
+	int nCount;
+	sTileMove aMoves[16];
+
+	bool HasMoved() const { return nResult != nBoard; }
+};
+
+/**
+ * Platform independent game logic of 2048
+ *
+ * The board is packed into one 64 bit integer. Every cell holds the
+ * exponent of its value (0 = empty, 1 = 2, 2 = 4, ..., 11 = 2048).
+ * Cell index y * 4 + x is stored in bits (y * 4 + x) * 4, so every row
+ * is a 16 bit value and a move is four lookups into precomputed tables.
+ * Column moves are done by transposing the board. A table entry holds
+ * the moved row in its low 16 bits and a quarter of the score in its
+ * high 16 bits (scores are always multiples of 4).
+ *
+ * Tiles which would grow beyond 2048 explode, which means the merged
+ * cell is cleared instead of holding 4096.
+ */
+class cBoard
+{
+public:
+	static const int MAX_EXPONENT = 11;
+	static const int ROW_COUNT = 65536;
+	static const int MAX_SPAWNS = 32;
+	static const int SYMMETRY_COUNT = 8;
+
+public:
+	// Must be called once before any move is done. Without a file
+	// the tables are built in memory
+	static bool InitTables(const char* sTableFile = nullptr);
+	static void GetTables(vector<sTableData>& aTables);
+	static bool AreTablesMapped();
+
+	static board_t Move(board_t nBoard, ROTATION nDir);
+	static board_t Move(board_t nBoard, ROTATION nDir, int& nScore);
+	static bool PlanMove(board_t nBoard, ROTATION nDir, sMovePlan& plan);
+	static bool CanMove(board_t nBoard);
+
+	static board_t Transpose(board_t nBoard);
+	static row_t ReverseRow(row_t nRow);
+
+	// Symmetry s transposes if bit 2 is set, then mirrors left to right
+	// if bit 0 is set and top to bottom if bit 1 is set
+	static board_t MirrorLeftRight(board_t nBoard);
+	static board_t MirrorTopBottom(board_t nBoard);
+	static void GetSymmetries(board_t nBoard, board_t aBoards[SYMMETRY_COUNT]);
+	static board_t ApplySymmetry(board_t nBoard, int nSymmetry);
+	static ROTATION ApplySymmetry(ROTATION nDir, int nSymmetry);
+	static int InvertSymmetry(int nSymmetry);
+	static board_t Canonicalize(board_t nBoard);
+	static board_t Canonicalize(board_t nBoard, int& nSymmetry);
+
+	static int GetExponent(board_t nBoard, int nCellIndex);
+	static board_t SetExponent(board_t nBoard, int nCellIndex, int nExponent);
+	static int GetValue(board_t nBoard, int nCellIndex);
+	static int ExponentFromValue(int nValue);
+	static int CountEmpty(board_t nBoard);
+	static int GetMaxExponent(board_t nBoard);
+
+	static uint32_t GetEmptyMask(board_t nBoard);
+	static board_t AddTile(board_t nBoard, int nEmptyIndex, int nExponent);
+	static int GetSpawns(board_t nBoard, sSpawn aSpawns[MAX_SPAWNS]);
+
+	static int CountBits(uint32_t nMask);
+	static int LowestBit(uint32_t nMask);
+	static int SelectBit(uint32_t nMask, int nIndex);
+
+private:
+	static row_t MoveRowLeft(row_t nRow, int& nScore);
+
+private:
+	friend class cBoardSimd;
+
+	static bool s_bTablesReady;
+	static const uint32_t* s_pRowLeft;
+	static const uint32_t* s_pRowRight;
+
+	// Used when the tables are not mapped from a file
+	static uint32_t s_aRowLeft[ROW_COUNT];
+	static uint32_t s_aRowRight[ROW_COUNT];
+};
+
+inline board_t cBoard::Transpose(board_t nBoard)
+{
+	// Swap the 4 bit cells inside every 2x2 block
+	board_t a1 = nBoard & 0xF0F00F0FF0F00F0FULL;
+	board_t a2 = nBoard & 0x0000F0F00000F0F0ULL;
+	board_t a3 = nBoard & 0x0F0F00000F0F0000ULL;
+	board_t a = a1 | (a2 << 12) | (a3 >> 12);
+
+	// Swap the 2x2 blocks
+	board_t b1 = a & 0xFF00FF0000FF00FFULL;
+	board_t b2 = a & 0x00FF00FF00000000ULL;
+	board_t b3 = a & 0x00000000FF00FF00ULL;
+	return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+inline row_t cBoard::ReverseRow(row_t nRow)
+{
+	return (row_t)((nRow >> 12) | ((nRow >> 4) & 0x00F0) | ((nRow << 4) & 0x0F00) | (nRow << 12));
+}
+
+inline board_t cBoard::MirrorLeftRight(board_t nBoard)
+{
+	return ((nBoard & 0x000F000F000F000FULL) << 12) | ((nBoard & 0x00F000F000F000F0ULL) << 4)
+		| ((nBoard >> 4) & 0x00F000F000F000F0ULL) | ((nBoard >> 12) & 0x000F000F000F000FULL);
+}
+
+inline board_t cBoard::MirrorTopBottom(board_t nBoard)
+{
+	return (nBoard >> 48) | ((nBoard >> 16) & 0xFFFF0000ULL) | ((nBoard << 16) & 0xFFFF00000000ULL) | (nBoard << 48);
+}
+
+/**
+ * All 8 symmetries of a board, indexed by symmetry
+ */
+inline void cBoard::GetSymmetries(board_t nBoard, board_t aBoards[SYMMETRY_COUNT])
+{
+	for (int t = 0; t < 2; t++) {
+		board_t b = (t == 0) ? nBoard : Transpose(nBoard);
+		board_t m = MirrorLeftRight(b);
+
+		aBoards[t * 4 + 0] = b;
+		aBoards[t * 4 + 1] = m;
+		aBoards[t * 4 + 2] = MirrorTopBottom(b);
+		aBoards[t * 4 + 3] = MirrorTopBottom(m);
+	}
+}
+
+inline board_t cBoard::ApplySymmetry(board_t nBoard, int nSymmetry)
+{
+	if (nSymmetry & 4)
+		nBoard = Transpose(nBoard);
+	if (nSymmetry & 1)
+		nBoard = MirrorLeftRight(nBoard);
+	if (nSymmetry & 2)
+		nBoard = MirrorTopBottom(nBoard);
+	return nBoard;
+}
+
+/**
+ * The move on the transformed board which does the same as nDir on the
+ * original board
+ */
+inline ROTATION cBoard::ApplySymmetry(ROTATION nDir, int nSymmetry)
+{
+	if (nSymmetry & 4)
+		nDir = (nDir == LEFT) ? TOP : (nDir == TOP) ? LEFT : (nDir == RIGHT) ? DOWN : RIGHT;
+	if ((nSymmetry & 1) && (nDir == LEFT || nDir == RIGHT))
+		nDir = (nDir == LEFT) ? RIGHT : LEFT;
+	if ((nSymmetry & 2) && (nDir == TOP || nDir == DOWN))
+		nDir = (nDir == TOP) ? DOWN : TOP;
+	return nDir;
+}
+
+/**
+ * Transposing swaps what the two mirrors do, so their bits swap too
+ */
+inline int cBoard::InvertSymmetry(int nSymmetry)
+{
+	if (nSymmetry & 4)
+		return 4 | ((nSymmetry & 1) << 1) | ((nSymmetry >> 1) & 1);
+	return nSymmetry;
+}
+
+/**
+ * The smallest of the 8 symmetric boards, which is the same for all of them
+ */
+inline board_t cBoard::Canonicalize(board_t nBoard)
+{
+	int nSymmetry;
+	return Canonicalize(nBoard, nSymmetry);
+}
+
+inline board_t cBoard::Canonicalize(board_t nBoard, int& nSymmetry)
+{
+	board_t aBoards[SYMMETRY_COUNT];
+	GetSymmetries(nBoard, aBoards);
+
+	nSymmetry = 0;
+	for (int i = 1; i < SYMMETRY_COUNT; i++) {
+		if (aBoards[i] < aBoards[nSymmetry])
+			nSymmetry = i;
+	}
+
+	return aBoards[nSymmetry];
+}
+
+inline int cBoard::GetExponent(board_t nBoard, int nCellIndex)
+{
+	return (int)((nBoard >> (nCellIndex * 4)) & 0xF);
+}
+
+inline board_t cBoard::SetExponent(board_t nBoard, int nCellIndex, int nExponent)
+{
+	int nShift = nCellIndex * 4;
+	return (nBoard & ~(0xFULL << nShift)) | ((board_t)nExponent << nShift);
+}
+
+inline int cBoard::GetValue(board_t nBoard, int nCellIndex)
+{
+	int nExponent = GetExponent(nBoard, nCellIndex);
+	return nExponent == 0 ? 0 : 1 << nExponent;
+}
+
+/**
+ * Returns a 16 bit mask with bit i set if cell i is empty
+ */
+inline uint32_t cBoard::GetEmptyMask(board_t nBoard)
+{
+	// Fold every 4 bit cell into its lowest bit which is set if the cell is empty
+	board_t x = ~nBoard;
+	x &= x >> 2;
+	x &= x >> 1;
+	x &= 0x1111111111111111ULL;
+
+	// Pack the bits which are 4 apart next to each other
+	x = (x | (x >> 3)) & 0x0303030303030303ULL;
+	x = (x | (x >> 6)) & 0x000F000F000F000FULL;
+	x = (x | (x >> 12)) & 0x000000FF000000FFULL;
+	x = (x | (x >> 24)) & 0xFFFFULL;
+	return (uint32_t)x;
+}
+
+/**
+ * Places a tile into the nEmptyIndex-th empty cell
+ */
+inline board_t cBoard::AddTile(board_t nBoard, int nEmptyIndex, int nExponent)
+{
+	int nCellIndex = SelectBit(GetEmptyMask(nBoard), nEmptyIndex);
+	return nBoard | ((board_t)nExponent << (nCellIndex * 4));
+}
+
+inline int cBoard::CountBits(uint32_t nMask)
+{
+#if defined(_MSC_VER)
+	return (int)__popcnt(nMask);
+#else
+	return __builtin_popcount(nMask);
+#endif
+}
+
+inline int cBoard::LowestBit(uint32_t nMask)
+{
+#if defined(_MSC_VER)
+	unsigned long nIndex;
+	_BitScanForward(&nIndex, nMask);
+	return (int)nIndex;
+#else
+	return __builtin_ctz(nMask);
+#endif
+}
+
+/**
+ * Returns the position of the nIndex-th set bit of nMask
+ */
+inline int cBoard::SelectBit(uint32_t nMask, int nIndex)
+{
+#ifdef BOARD_HAS_PDEP
+	return LowestBit(_pdep_u32(1u << nIndex, nMask));
+#else
+	while (nIndex-- > 0)
+		nMask &= nMask - 1;
+	return LowestBit(nMask);
+#endif
+}
+
+inline board_t cBoard::Move(board_t nBoard, ROTATION nDir)
+{
+	int nScore = 0;
+	return Move(nBoard, nDir, nScore);
+}
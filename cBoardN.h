@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+using namespace std;
+
+#include "cBoard.h"
+
+#if defined(__SIZEOF_INT128__)
+#define BOARD_HAS_INT128
+#endif
+
+/**
+ * Board storage in one integer, 4 bits per cell
+ */
+template<typename T>
+struct sBoardBitsInt {
+	typedef T bits_t;
+
+	static int Get(const bits_t& nBits, int nCell) { return (int)(nBits >> (nCell * 4)) & 0xF; }
+	static void Or(bits_t& nBits, int nCell, int nExponent) { nBits |= (bits_t)nExponent << (nCell * 4); }
+	static void Clear(bits_t& nBits) { nBits = 0; }
+};
+
+/**
+ * Board storage in an array of 64 bit words, 16 cells per word
+ */
+template<int nWords>
+struct sBoardBitsArray {
+	struct bits_t {
+		uint64_t aWords[nWords];
+
+		bool operator==(const bits_t& other) const
+		{
+			for (int i = 0; i < nWords; i++) {
+				if (aWords[i] != other.aWords[i])
+					return false;
+			}
+			return true;
+		}
+		bool operator!=(const bits_t& other) const { return !(*this == other); }
+	};
+
+	static int Get(const bits_t& bits, int nCell) { return (int)(bits.aWords[nCell >> 4] >> ((nCell & 15) * 4)) & 0xF; }
+	static void Or(bits_t& bits, int nCell, int nExponent) { bits.aWords[nCell >> 4] |= (uint64_t)nExponent << ((nCell & 15) * 4); }
+	static void Clear(bits_t& bits) { fill(bits.aWords, bits.aWords + nWords, 0); }
+};
+
+// The smallest storage for nCells cells: uint64_t up to 4x4, __int128
+// up to 32 cells where the compiler has it, an array above that
+template<int nCells>
+struct sBoardBits {
+#ifdef BOARD_HAS_INT128
+	typedef typename conditional<nCells <= 16, sBoardBitsInt<uint64_t>,
+		typename conditional<nCells <= 32, sBoardBitsInt<unsigned __int128>, sBoardBitsArray<(nCells + 15) / 16>>::type>::type type;
+#else
+	typedef typename conditional<nCells <= 16, sBoardBitsInt<uint64_t>, sBoardBitsArray<(nCells + 15) / 16>>::type type;
+#endif
+};
+
+/**
+ * Moves and combines a line of L cells towards its first cell
+ *
+ * Lines of up to 4 cells are looked up in a table with the moved line
+ * in the low 16 bits and a quarter of the score in the high 16 bits,
+ * same as cBoard. Longer lines are merged directly.
+ */
+template<int L>
+struct sBoardLine {
+	static const bool HAS_TABLE = L <= 4;
+	static const int TABLE_SIZE = HAS_TABLE ? 1 << (L * 4) : 1;
+
+	static void InitTable();
+	static int Move(int aLine[L]);
+	static int Merge(int aLine[L]);
+
+	static bool s_bTableReady;
+	static uint32_t s_aTable[TABLE_SIZE];
+};
+
+template<int L>
+bool sBoardLine<L>::s_bTableReady = false;
+
+template<int L>
+uint32_t sBoardLine<L>::s_aTable[sBoardLine<L>::TABLE_SIZE];
+
+template<int L>
+void sBoardLine<L>::InitTable()
+{
+	if (!HAS_TABLE || s_bTableReady)
+		return;
+
+	for (int nKey = 0; nKey < TABLE_SIZE; nKey++) {
+		int aLine[L];
+		for (int k = 0; k < L; k++)
+			aLine[k] = (nKey >> (k * 4)) & 0xF;
+
+		uint32_t nEntry = (uint32_t)(Merge(aLine) >> 2) << 16;
+		for (int k = 0; k < L; k++)
+			nEntry |= (uint32_t)aLine[k] << (k * 4);
+
+		s_aTable[nKey] = nEntry;
+	}
+
+	s_bTableReady = true;
+}
+
+/**
+ * Same rules as cBoard: every tile merges at most once per move and a
+ * merge beyond 2048 leaves an empty cell behind
+ */
+template<int L>
+int sBoardLine<L>::Merge(int aLine[L])
+{
+	int aResult[L] = { 0 };
+	int nTarget = 0;
+	int nScore = 0;
+	bool bCanMerge = false;
+
+	for (int k = 0; k < L; k++) {
+		if (aLine[k] == 0)
+			continue;
+
+		if (bCanMerge && aResult[nTarget - 1] == aLine[k]) {
+			aResult[nTarget - 1]++;
+			nScore += 1 << min(aResult[nTarget - 1], 15);
+			bCanMerge = false;
+		}
+		else {
+			aResult[nTarget++] = aLine[k];
+			bCanMerge = true;
+		}
+	}
+
+	// Explode tiles which got too big
+	for (int k = 0; k < L; k++)
+		aLine[k] = aResult[k] > cBoard::MAX_EXPONENT ? 0 : aResult[k];
+
+	return nScore;
+}
+
+template<int L>
+inline int sBoardLine<L>::Move(int aLine[L])
+{
+	if (!HAS_TABLE)
+		return Merge(aLine);
+
+	int nKey = 0;
+	for (int k = 0; k < L; k++)
+		nKey |= aLine[k] << (k * 4);
+
+	uint32_t nEntry = s_aTable[nKey];
+	for (int k = 0; k < L; k++)
+		aLine[k] = (nEntry >> (k * 4)) & 0xF;
+
+	return (int)(nEntry >> 16) << 2;
+}
+
+/**
+ * Game logic of 2048 for boards of any size
+ *
+ * Same rules as cBoard, which stays the fast path for 4x4. Cell x, y
+ * has the index y * W + x and holds a 4 bit exponent. Width and height
+ * are known at compile time, so the storage is as small as possible and
+ * all loops over lines and cells have fixed bounds and get unrolled.
+ */
+template<int W, int H>
+class cBoardN
+{
+public:
+	static const int WIDTH = W;
+	static const int HEIGHT = H;
+	static const int CELL_COUNT = W * H;
+
+	typedef typename sBoardBits<CELL_COUNT>::type storage_t;
+	typedef typename storage_t::bits_t bits_t;
+
+	static_assert(W >= 2 && H >= 2 && CELL_COUNT <= 64, "board size not supported");
+
+public:
+	// Must be called once before any move is done
+	static void InitTables()
+	{
+		sBoardLine<W>::InitTable();
+		sBoardLine<H>::InitTable();
+	}
+
+	static bits_t Empty()
+	{
+		bits_t nBoard;
+		storage_t::Clear(nBoard);
+		return nBoard;
+	}
+
+	static int GetExponent(const bits_t& nBoard, int x, int y) { return storage_t::Get(nBoard, y * W + x); }
+	static bits_t Move(const bits_t& nBoard, ROTATION nDir, int& nScore);
+	static bool CanMove(const bits_t& nBoard);
+	static int CountEmpty(const bits_t& nBoard);
+	static int GetMaxExponent(const bits_t& nBoard);
+	static bits_t AddTile(const bits_t& nBoard, int nEmptyIndex, int nExponent);
+
+private:
+	template<bool bColumns, bool bReverse>
+	static int MoveLines(const bits_t& nBoard, bits_t& nResult);
+};
+
+/**
+ * Moves every row (or column) as a line which starts at the side the
+ * tiles move to
+ */
+template<int W, int H>
+template<bool bColumns, bool bReverse>
+inline int cBoardN<W, H>::MoveLines(const bits_t& nBoard, bits_t& nResult)
+{
+	static const int LINE_COUNT = bColumns ? W : H;
+	static const int LINE_LENGTH = bColumns ? H : W;
+
+	int nScore = 0;
+	for (int nLine = 0; nLine < LINE_COUNT; nLine++) {
+		int aCells[LINE_LENGTH];
+		int aLine[LINE_LENGTH];
+
+		for (int k = 0; k < LINE_LENGTH; k++) {
+			int nPos = bReverse ? LINE_LENGTH - 1 - k : k;
+			aCells[k] = bColumns ? nPos * W + nLine : nLine * W + nPos;
+			aLine[k] = storage_t::Get(nBoard, aCells[k]);
+		}
+
+		nScore += sBoardLine<LINE_LENGTH>::Move(aLine);
+
+		for (int k = 0; k < LINE_LENGTH; k++)
+			storage_t::Or(nResult, aCells[k], aLine[k]);
+	}
+
+	return nScore;
+}
+
+template<int W, int H>
+typename cBoardN<W, H>::bits_t cBoardN<W, H>::Move(const bits_t& nBoard, ROTATION nDir, int& nScore)
+{
+	bits_t nResult = Empty();
+
+	switch (nDir) {
+	case LEFT:
+		nScore = MoveLines<false, false>(nBoard, nResult);
+		break;
+
+	case RIGHT:
+		nScore = MoveLines<false, true>(nBoard, nResult);
+		break;
+
+	case TOP:
+		nScore = MoveLines<true, false>(nBoard, nResult);
+		break;
+
+	default:
+		nScore = MoveLines<true, true>(nBoard, nResult);
+		break;
+	}
+
+	return nResult;
+}
+
+template<int W, int H>
+bool cBoardN<W, H>::CanMove(const bits_t& nBoard)
+{
+	for (int y = 0; y < H; y++) {
+		for (int x = 0; x < W; x++) {
+			int nExponent = GetExponent(nBoard, x, y);
+			if (nExponent == 0)
+				return true;
+			if (x + 1 < W && GetExponent(nBoard, x + 1, y) == nExponent)
+				return true;
+			if (y + 1 < H && GetExponent(nBoard, x, y + 1) == nExponent)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+template<int W, int H>
+int cBoardN<W, H>::CountEmpty(const bits_t& nBoard)
+{
+	int nCount = 0;
+	for (int i = 0; i < CELL_COUNT; i++)
+		nCount += storage_t::Get(nBoard, i) == 0;
+
+	return nCount;
+}
+
+template<int W, int H>
+int cBoardN<W, H>::GetMaxExponent(const bits_t& nBoard)
+{
+	int nMax = 0;
+	for (int i = 0; i < CELL_COUNT; i++)
+		nMax = max(nMax, storage_t::Get(nBoard, i));
+
+	return nMax;
+}
+
+/**
+ * Puts a tile into the nEmptyIndex-th empty cell
+ */
+template<int W, int H>
+typename cBoardN<W, H>::bits_t cBoardN<W, H>::AddTile(const bits_t& nBoard, int nEmptyIndex, int nExponent)
+{
+	bits_t nResult = nBoard;
+	for (int i = 0; i < CELL_COUNT; i++) {
+		if (storage_t::Get(nBoard, i) == 0 && nEmptyIndex-- == 0) {
+			storage_t::Or(nResult, i, nExponent);
+			break;
+		}
+	}
+
+	return nResult;
+}
+
+// 4x4 uses the bitboard tables of cBoard
+
+template<>
+inline void cBoardN<4, 4>::InitTables()
+{
+	cBoard::InitTables();
+}
+
+template<>
+inline cBoardN<4, 4>::bits_t cBoardN<4, 4>::Move(const bits_t& nBoard, ROTATION nDir, int& nScore)
+{
+	return cBoard::Move(nBoard, nDir, nScore);
+}
+
+template<>
+inline bool cBoardN<4, 4>::CanMove(const bits_t& nBoard)
+{
+	return cBoard::CanMove(nBoard);
+}
+
+template<>
+inline int cBoardN<4, 4>::CountEmpty(const bits_t& nBoard)
+{
+	return cBoard::CountEmpty(nBoard);
+}
+
+template<>
+inline cBoardN<4, 4>::bits_t cBoardN<4, 4>::AddTile(const bits_t& nBoard, int nEmptyIndex, int nExponent)
+{
+	return cBoard::AddTile(nBoard, nEmptyIndex, nExponent);
+}
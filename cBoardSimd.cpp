@@ -0,0 +1,235 @@
+#include "cBoardSimd.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BOARD_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only allow the intrinsics in functions built for that
+// instruction set, MSVC allows them everywhere
+#if defined(_MSC_VER)
+#define TARGET_SSE4
+#define TARGET_AVX2
+#else
+#define TARGET_SSE4 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+cBoardSimd::PATH cBoardSimd::s_nPath = cBoardSimd::GetBestPath();
+
+cBoardSimd::PATH cBoardSimd::GetBestPath()
+{
+#if defined(BOARD_SIMD_X86) && defined(_MSC_VER)
+	int aInfo[4];
+	__cpuid(aInfo, 0);
+	int nMaxLeaf = aInfo[0];
+
+	__cpuid(aInfo, 1);
+	bool bSse4 = (aInfo[2] & (1 << 19)) != 0;
+	bool bOsAvx = (aInfo[2] & (1 << 27)) != 0 && (aInfo[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+
+	bool bAvx2 = false;
+	if (nMaxLeaf >= 7 && bOsAvx) {
+		__cpuidex(aInfo, 7, 0);
+		bAvx2 = (aInfo[1] & (1 << 5)) != 0;
+	}
+
+	if (bAvx2)
+		return PATH_AVX2;
+	if (bSse4)
+		return PATH_SSE4;
+#elif defined(BOARD_SIMD_X86)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return PATH_AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return PATH_SSE4;
+#endif
+
+	return PATH_SCALAR;
+}
+
+/**
+ * Selects a path, paths the CPU does not support fall back to the best one
+ */
+void cBoardSimd::SetPath(PATH nPath)
+{
+	PATH nBest = GetBestPath();
+	s_nPath = (nPath > nBest) ? nBest : nPath;
+}
+
+const char* cBoardSimd::GetPathName(PATH nPath)
+{
+	switch (nPath) {
+	case PATH_AVX2:
+		return "avx2";
+
+	case PATH_SSE4:
+		return "sse4";
+
+	default:
+		return "scalar";
+	}
+}
+
+uint32_t cBoardSimd::Move(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir)
+{
+	switch (s_nPath) {
+	case PATH_AVX2:
+		return MoveAvx2(aBoards, aResults, aScores, nCount, nDir);
+
+	case PATH_SSE4:
+		return MoveSse4(aBoards, aResults, aScores, nCount, nDir);
+
+	default:
+		return MoveScalar(aBoards, aResults, aScores, nCount, nDir);
+	}
+}
+
+uint32_t cBoardSimd::MoveScalar(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir)
+{
+	uint32_t nMoved = 0;
+
+	for (int i = 0; i < nCount; i++) {
+		aResults[i] = cBoard::Move(aBoards[i], nDir, aScores[i]);
+		if (aResults[i] != aBoards[i])
+			nMoved |= 1u << i;
+	}
+
+	return nMoved;
+}
+
+#ifdef BOARD_SIMD_X86
+
+/**
+ * Same as cBoard::Transpose on both 64 bit lanes
+ */
+TARGET_SSE4 static inline __m128i Transpose2(__m128i x)
+{
+	__m128i a1 = _mm_and_si128(x, _mm_set1_epi64x((long long)0xF0F00F0FF0F00F0FULL));
+	__m128i a2 = _mm_and_si128(x, _mm_set1_epi64x((long long)0x0000F0F00000F0F0ULL));
+	__m128i a3 = _mm_and_si128(x, _mm_set1_epi64x((long long)0x0F0F00000F0F0000ULL));
+	__m128i a = _mm_or_si128(a1, _mm_or_si128(_mm_slli_epi64(a2, 12), _mm_srli_epi64(a3, 12)));
+
+	__m128i b1 = _mm_and_si128(a, _mm_set1_epi64x((long long)0xFF00FF0000FF00FFULL));
+	__m128i b2 = _mm_and_si128(a, _mm_set1_epi64x((long long)0x00FF00FF00000000ULL));
+	__m128i b3 = _mm_and_si128(a, _mm_set1_epi64x((long long)0x00000000FF00FF00ULL));
+	return _mm_or_si128(b1, _mm_or_si128(_mm_srli_epi64(b2, 24), _mm_slli_epi64(b3, 24)));
+}
+
+/**
+ * Same as cBoard::Transpose on all four 64 bit lanes
+ */
+TARGET_AVX2 static inline __m256i Transpose4(__m256i x)
+{
+	__m256i a1 = _mm256_and_si256(x, _mm256_set1_epi64x((long long)0xF0F00F0FF0F00F0FULL));
+	__m256i a2 = _mm256_and_si256(x, _mm256_set1_epi64x((long long)0x0000F0F00000F0F0ULL));
+	__m256i a3 = _mm256_and_si256(x, _mm256_set1_epi64x((long long)0x0F0F00000F0F0000ULL));
+	__m256i a = _mm256_or_si256(a1, _mm256_or_si256(_mm256_slli_epi64(a2, 12), _mm256_srli_epi64(a3, 12)));
+
+	__m256i b1 = _mm256_and_si256(a, _mm256_set1_epi64x((long long)0xFF00FF0000FF00FFULL));
+	__m256i b2 = _mm256_and_si256(a, _mm256_set1_epi64x((long long)0x00FF00FF00000000ULL));
+	__m256i b3 = _mm256_and_si256(a, _mm256_set1_epi64x((long long)0x00000000FF00FF00ULL));
+	return _mm256_or_si256(b1, _mm256_or_si256(_mm256_srli_epi64(b2, 24), _mm256_slli_epi64(b3, 24)));
+}
+
+TARGET_SSE4 uint32_t cBoardSimd::MoveSse4(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir)
+{
+	bool bColumns = (nDir == TOP || nDir == DOWN);
+	const uint32_t* pTable = (nDir == RIGHT || nDir == DOWN) ? cBoard::s_pRowRight : cBoard::s_pRowLeft;
+
+	uint32_t nMoved = 0;
+	int i = 0;
+
+	for (; i + 2 <= nCount; i += 2) {
+		__m128i vBoards = _mm_loadu_si128((const __m128i*)(aBoards + i));
+		__m128i vRows = bColumns ? Transpose2(vBoards) : vBoards;
+
+		// No gather before AVX2, so the 8 rows are looked up one by one
+		alignas(16) uint16_t aRows[8];
+		_mm_store_si128((__m128i*)aRows, vRows);
+
+		uint32_t aQuarterScore[2] = { 0, 0 };
+		for (int r = 0; r < 8; r++) {
+			uint32_t nEntry = pTable[aRows[r]];
+			aRows[r] = (uint16_t)nEntry;
+			aQuarterScore[r >> 2] += nEntry >> 16;
+		}
+
+		__m128i vResults = _mm_load_si128((const __m128i*)aRows);
+		if (bColumns)
+			vResults = Transpose2(vResults);
+
+		_mm_storeu_si128((__m128i*)(aResults + i), vResults);
+		aScores[i] = (int)(aQuarterScore[0] << 2);
+		aScores[i + 1] = (int)(aQuarterScore[1] << 2);
+
+		int nSame = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(vResults, vBoards)));
+		nMoved |= (uint32_t)(~nSame & 0x3) << i;
+	}
+
+	if (i < nCount)
+		nMoved |= MoveScalar(aBoards + i, aResults + i, aScores + i, nCount - i, nDir) << i;
+
+	return nMoved;
+}
+
+TARGET_AVX2 uint32_t cBoardSimd::MoveAvx2(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir)
+{
+	bool bColumns = (nDir == TOP || nDir == DOWN);
+	const int* pTable = (const int*)((nDir == RIGHT || nDir == DOWN) ? cBoard::s_pRowRight : cBoard::s_pRowLeft);
+
+	const __m256i vLowMask = _mm256_set1_epi32(0xFFFF);
+	const __m256i vEvenLanes = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+	uint32_t nMoved = 0;
+	int i = 0;
+
+	for (; i + 4 <= nCount; i += 4) {
+		__m256i vBoards = _mm256_loadu_si256((const __m256i*)(aBoards + i));
+		__m256i vRows = bColumns ? Transpose4(vBoards) : vBoards;
+
+		// Every 32 bit lane holds two rows, gather row 0 and 2 of
+		// every board first and then row 1 and 3
+		__m256i vEntries02 = _mm256_i32gather_epi32(pTable, _mm256_and_si256(vRows, vLowMask), 4);
+		__m256i vEntries13 = _mm256_i32gather_epi32(pTable, _mm256_srli_epi32(vRows, 16), 4);
+
+		__m256i vResults = _mm256_or_si256(_mm256_and_si256(vEntries02, vLowMask), _mm256_slli_epi32(vEntries13, 16));
+		if (bColumns)
+			vResults = Transpose4(vResults);
+
+		_mm256_storeu_si256((__m256i*)(aResults + i), vResults);
+
+		// Add up the four quarter scores of every board
+		__m256i vScores = _mm256_add_epi32(_mm256_srli_epi32(vEntries02, 16), _mm256_srli_epi32(vEntries13, 16));
+		vScores = _mm256_add_epi32(vScores, _mm256_srli_epi64(vScores, 32));
+		vScores = _mm256_permutevar8x32_epi32(vScores, vEvenLanes);
+		_mm_storeu_si128((__m128i*)(aScores + i), _mm_slli_epi32(_mm256_castsi256_si128(vScores), 2));
+
+		int nSame = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(vResults, vBoards)));
+		nMoved |= (uint32_t)(~nSame & 0xF) << i;
+	}
+
+	if (i < nCount)
+		nMoved |= MoveScalar(aBoards + i, aResults + i, aScores + i, nCount - i, nDir) << i;
+
+	return nMoved;
+}
+
+#else
+
+uint32_t cBoardSimd::MoveSse4(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir)
+{
+	return MoveScalar(aBoards, aResults, aScores, nCount, nDir);
+}
+
+uint32_t cBoardSimd::MoveAvx2(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir)
+{
+	return MoveScalar(aBoards, aResults, aScores, nCount, nDir);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "cBoard.h"
+
+/**
+ * Moves many boards at once
+ *
+ * The AVX2 path keeps 4 boards in one register, transposes them with
+ * 64 bit lane shifts and looks up all 16 rows with two gathers. The
+ * SSE4 path handles 2 boards per register and looks the rows up one by
+ * one. The scalar path is a plain loop over cBoard::Move. The fastest
+ * path the CPU supports is picked at runtime.
+ */
+class cBoardSimd
+{
+public:
+	enum PATH {
+		PATH_SCALAR,
+		PATH_SSE4,
+		PATH_AVX2
+	};
+
+	static const int MAX_BOARDS = 32;
+
+public:
+	static PATH GetBestPath();
+	static PATH GetPath() { return s_nPath; }
+	static void SetPath(PATH nPath);
+	static const char* GetPathName(PATH nPath);
+
+	// Moves nCount (up to 32) boards in the same direction. Returns a mask
+	// with bit i set if board i changed, aScores receives the merge scores
+	static uint32_t Move(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir);
+
+private:
+	static uint32_t MoveScalar(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir);
+	static uint32_t MoveSse4(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir);
+	static uint32_t MoveAvx2(const board_t* aBoards, board_t* aResults, int* aScores, int nCount, ROTATION nDir);
+
+private:
+	static PATH s_nPath;
+};
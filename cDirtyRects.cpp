@@ -0,0 +1,86 @@
+#include "cDirtyRects.h"
+
+static sDirtyRect GetUnion(const sDirtyRect& a, const sDirtyRect& b)
+{
+	return { min(a.x1, b.x1), min(a.y1, b.y1), max(a.x2, b.x2), max(a.y2, b.y2) };
+}
+
+// Cells in the union which neither rectangle covers
+static int GetWaste(const sDirtyRect& a, const sDirtyRect& b)
+{
+	int nOverlapX = max(0, min(a.x2, b.x2) - max(a.x1, b.x1));
+	int nOverlapY = max(0, min(a.y2, b.y2) - max(a.y1, b.y1));
+	return GetUnion(a, b).GetArea() - a.GetArea() - b.GetArea() + nOverlapX * nOverlapY;
+}
+
+static bool Contains(const sDirtyRect& a, const sDirtyRect& b)
+{
+	return a.x1 <= b.x1 && a.y1 <= b.y1 && a.x2 >= b.x2 && a.y2 >= b.y2;
+}
+
+cDirtyRects::cDirtyRects()
+{
+}
+
+void cDirtyRects::SetSize(int nWidth, int nHeight)
+{
+	m_nWidth = nWidth;
+	m_nHeight = nHeight;
+	m_nCount = 0;
+}
+
+void cDirtyRects::AddRect(int x1, int y1, int x2, int y2)
+{
+	sDirtyRect rect = { max(x1, 0), max(y1, 0), min(x2, m_nWidth), min(y2, m_nHeight) };
+	if (rect.x1 >= rect.x2 || rect.y1 >= rect.y2)
+		return;
+
+	// The others can hold it too
+	for (int i = m_nCount - 1; i >= 0; i--) {
+		if (Contains(m_aRects[i], rect))
+			return;
+	}
+
+	// A merged rectangle can merge with more of them
+	for (int i = 0; i < m_nCount; ) {
+		if (GetWaste(m_aRects[i], rect) == 0) {
+			rect = GetUnion(m_aRects[i], rect);
+			Remove(i);
+			i = 0;
+		}
+		else
+			i++;
+	}
+
+	m_aRects[m_nCount++] = rect;
+	if (m_nCount <= MAX_RECTS)
+		return;
+
+	int nBestA = 0, nBestB = 1, nBestWaste = -1;
+	for (int a = 0; a < m_nCount; a++) {
+		for (int b = a + 1; b < m_nCount; b++) {
+			int nWaste = GetWaste(m_aRects[a], m_aRects[b]);
+			if (nBestWaste < 0 || nWaste < nBestWaste) {
+				nBestA = a;
+				nBestB = b;
+				nBestWaste = nWaste;
+			}
+		}
+	}
+
+	m_aRects[nBestA] = GetUnion(m_aRects[nBestA], m_aRects[nBestB]);
+	Remove(nBestB);
+}
+
+void cDirtyRects::Remove(int nIndex)
+{
+	m_aRects[nIndex] = m_aRects[--m_nCount];
+}
+
+int cDirtyRects::GetArea() const
+{
+	int nArea = 0;
+	for (int i = 0; i < m_nCount; i++)
+		nArea += m_aRects[i].GetArea();
+	return nArea;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+using namespace std;
+
+// Cells x1 to x2 - 1 of the rows y1 to y2 - 1, like Fill takes them
+struct sDirtyRect {
+	int x1;
+	int y1;
+	int x2;
+	int y2;
+
+	int GetArea() const { return (x2 - x1) * (y2 - y1); }
+};
+
+/**
+ * The parts of a screen which were drawn to in a frame
+ *
+ * Add takes the rectangle of every draw call. Two rectangles are merged
+ * if their union covers no cell which neither of them does, and once
+ * there are more than MAX_RECTS the two are merged whose union adds the
+ * fewest cells. However big the screen, a frame ends with a handful of
+ * rectangles around what was drawn.
+ */
+class cDirtyRects
+{
+public:
+	static const int MAX_RECTS = 8;
+
+	cDirtyRects();
+
+	// Rectangles are clipped to the screen
+	void SetSize(int nWidth, int nHeight);
+
+	void Add(int x1, int y1, int x2, int y2)
+	{
+		// Most draws are inside the rectangle which was added or merged last
+		if (m_nCount > 0 && x1 >= m_aRects[m_nCount - 1].x1 && y1 >= m_aRects[m_nCount - 1].y1 &&
+			x2 <= m_aRects[m_nCount - 1].x2 && y2 <= m_aRects[m_nCount - 1].y2)
+			return;
+		AddRect(x1, y1, x2, y2);
+	}
+
+	void AddAll() { Add(0, 0, m_nWidth, m_nHeight); }
+	void Clear() { m_nCount = 0; }
+
+	/**
+	 * Adds the rows of the rectangles of dirty where aCells differs
+	 * from aLast, and copies them into aLast. Cells are anything with
+	 * the members of a CHAR_INFO.
+	 */
+	template<typename CELL>
+	void AddChanged(const cDirtyRects& dirty, const CELL* aCells, CELL* aLast);
+
+	bool IsEmpty() const { return m_nCount == 0; }
+	int GetCount() const { return m_nCount; }
+	const sDirtyRect* GetRects() const { return m_aRects; }
+	int GetArea() const;
+
+private:
+	void AddRect(int x1, int y1, int x2, int y2);
+	void Remove(int nIndex);
+
+private:
+	int m_nWidth = 0;
+	int m_nHeight = 0;
+	int m_nCount = 0;
+	sDirtyRect m_aRects[MAX_RECTS + 1];
+};
+
+template<typename CELL>
+void cDirtyRects::AddChanged(const cDirtyRects& dirty, const CELL* aCells, CELL* aLast)
+{
+	for (int r = 0; r < dirty.m_nCount; r++) {
+		const sDirtyRect& rect = dirty.m_aRects[r];
+
+		// Rows with changes in a row become one band with the columns of all of them
+		sDirtyRect band = { 0, -1, 0, -1 };
+		for (int y = rect.y1; y < rect.y2; y++) {
+			int nFirst = rect.x2, nLast = rect.x1 - 1;
+			for (int x = rect.x1; x < rect.x2; x++) {
+				const CELL& cell = aCells[y * m_nWidth + x];
+				CELL& last = aLast[y * m_nWidth + x];
+				if (cell.Char.UnicodeChar != last.Char.UnicodeChar || cell.Attributes != last.Attributes) {
+					nFirst = min(nFirst, x);
+					nLast = x;
+					last = cell;
+				}
+			}
+
+			if (nLast < nFirst) {
+				if (band.y1 >= 0)
+					Add(band.x1, band.y1, band.x2, band.y2);
+				band.y1 = -1;
+			}
+			else if (band.y1 < 0)
+				band = { nFirst, y, nLast + 1, y + 1 };
+			else
+				band = { min(band.x1, nFirst), band.y1, max(band.x2, nLast + 1), y + 1 };
+		}
+
+		if (band.y1 >= 0)
+			Add(band.x1, band.y1, band.x2, band.y2);
+	}
+}
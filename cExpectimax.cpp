@@ -0,0 +1,209 @@
+#include <chrono>
+
+#include "cExpectimax.h"
+
+static const ROTATION s_aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+void sSearchStats::Add(const sSearchStats& other)
+{
+	nNodes += other.nNodes;
+	table.Add(other.table);
+	tasks.Add(other.tasks);
+	arena.Add(other.arena);
+	fSeconds += other.fSeconds;
+}
+
+cExpectimax::cExpectimax(int nDepth, float fProbabilityCutoff, int nTableSizeMB)
+	: m_nDepth(nDepth), m_fProbabilityCutoff(fProbabilityCutoff), m_pHeuristic(&cHeuristic::GetDefault()),
+	m_pOwnTable(new cTranspositionTable(nTableSizeMB)), m_pTable(m_pOwnTable.get()), m_aWorkers(1)
+{
+}
+
+/**
+ * The shared table has to live longer than the search
+ */
+cExpectimax::cExpectimax(int nDepth, float fProbabilityCutoff, cTranspositionTable* pSharedTable)
+	: m_nDepth(nDepth), m_fProbabilityCutoff(fProbabilityCutoff), m_pHeuristic(&cHeuristic::GetDefault()),
+	m_pTable(pSharedTable), m_aWorkers(1)
+{
+}
+
+void cExpectimax::SetThreadCount(int nThreads)
+{
+	if (nThreads <= 0)
+		nThreads = max(1, (int)thread::hardware_concurrency());
+
+	m_aWorkers = vector<sWorker>(nThreads);
+	if (nThreads > 1)
+		m_pScheduler.reset(new cTaskScheduler(nThreads));
+	else
+		m_pScheduler.reset();
+}
+
+bool cExpectimax::ChooseMove(board_t nBoard, ROTATION& nMove)
+{
+	auto tp1 = chrono::steady_clock::now();
+
+	bool bFound = false;
+	float fBest = 0.0f;
+
+	m_pTable->NewSearch();
+	for (sWorker& worker : m_aWorkers)
+		worker.arena.Reset();
+
+	for (int d = 0; d < 4; d++) {
+		board_t nMoved = cBoard::Move(nBoard, s_aDirections[d]);
+		m_aRootLegal[d] = nMoved != nBoard;
+		m_aRootTasks[d] = sTaskData{ this, nMoved, m_nDepth - 1, 1.0f, 0.0f };
+	}
+
+	if (m_pScheduler)
+		m_pScheduler->Run(RunRoot, this);
+	else {
+		for (int d = 0; d < 4; d++) {
+			if (m_aRootLegal[d])
+				RunMoveTask(&m_aRootTasks[d], 0);
+		}
+	}
+
+	for (int d = 0; d < 4; d++) {
+		if (!m_aRootLegal[d])
+			continue;
+
+		float fValue = m_aRootTasks[d].fValue;
+		if (!bFound || fValue > fBest) {
+			bFound = true;
+			fBest = fValue;
+			nMove = s_aDirections[d];
+		}
+	}
+
+	m_stats.arena = sArenaStats();
+	for (sWorker& worker : m_aWorkers) {
+		m_stats.Add(worker.stats);
+		m_stats.arena.Add(worker.arena.GetStats());
+		worker.stats = sSearchStats();
+	}
+	if (m_pScheduler)
+		m_stats.tasks = m_pScheduler->GetStats();
+
+	auto tp2 = chrono::steady_clock::now();
+	m_stats.fSeconds += chrono::duration<double>(tp2 - tp1).count();
+
+	return bFound;
+}
+
+/**
+ * Value of a board where the player has to move
+ */
+float cExpectimax::SearchMove(board_t nBoard, int nDepth, float fProbability, int nWorker)
+{
+	m_aWorkers[nWorker].stats.nNodes++;
+
+	float fBest = 0.0f;
+
+	for (ROTATION nDir : s_aDirections) {
+		board_t nMoved = cBoard::Move(nBoard, nDir);
+		if (nMoved == nBoard)
+			continue;
+
+		float fValue = SearchSpawn(nMoved, nDepth - 1, fProbability, nWorker);
+		if (fValue > fBest)
+			fBest = fValue;
+	}
+
+	return fBest;
+}
+
+/**
+ * Value of a board where a new number is about to be spawned
+ */
+float cExpectimax::SearchSpawn(board_t nBoard, int nDepth, float fProbability, int nWorker)
+{
+	sWorker& worker = m_aWorkers[nWorker];
+	sSearchStats& stats = worker.stats;
+	stats.nNodes++;
+
+	if (nDepth <= 0 || fProbability < m_fProbabilityCutoff)
+		return Evaluate(nBoard);
+
+	// Evaluate and the spawns do not change under rotation or mirroring
+	board_t nKey = m_bSymmetricTable ? cBoard::Canonicalize(nBoard) : nBoard;
+
+	float fValue = 0.0f;
+	if (m_pTable->Probe(nKey, nDepth, fValue, stats.table) == cTranspositionTable::PROBE_HIT)
+		return fValue;
+
+	// Freed again before returning, like a stack frame
+	cArena::sMark mark = worker.arena.GetMark();
+	sSpawn* aSpawns = worker.arena.Allocate<sSpawn>(cBoard::MAX_SPAWNS);
+	int nSpawns = cBoard::GetSpawns(nBoard, aSpawns);
+	if (nSpawns == 0) {
+		worker.arena.Rewind(mark);
+		return SearchMove(nBoard, nDepth, fProbability, nWorker);
+	}
+
+	if (m_pScheduler && nDepth >= m_nSplitDepth)
+		fValue = ForkSpawns(aSpawns, nSpawns, nDepth, fProbability, nWorker);
+	else {
+		for (int i = 0; i < nSpawns; i++)
+			fValue += aSpawns[i].fProbability * SearchMove(aSpawns[i].nBoard, nDepth, fProbability * aSpawns[i].fProbability, nWorker);
+	}
+
+	m_pTable->Store(nKey, nDepth, fValue, stats.table);
+	worker.arena.Rewind(mark);
+
+	return fValue;
+}
+
+/**
+ * Searches every spawn as its own task and waits for all of them. The
+ * values are summed up in the same order as without threads.
+ */
+float cExpectimax::ForkSpawns(const sSpawn aSpawns[], int nSpawns, int nDepth, float fProbability, int nWorker)
+{
+	// Freed by the caller together with the spawns
+	sTaskData* aTasks = m_aWorkers[nWorker].arena.Allocate<sTaskData>(nSpawns);
+	atomic<int> nPending(nSpawns);
+
+	for (int i = 0; i < nSpawns; i++) {
+		aTasks[i] = sTaskData{ this, aSpawns[i].nBoard, nDepth, fProbability * aSpawns[i].fProbability, 0.0f };
+		m_pScheduler->Fork(nWorker, cTaskScheduler::sTask{ RunSpawnTask, &aTasks[i], &nPending });
+	}
+
+	m_pScheduler->Join(nWorker, nPending);
+
+	float fValue = 0.0f;
+	for (int i = 0; i < nSpawns; i++)
+		fValue += aSpawns[i].fProbability * aTasks[i].fValue;
+
+	return fValue;
+}
+
+void cExpectimax::RunRoot(void* pData, int nWorker)
+{
+	cExpectimax* pSearch = (cExpectimax*)pData;
+	atomic<int> nPending(0);
+
+	for (int d = 0; d < 4; d++) {
+		if (!pSearch->m_aRootLegal[d])
+			continue;
+
+		nPending++;
+		pSearch->m_pScheduler->Fork(nWorker, cTaskScheduler::sTask{ RunMoveTask, &pSearch->m_aRootTasks[d], &nPending });
+	}
+
+	pSearch->m_pScheduler->Join(nWorker, nPending);
+}
+
+void cExpectimax::RunMoveTask(void* pData, int nWorker)
+{
+	sTaskData* pTask = (sTaskData*)pData;
+	pTask->fValue = pTask->pSearch->SearchSpawn(pTask->nBoard, pTask->nDepth, pTask->fProbability, nWorker);
+}
+
+void cExpectimax::RunSpawnTask(void* pData, int nWorker)
+{
+	sTaskData* pTask = (sTaskData*)pData;
+	pTask->fValue = pTask->pSearch->SearchMove(pTask->nBoard, pTask->nDepth, pTask->fProbability, nWorker);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+using namespace std;
+
+#include "cArena.h"
+#include "cHeuristic.h"
+#include "cPlayer.h"
+#include "cTaskScheduler.h"
+#include "cTranspositionTable.h"
+
+struct sSearchStats {
+	long long nNodes = 0;
+	sTableStats table;
+	sSchedulerStats tasks;
+	sArenaStats arena;
+	double fSeconds = 0.0;
+
+	void Add(const sSearchStats& other);
+	double NodesPerSecond() const { return fSeconds > 0.0 ? nNodes / fSeconds : 0.0; }
+	double HitRate() const { return table.HitRate(); }
+};
+
+/**
+ * Expectimax search over the four moves and all possible spawns
+ *
+ * Max nodes pick the best move, chance nodes average over every empty
+ * cell getting a 2 (90%) or a 4 (10%). Leaves are scored by a cHeuristic,
+ * the default one unless another is set.
+ * The depth is the number of moves looked ahead, including the move
+ * which is chosen.
+ *
+ * Chance nodes are cached in a transposition table of fixed size, and
+ * branches which are less likely than the cutoff are not searched any
+ * deeper. The table is either owned by the search or shared with
+ * searches on other threads. A board and its 7 rotations and mirrors
+ * have the same value, so by default they share one canonical entry.
+ *
+ * With more than one thread the search forks the root moves and every
+ * chance node which is at least the split depth away from the leaves
+ * into tasks of a cTaskScheduler, one task per spawn. The subtrees of
+ * the four moves differ a lot in size, so idle threads steal the
+ * spawns of the big ones. All threads share the transposition table.
+ */
+class cExpectimax : public cPlayer
+{
+public:
+	cExpectimax(int nDepth = 3, float fProbabilityCutoff = 0.0001f, int nTableSizeMB = 16);
+	cExpectimax(int nDepth, float fProbabilityCutoff, cTranspositionTable* pSharedTable);
+	virtual bool ChooseMove(board_t nBoard, ROTATION& nMove);
+
+	void SetDepth(int nDepth) { m_nDepth = nDepth; }
+	int GetDepth() const { return m_nDepth; }
+	// 0 uses every core
+	void SetThreadCount(int nThreads);
+	int GetThreadCount() const { return (int)m_aWorkers.size(); }
+	void SetSplitDepth(int nSplitDepth) { m_nSplitDepth = nSplitDepth; }
+	void SetSymmetricTable(bool bSymmetric) { m_bSymmetricTable = bSymmetric; }
+	const sSearchStats& GetStats() const { return m_stats; }
+
+	// The heuristic has to live longer than the search
+	void SetHeuristic(const cHeuristic* pHeuristic) { m_pHeuristic = pHeuristic; }
+	float Evaluate(board_t nBoard) const { return m_pHeuristic->Evaluate(nBoard); }
+
+private:
+	// Aligned so two workers never write to the same cache line. The
+	// spawn lists and forked tasks of a worker live in its arena.
+	struct alignas(64) sWorker {
+		sSearchStats stats;
+		cArena arena;
+	};
+
+	struct sTaskData {
+		cExpectimax* pSearch;
+		board_t nBoard;
+		int nDepth;
+		float fProbability;
+		float fValue;
+	};
+
+	float SearchMove(board_t nBoard, int nDepth, float fProbability, int nWorker);
+	float SearchSpawn(board_t nBoard, int nDepth, float fProbability, int nWorker);
+	float ForkSpawns(const sSpawn aSpawns[], int nSpawns, int nDepth, float fProbability, int nWorker);
+
+	static void RunRoot(void* pData, int nWorker);
+	static void RunMoveTask(void* pData, int nWorker);
+	static void RunSpawnTask(void* pData, int nWorker);
+
+private:
+	int m_nDepth;
+	float m_fProbabilityCutoff;
+	const cHeuristic* m_pHeuristic;
+	int m_nSplitDepth = 2;
+	bool m_bSymmetricTable = true;
+	unique_ptr<cTranspositionTable> m_pOwnTable;	// only without a shared table
+	cTranspositionTable* m_pTable;
+	sSearchStats m_stats;
+
+	vector<sWorker> m_aWorkers;
+	unique_ptr<cTaskScheduler> m_pScheduler;
+
+	// Root of the current search
+	sTaskData m_aRootTasks[4];
+	bool m_aRootLegal[4];
+};
@@ -0,0 +1,64 @@
+#include "cGame.h"
+
+cGame::cGame(uint64_t nSeed)
+{
+	Reset(nSeed);
+}
+
+/**
+ * Resets the game to the beginning state
+ */
+void cGame::Reset(uint64_t nSeed)
+{
+	m_rng.Seed(nSeed);
+
+	m_nBoard = 0;
+	m_nScore = 0;
+	m_nMoveCount = 0;
+
+	// Add 2 numbers in random cells
+	AddNewNumber();
+	AddNewNumber();
+}
+
+/**
+ * Moves the board and adds a new number afterwards
+ *
+ * Returns false if the move did not change anything
+ */
+bool cGame::Move(ROTATION nDir)
+{
+	int nScore = 0;
+	board_t nBoard = cBoard::Move(m_nBoard, nDir, nScore);
+
+	if (nBoard == m_nBoard)
+		return false;
+
+	m_nBoard = nBoard;
+	m_nScore += nScore;
+	m_nMoveCount++;
+
+	AddNewNumber();
+	return true;
+}
+
+/**
+ * Adds a new number to a random empty cell
+ * 90% it should be a 2 and 10% it should be a 4
+ */
+void cGame::AddNewNumber()
+{
+	int nEmpty = cBoard::CountEmpty(m_nBoard);
+	if (nEmpty == 0)
+		return;
+
+	int nIndex = (int)m_rng.NextBelow(nEmpty);
+	int nExponent = (m_rng.NextBelow(10) == 0) ? 2 : 1;
+
+	m_nBoard = cBoard::AddTile(m_nBoard, nIndex, nExponent);
+}
+
+bool cGame::IsOver() const
+{
+	return !cBoard::CanMove(m_nBoard);
+}
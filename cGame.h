@@ -0,0 +1,32 @@
+#pragma once
+
+#include "cBoard.h"
+#include "cRandom.h"
+
+/**
+ * Headless game of 2048
+ *
+ * Same rules as c2048 but without any rendering or animation, so it can
+ * be used for simulations on any platform.
+ */
+class cGame
+{
+public:
+	cGame(uint64_t nSeed = 0);
+
+public:
+	void Reset(uint64_t nSeed);
+	bool Move(ROTATION nDir);
+	void AddNewNumber();
+	bool IsOver() const;
+
+	board_t GetBoard() const { return m_nBoard; }
+	int GetScore() const { return m_nScore; }
+	int GetMoveCount() const { return m_nMoveCount; }
+
+private:
+	board_t m_nBoard = 0;
+	int m_nScore = 0;
+	int m_nMoveCount = 0;
+	cRandom m_rng;
+};
@@ -0,0 +1,198 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "cHeuristic.h"
+
+struct sWeightName {
+	const char* sName;
+	float sHeuristicWeights::* pWeight;
+};
+
+static const sWeightName s_aWeightNames[] = {
+	{ "lost_penalty", &sHeuristicWeights::fLostPenalty },
+	{ "monotonicity_power", &sHeuristicWeights::fMonotonicityPower },
+	{ "monotonicity_weight", &sHeuristicWeights::fMonotonicityWeight },
+	{ "sum_power", &sHeuristicWeights::fSumPower },
+	{ "sum_weight", &sHeuristicWeights::fSumWeight },
+	{ "merges_weight", &sHeuristicWeights::fMergesWeight },
+	{ "empty_weight", &sHeuristicWeights::fEmptyWeight },
+};
+
+// Cells x, x + 4, x + 8 and x + 12 as one line, which is row x of the transposed board
+static row_t GetColumn(board_t nBoard, int x)
+{
+	board_t nColumn = (nBoard >> (x * 4)) & 0x000F000F000F000FULL;
+	return (row_t)(nColumn | (nColumn >> 12) | (nColumn >> 24) | (nColumn >> 36));
+}
+
+cHeuristic::cHeuristic(const sHeuristicWeights& weights)
+	: m_weights(weights), m_aFeatures(LINE_COUNT), m_aLineScores(LINE_COUNT)
+{
+	BuildFeatures();
+	BuildScores();
+}
+
+/**
+ * Only rebuilds the features if one of the powers changed
+ */
+void cHeuristic::SetWeights(const sHeuristicWeights& weights)
+{
+	bool bPowersChanged = weights.fMonotonicityPower != m_weights.fMonotonicityPower
+		|| weights.fSumPower != m_weights.fSumPower;
+
+	m_weights = weights;
+	if (bPowersChanged)
+		BuildFeatures();
+	BuildScores();
+}
+
+bool cHeuristic::LoadWeights(const char* sFileName)
+{
+	FILE* pFile = fopen(sFileName, "r");
+	if (pFile == nullptr)
+		return false;
+
+	sHeuristicWeights weights = m_weights;
+	bool bOk = true;
+
+	char sName[64];
+	float fValue;
+	int nFields;
+	while ((nFields = fscanf(pFile, "%63s %f", sName, &fValue)) == 2) {
+		bool bKnown = false;
+		for (const sWeightName& name : s_aWeightNames) {
+			if (strcmp(name.sName, sName) == 0) {
+				weights.*name.pWeight = fValue;
+				bKnown = true;
+			}
+		}
+		bOk &= bKnown;
+	}
+
+	bOk &= nFields == EOF;
+	fclose(pFile);
+
+	if (bOk)
+		SetWeights(weights);
+	return bOk;
+}
+
+bool cHeuristic::SaveWeights(const char* sFileName) const
+{
+	FILE* pFile = fopen(sFileName, "w");
+	if (pFile == nullptr)
+		return false;
+
+	for (const sWeightName& name : s_aWeightNames)
+		fprintf(pFile, "%s %.9g\n", name.sName, m_weights.*name.pWeight);
+
+	return fclose(pFile) == 0;
+}
+
+/**
+ * Empty cells and possible merges are rewarded, lines which are not
+ * monotonic and lots of big tiles are punished
+ */
+void cHeuristic::BuildFeatures()
+{
+	for (int nLine = 0; nLine < LINE_COUNT; nLine++) {
+		int aLine[4];
+		for (int x = 0; x < 4; x++)
+			aLine[x] = (nLine >> (x * 4)) & 0xF;
+
+		float fSum = 0.0f;
+		int nEmpty = 0;
+		int nMerges = 0;
+		int nPrev = 0;
+		int nCounter = 0;
+
+		for (int x = 0; x < 4; x++) {
+			fSum += powf((float)aLine[x], m_weights.fSumPower);
+
+			if (aLine[x] == 0) {
+				nEmpty++;
+				continue;
+			}
+
+			if (nPrev == aLine[x]) {
+				nCounter++;
+			}
+			else if (nCounter > 0) {
+				nMerges += 1 + nCounter;
+				nCounter = 0;
+			}
+			nPrev = aLine[x];
+		}
+		if (nCounter > 0)
+			nMerges += 1 + nCounter;
+
+		float fMonotonicityLeft = 0.0f;
+		float fMonotonicityRight = 0.0f;
+		for (int x = 1; x < 4; x++) {
+			float fPrev = powf((float)aLine[x - 1], m_weights.fMonotonicityPower);
+			float fCurrent = powf((float)aLine[x], m_weights.fMonotonicityPower);
+
+			if (aLine[x - 1] > aLine[x])
+				fMonotonicityLeft += fPrev - fCurrent;
+			else
+				fMonotonicityRight += fCurrent - fPrev;
+		}
+
+		sLineFeatures& features = m_aFeatures[nLine];
+		features.fEmpty = (float)nEmpty;
+		features.fMerges = (float)nMerges;
+		features.fMonotonicity = fminf(fMonotonicityLeft, fMonotonicityRight);
+		features.fSum = fSum;
+	}
+}
+
+void cHeuristic::BuildScores()
+{
+	const sHeuristicWeights& w = m_weights;
+
+	for (int nLine = 0; nLine < LINE_COUNT; nLine++) {
+		const sLineFeatures& features = m_aFeatures[nLine];
+		m_aLineScores[nLine] = w.fLostPenalty + w.fEmptyWeight * features.fEmpty + w.fMergesWeight * features.fMerges
+			- w.fMonotonicityWeight * features.fMonotonicity - w.fSumWeight * features.fSum;
+	}
+}
+
+float cHeuristic::Update(float fScore, board_t nOld, board_t nNew) const
+{
+	board_t nChanged = nOld ^ nNew;
+	if (nChanged == 0)
+		return fScore;
+
+	const float* pScores = m_aLineScores.data();
+
+	for (int y = 0; y < 4; y++) {
+		if ((row_t)(nChanged >> (y * 16)) != 0)
+			fScore += pScores[(row_t)(nNew >> (y * 16))] - pScores[(row_t)(nOld >> (y * 16))];
+	}
+
+	for (int x = 0; x < 4; x++) {
+		if (GetColumn(nChanged, x) != 0)
+			fScore += pScores[GetColumn(nNew, x)] - pScores[GetColumn(nOld, x)];
+	}
+
+	return fScore;
+}
+
+float cHeuristic::AddTile(float fScore, board_t nBoard, int nCellIndex, int nExponent) const
+{
+	const float* pScores = m_aLineScores.data();
+	board_t nNew = cBoard::SetExponent(nBoard, nCellIndex, nExponent);
+
+	int y = nCellIndex / 4;
+	int x = nCellIndex % 4;
+
+	return fScore + pScores[(row_t)(nNew >> (y * 16))] - pScores[(row_t)(nBoard >> (y * 16))]
+		+ pScores[GetColumn(nNew, x)] - pScores[GetColumn(nBoard, x)];
+}
+
+const cHeuristic& cHeuristic::GetDefault()
+{
+	static const cHeuristic heuristic;
+	return heuristic;
+}
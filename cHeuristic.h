@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "cBoard.h"
+
+struct sHeuristicWeights {
+	float fLostPenalty = 200000.0f;
+	float fMonotonicityPower = 4.0f;
+	float fMonotonicityWeight = 47.0f;
+	float fSumPower = 3.5f;
+	float fSumWeight = 11.0f;
+	float fMergesWeight = 700.0f;
+	float fEmptyWeight = 270.0f;
+};
+
+/**
+ * Board evaluation from precomputed line scores
+ *
+ * Every row and every column is scored on its own by the same rules,
+ * so one table with a score for each of the 65536 possible lines is
+ * enough and a board is worth the sum of 8 lookups: the 4 rows of the
+ * board and the 4 rows of its transpose.
+ *
+ * The table is built from per-line features (empty cells, merges,
+ * monotonicity and sum of the tiles). Changing the weights only
+ * combines the features again, which is fast; only a change of one of
+ * the powers has to compute the features again.
+ *
+ * The searches evaluate every board in full, which is 8 lookups and
+ * about 14 ns. Update and AddTile only look up the lines which changed
+ * and are kept for comparison in bench2048 heuristic; no search uses
+ * them.
+ */
+class cHeuristic
+{
+public:
+	static const int LINE_COUNT = 65536;
+
+public:
+	cHeuristic(const sHeuristicWeights& weights = sHeuristicWeights());
+
+	void SetWeights(const sHeuristicWeights& weights);
+	const sHeuristicWeights& GetWeights() const { return m_weights; }
+
+	// Weights as "name value" lines, missing names keep their value
+	bool LoadWeights(const char* sFileName);
+	bool SaveWeights(const char* sFileName) const;
+
+	float Evaluate(board_t nBoard) const;
+	float GetLineScore(row_t nLine) const { return m_aLineScores[nLine]; }
+
+	// The score after nOld became nNew, only lines which changed are
+	// looked up again
+	float Update(float fScore, board_t nOld, board_t nNew) const;
+	// The score after a tile was put into an empty cell
+	float AddTile(float fScore, board_t nBoard, int nCellIndex, int nExponent) const;
+
+	// Shared instance with the default weights
+	static const cHeuristic& GetDefault();
+
+private:
+	struct sLineFeatures {
+		float fEmpty;
+		float fMerges;
+		float fMonotonicity;
+		float fSum;
+	};
+
+	void BuildFeatures();
+	void BuildScores();
+
+private:
+	sHeuristicWeights m_weights;
+	vector<sLineFeatures> m_aFeatures;
+	vector<float> m_aLineScores;
+};
+
+inline float cHeuristic::Evaluate(board_t nBoard) const
+{
+	board_t nTransposed = cBoard::Transpose(nBoard);
+	const float* pScores = m_aLineScores.data();
+
+	return pScores[(row_t)nBoard] + pScores[(row_t)(nBoard >> 16)]
+		+ pScores[(row_t)(nBoard >> 32)] + pScores[(row_t)(nBoard >> 48)]
+		+ pScores[(row_t)nTransposed] + pScores[(row_t)(nTransposed >> 16)]
+		+ pScores[(row_t)(nTransposed >> 32)] + pScores[(row_t)(nTransposed >> 48)];
+}
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <chrono>
+
+#include "cHintWorker.h"
+
+static const uint64_t RESULT_HAS_MOVE = 1;
+static const uint64_t RESULT_DONE = 2;
+
+cHintWorker::cHintWorker(cTimeSlicedSearch& search) : m_search(search)
+{
+	m_thread = thread(&cHintWorker::WorkerThread, this);
+}
+
+cHintWorker::~cHintWorker()
+{
+	Post(REQUEST_EXIT, 0);
+	m_thread.join();
+}
+
+void cHintWorker::Search(board_t nBoard)
+{
+	Post(REQUEST_SEARCH, nBoard);
+}
+
+void cHintWorker::Prefetch(board_t nBoard)
+{
+	Post(REQUEST_PREFETCH, nBoard);
+}
+
+void cHintWorker::Cancel()
+{
+	Post(REQUEST_CANCEL, 0);
+}
+
+bool cHintWorker::GetResult(board_t nBoard, sHintResult& result) const
+{
+	uint64_t aResult[2];
+	m_results.Read(aResult);
+	if (aResult[0] != nBoard)
+		return false;
+
+	uint64_t nFlags = aResult[1] >> 32;
+	result.bHasMove = (nFlags & RESULT_HAS_MOVE) != 0;
+	result.nMove = (ROTATION)(aResult[1] & 0xFFFF);
+	result.nDepth = (int)((aResult[1] >> 16) & 0xFFFF);
+	result.bDone = (nFlags & RESULT_DONE) != 0;
+
+	return result.nDepth > 0 || result.bDone;
+}
+
+sHintWorkerStats cHintWorker::GetStats() const
+{
+	sHintWorkerStats stats;
+	stats.nSearches = m_nSearches.load(memory_order_relaxed);
+	stats.nPrefetched = m_nPrefetched.load(memory_order_relaxed);
+	stats.nPrefetchHits = m_nPrefetchHits.load(memory_order_relaxed);
+	stats.nCancelled = m_nCancelled.load(memory_order_relaxed);
+	return stats;
+}
+
+/**
+ * The wakeup is not under the mutex, a worker which just missed it
+ * looks at the mailbox again after at most 2 ms
+ */
+void cHintWorker::Post(REQUEST nRequest, board_t nBoard)
+{
+	uint64_t aRequest[2] = { nBoard, (uint64_t)nRequest };
+	m_requests.Post(aRequest);
+	m_cvWake.notify_one();
+}
+
+void cHintWorker::WorkerThread()
+{
+	while (true) {
+		uint64_t aRequest[2];
+		uint32_t nCount = m_requests.Read(aRequest);
+
+		if (nCount == m_nSeen) {
+			unique_lock<mutex> lock(m_muxWake);
+			m_cvWake.wait_for(lock, chrono::milliseconds(2), [&] { return m_requests.GetCount() != m_nSeen; });
+			continue;
+		}
+
+		m_nSeen = nCount;
+
+		switch ((REQUEST)aRequest[1]) {
+		case REQUEST_SEARCH:
+			RunSearch(aRequest[0]);
+			break;
+
+		case REQUEST_PREFETCH:
+			RunPrefetch(aRequest[0]);
+			break;
+
+		case REQUEST_EXIT:
+			return;
+
+		default:
+			break;
+		}
+	}
+}
+
+void cHintWorker::RunSearch(board_t nBoard)
+{
+	m_nSearches++;
+
+	for (const sCacheEntry& entry : m_aCache) {
+		if (entry.nBoard == nBoard) {
+			m_nPrefetchHits++;
+			Publish(nBoard, entry.result);
+			return;
+		}
+	}
+
+	bool bPublish = true;
+	sHintResult result;
+	SearchBoard(nBoard, bPublish, result);
+}
+
+/**
+ * Searches the spawns until the real board arrives. Spawns of the same
+ * tile are equally likely, so the 2s come first and the 4s last.
+ */
+void cHintWorker::RunPrefetch(board_t nBoard)
+{
+	m_aCache.clear();
+
+	sSpawn aSpawns[cBoard::MAX_SPAWNS];
+	int nSpawns = cBoard::GetSpawns(nBoard, aSpawns);
+	stable_sort(aSpawns, aSpawns + nSpawns, [](const sSpawn& a, const sSpawn& b) {
+		return a.fProbability > b.fProbability;
+	});
+
+	for (int i = 0; i < nSpawns; i++) {
+		if (m_requests.GetCount() != m_nSeen)
+			return;
+
+		bool bPublish = false;
+		sHintResult result;
+		if (!SearchBoard(aSpawns[i].nBoard, bPublish, result))
+			return;
+
+		// The search for this spawn came in and has been answered
+		if (bPublish)
+			return;
+
+		m_aCache.push_back({ aSpawns[i].nBoard, result });
+		m_nPrefetched++;
+	}
+}
+
+/**
+ * Returns false if a new request cancelled the search. A search for the
+ * board which is prefetched right now takes the prefetch over, which
+ * sets bPublish.
+ */
+bool cHintWorker::SearchBoard(board_t nBoard, bool& bPublish, sHintResult& result)
+{
+	m_search.Start(nBoard);
+
+	while (true) {
+		bool bDone = m_search.Step(SLICE_SECONDS);
+
+		if (bDone || m_search.GetCompletedDepth() > result.nDepth) {
+			result.bHasMove = m_search.GetBestMove(result.nMove);
+			result.nDepth = m_search.GetCompletedDepth();
+			result.bDone = bDone;
+
+			if (bPublish)
+				Publish(nBoard, result);
+		}
+
+		if (bDone)
+			return true;
+
+		if (m_requests.GetCount() == m_nSeen)
+			continue;
+
+		uint64_t aRequest[2];
+		uint32_t nCount = m_requests.Read(aRequest);
+
+		if (!bPublish && (REQUEST)aRequest[1] == REQUEST_SEARCH && aRequest[0] == nBoard) {
+			m_nSeen = nCount;
+			m_nSearches++;
+			m_nPrefetchHits++;
+			bPublish = true;
+
+			if (result.nDepth > 0)
+				Publish(nBoard, result);
+			continue;
+		}
+
+		m_search.Stop();
+		m_nCancelled++;
+		return false;
+	}
+}
+
+void cHintWorker::Publish(board_t nBoard, const sHintResult& result)
+{
+	uint64_t nFlags = (result.bHasMove ? RESULT_HAS_MOVE : 0) | (result.bDone ? RESULT_DONE : 0);
+	uint64_t aResult[2] = { nBoard, (uint64_t)result.nMove | ((uint64_t)result.nDepth << 16) | (nFlags << 32) };
+	m_results.Post(aResult);
+}
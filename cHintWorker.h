@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "cBoard.h"
+#include "cMailbox.h"
+#include "cTimeSlicedSearch.h"
+
+struct sHintResult {
+	bool bHasMove = false;
+	ROTATION nMove = LEFT;
+	int nDepth = 0;		// deepest completed iteration
+	bool bDone = false;	// the search reached its maximum depth
+};
+
+struct sHintWorkerStats {
+	long long nSearches = 0;
+	long long nPrefetched = 0;		// spawns searched ahead of time
+	long long nPrefetchHits = 0;	// searches answered by a prefetch
+	long long nCancelled = 0;
+};
+
+/**
+ * Runs a cTimeSlicedSearch on its own thread
+ *
+ * The game posts every new board with Search and picks up the result
+ * with GetResult once it needs the move, so it never waits for the
+ * search. While a move is still animating, Prefetch hands over the board
+ * before the spawn: the worker then searches the boards of the possible
+ * spawns, most likely first, and answers the Search for the spawn which
+ * really happens from its cache, or carries on if it is searching that
+ * very board right now.
+ *
+ * Requests and results go through lock free mailboxes. A new request
+ * replaces the old one, and the search looks for it after every slice
+ * of SLICE_SECONDS, so a stale search stops right away.
+ */
+class cHintWorker
+{
+public:
+	static constexpr float SLICE_SECONDS = 0.001f;
+
+public:
+	// The worker uses the search exclusively until it is destroyed
+	cHintWorker(cTimeSlicedSearch& search);
+	~cHintWorker();
+
+	void Search(board_t nBoard);
+	// nBoard is the board after the move, before the new tile
+	void Prefetch(board_t nBoard);
+	void Cancel();
+
+	// The latest result for nBoard, false while there is none yet
+	bool GetResult(board_t nBoard, sHintResult& result) const;
+	sHintWorkerStats GetStats() const;
+
+private:
+	enum REQUEST {
+		REQUEST_CANCEL,
+		REQUEST_SEARCH,
+		REQUEST_PREFETCH,
+		REQUEST_EXIT
+	};
+
+	struct sCacheEntry {
+		board_t nBoard;
+		sHintResult result;
+	};
+
+	void Post(REQUEST nRequest, board_t nBoard);
+	void WorkerThread();
+	void RunSearch(board_t nBoard);
+	void RunPrefetch(board_t nBoard);
+	bool SearchBoard(board_t nBoard, bool& bPublish, sHintResult& result);
+	void Publish(board_t nBoard, const sHintResult& result);
+
+private:
+	cTimeSlicedSearch& m_search;
+
+	// Words: board, request
+	cMailbox<2> m_requests;
+	// Words: board, move | depth << 16 | flags << 32
+	cMailbox<2> m_results;
+
+	// Only wakes the idle worker, the requests never wait for it
+	mutex m_muxWake;
+	condition_variable m_cvWake;
+
+	// Only used by the worker thread
+	uint32_t m_nSeen = 0;
+	vector<sCacheEntry> m_aCache;
+
+	atomic<long long> m_nSearches{ 0 };
+	atomic<long long> m_nPrefetched{ 0 };
+	atomic<long long> m_nPrefetchHits{ 0 };
+	atomic<long long> m_nCancelled{ 0 };
+
+	thread m_thread;
+};
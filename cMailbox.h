@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+using namespace std;
+
+/**
+ * Lock free mailbox for one writer which keeps only the latest message
+ *
+ * A message is WORDS 64 bit words behind a sequence lock: the writer
+ * makes the sequence odd, writes the words and makes it even again. A
+ * reader retries if the sequence was odd or changed while it read the
+ * words. Posting never waits and a message which was not read yet is
+ * simply replaced, which is what a game wants for boards and results.
+ */
+template <int WORDS>
+class cMailbox
+{
+public:
+	void Post(const uint64_t aMessage[WORDS])
+	{
+		uint32_t nSequence = m_nSequence.load(memory_order_relaxed);
+		m_nSequence.store(nSequence + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+
+		for (int i = 0; i < WORDS; i++)
+			m_aWords[i].store(aMessage[i], memory_order_relaxed);
+
+		m_nSequence.store(nSequence + 2, memory_order_release);
+	}
+
+	// Copies the latest message and returns its number, 0 if nothing
+	// has been posted yet
+	uint32_t Read(uint64_t aMessage[WORDS]) const
+	{
+		while (true) {
+			uint32_t nBefore = m_nSequence.load(memory_order_acquire);
+			if ((nBefore & 1) == 0) {
+				for (int i = 0; i < WORDS; i++)
+					aMessage[i] = m_aWords[i].load(memory_order_relaxed);
+
+				atomic_thread_fence(memory_order_acquire);
+				if (m_nSequence.load(memory_order_relaxed) == nBefore)
+					return nBefore / 2;
+			}
+
+			// The writer may have been preempted in the middle of Post
+			this_thread::yield();
+		}
+	}
+
+	// Number of the latest message, without reading it
+	uint32_t GetCount() const { return m_nSequence.load(memory_order_acquire) / 2; }
+
+private:
+	atomic<uint32_t> m_nSequence{ 0 };
+	atomic<uint64_t> m_aWords[WORDS] = {};
+};
@@ -0,0 +1,248 @@
+#include <chrono>
+
+#include "cBoardSimd.h"
+#include "cMonteCarlo.h"
+
+static const ROTATION s_aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+void sRolloutStats::Add(const sRolloutStats& other)
+{
+	nRollouts += other.nRollouts;
+	nMoves += other.nMoves;
+	fSeconds += other.fSeconds;
+}
+
+/**
+ * Worker 0 is the calling thread itself, so only nThreads - 1
+ * additional threads are started
+ */
+cMonteCarlo::cMonteCarlo(int nRollouts, int nThreads, METRIC nMetric)
+	: m_nRollouts(nRollouts), m_nMetric(nMetric)
+{
+	if (nThreads <= 0)
+		nThreads = max(1, (int)thread::hardware_concurrency());
+
+	m_aWorkers.resize(nThreads);
+	NewGame(0);
+
+	for (int i = 1; i < nThreads; i++)
+		m_aThreads.push_back(thread(&cMonteCarlo::WorkerThread, this, i));
+}
+
+cMonteCarlo::~cMonteCarlo()
+{
+	{
+		unique_lock<mutex> lock(m_muxJob);
+		m_bExit = true;
+	}
+	m_cvJobStart.notify_all();
+
+	for (thread& t : m_aThreads)
+		t.join();
+}
+
+/**
+ * Gives every worker its own random number stream
+ */
+void cMonteCarlo::NewGame(uint64_t nSeed)
+{
+	cRandom rng(nSeed);
+
+	for (sWorker& worker : m_aWorkers)
+		worker.rng = rng.Split();
+}
+
+bool cMonteCarlo::ChooseMove(board_t nBoard, ROTATION& nMove)
+{
+	auto tp1 = chrono::steady_clock::now();
+
+	bool bAnyLegal = false;
+	for (int d = 0; d < 4; d++) {
+		m_aMoveScores[d] = 0;
+		m_aAfterstates[d] = cBoard::Move(nBoard, s_aDirections[d], m_aMoveScores[d]);
+		m_aIsLegal[d] = m_aAfterstates[d] != nBoard;
+		bAnyLegal |= m_aIsLegal[d];
+	}
+
+	if (!bAnyLegal)
+		return false;
+
+	// Wake up the pool and do our own share
+	{
+		unique_lock<mutex> lock(m_muxJob);
+		m_nJobsPending = (int)m_aThreads.size();
+		m_nJobGeneration++;
+	}
+	m_cvJobStart.notify_all();
+
+	RunRollouts(0);
+
+	{
+		unique_lock<mutex> lock(m_muxJob);
+		m_cvJobDone.wait(lock, [this] { return m_nJobsPending == 0; });
+	}
+
+	// Sum up the results of all workers
+	double fBest = -1.0;
+	for (int d = 0; d < 4; d++) {
+		if (!m_aIsLegal[d])
+			continue;
+
+		double fSum = 0.0;
+		for (const sWorker& worker : m_aWorkers)
+			fSum += worker.aSum[d];
+
+		if (fSum > fBest) {
+			fBest = fSum;
+			nMove = s_aDirections[d];
+		}
+	}
+
+	for (const sWorker& worker : m_aWorkers) {
+		m_stats.nRollouts += worker.nRollouts;
+		m_stats.nMoves += worker.nMoves;
+	}
+
+	auto tp2 = chrono::steady_clock::now();
+	m_stats.fSeconds += chrono::duration<double>(tp2 - tp1).count();
+
+	return true;
+}
+
+void cMonteCarlo::WorkerThread(int nWorker)
+{
+	int nGeneration = 0;
+
+	while (true) {
+		{
+			unique_lock<mutex> lock(m_muxJob);
+			m_cvJobStart.wait(lock, [&] { return m_bExit || m_nJobGeneration != nGeneration; });
+
+			if (m_bExit)
+				return;
+
+			nGeneration = m_nJobGeneration;
+		}
+
+		RunRollouts(nWorker);
+
+		{
+			unique_lock<mutex> lock(m_muxJob);
+			m_nJobsPending--;
+		}
+		m_cvJobDone.notify_one();
+	}
+}
+
+/**
+ * Plays this worker's share of the random games for every legal move
+ *
+ * The games run in lockstep batches. Every step the running games are
+ * grouped by the direction they try first, and each group is moved at
+ * once by cBoardSimd. Games which could not move that way try the other
+ * directions one by one. Finished games are swapped to the end.
+ */
+void cMonteCarlo::RunRollouts(int nWorker)
+{
+	sWorker& worker = m_aWorkers[nWorker];
+	int nWorkers = (int)m_aWorkers.size();
+	int nCount = m_nRollouts / nWorkers + (nWorker < m_nRollouts % nWorkers ? 1 : 0);
+
+	cRandom rng = worker.rng;
+	long long nTotalMoves = 0;
+
+	board_t aBoards[BATCH_SIZE];
+	int aScores[BATCH_SIZE];
+	int aMoves[BATCH_SIZE];
+	uint64_t aRandom[BATCH_SIZE];
+	bool aMoved[BATCH_SIZE];
+
+	// Games grouped by their first direction
+	int aGroupSize[4];
+	int aGroupGames[4][BATCH_SIZE];
+	board_t aGroupBoards[4][BATCH_SIZE];
+	board_t aGroupResults[4][BATCH_SIZE];
+	int aGroupScores[4][BATCH_SIZE];
+
+	for (int d = 0; d < 4; d++) {
+		worker.aSum[d] = 0.0;
+		if (!m_aIsLegal[d])
+			continue;
+
+		double fSum = 0.0;
+		for (int r = 0; r < nCount; r += BATCH_SIZE) {
+			int nActive = min(BATCH_SIZE, nCount - r);
+			for (int i = 0; i < nActive; i++) {
+				aBoards[i] = m_aAfterstates[d];
+				aScores[i] = m_aMoveScores[d];
+				aMoves[i] = 0;
+			}
+
+			while (nActive > 0) {
+				for (int k = 0; k < 4; k++)
+					aGroupSize[k] = 0;
+
+				// Bits 32-63 pick the cell, bits 8-31 the value, bits 0-1 the first direction
+				for (int i = 0; i < nActive; i++) {
+					uint64_t nRandom = rng.Next();
+					int nEmpty = cBoard::CountEmpty(aBoards[i]);
+					int nExponent = ((nRandom >> 8) & 0xFFFFFF) < 0x199999 ? 2 : 1;
+					aBoards[i] = cBoard::AddTile(aBoards[i], (int)(((nRandom >> 32) * nEmpty) >> 32), nExponent);
+
+					int nFirst = (int)(nRandom & 3);
+					aGroupGames[nFirst][aGroupSize[nFirst]] = i;
+					aGroupBoards[nFirst][aGroupSize[nFirst]] = aBoards[i];
+					aGroupSize[nFirst]++;
+					aRandom[i] = nRandom;
+				}
+
+				for (int k = 0; k < 4; k++) {
+					uint32_t nMovedMask = cBoardSimd::Move(aGroupBoards[k], aGroupResults[k], aGroupScores[k], aGroupSize[k], s_aDirections[k]);
+
+					for (int n = 0; n < aGroupSize[k]; n++) {
+						int i = aGroupGames[k][n];
+						aMoved[i] = (nMovedMask & (1u << n)) != 0;
+						if (aMoved[i]) {
+							aBoards[i] = aGroupResults[k][n];
+							aScores[i] += aGroupScores[k][n];
+						}
+					}
+				}
+
+				// Going backwards, so the game swapped in was already handled
+				for (int i = nActive - 1; i >= 0; i--) {
+					for (int k = 1; k < 4 && !aMoved[i]; k++) {
+						int nMoveScore = 0;
+						board_t nMoved = cBoard::Move(aBoards[i], s_aDirections[(aRandom[i] + k) & 3], nMoveScore);
+						if (nMoved != aBoards[i]) {
+							aBoards[i] = nMoved;
+							aScores[i] += nMoveScore;
+							aMoved[i] = true;
+						}
+					}
+
+					if (aMoved[i]) {
+						aMoves[i]++;
+						continue;
+					}
+
+					fSum += (m_nMetric == METRIC_SCORE) ? aScores[i] : aMoves[i];
+					nTotalMoves += aMoves[i];
+
+					nActive--;
+					aBoards[i] = aBoards[nActive];
+					aScores[i] = aScores[nActive];
+					aMoves[i] = aMoves[nActive];
+					aRandom[i] = aRandom[nActive];
+					aMoved[i] = aMoved[nActive];
+				}
+			}
+		}
+
+		worker.aSum[d] = fSum;
+	}
+
+	worker.rng = rng;
+	worker.nRollouts = (long long)nCount * (m_aIsLegal[0] + m_aIsLegal[1] + m_aIsLegal[2] + m_aIsLegal[3]);
+	worker.nMoves = nTotalMoves;
+}
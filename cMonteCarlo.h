@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "cPlayer.h"
+#include "cRandom.h"
+
+struct sRolloutStats {
+	long long nRollouts = 0;
+	long long nMoves = 0;
+	double fSeconds = 0.0;
+
+	void Add(const sRolloutStats& other);
+	double RolloutsPerSecond() const { return fSeconds > 0.0 ? nRollouts / fSeconds : 0.0; }
+};
+
+/**
+ * Monte Carlo player
+ *
+ * For every possible move a number of random games is played until
+ * the game is over, and the move with the best average score (or the
+ * most moves survived) wins. The rollouts are split over a pool of
+ * worker threads. Every worker has its own random number generator and
+ * result slot, so nothing is shared while the rollouts are running.
+ * Every worker plays its games in lockstep batches of BATCH_SIZE boards.
+ */
+class cMonteCarlo : public cPlayer
+{
+public:
+	enum METRIC {
+		METRIC_SCORE,
+		METRIC_DEPTH
+	};
+
+	static const int BATCH_SIZE = 32;
+
+public:
+	cMonteCarlo(int nRollouts = 1000, int nThreads = 0, METRIC nMetric = METRIC_SCORE);
+	~cMonteCarlo();
+
+	virtual bool ChooseMove(board_t nBoard, ROTATION& nMove);
+	virtual void NewGame(uint64_t nSeed);
+
+	const sRolloutStats& GetStats() const { return m_stats; }
+	int GetThreadCount() const { return (int)m_aWorkers.size(); }
+
+private:
+	// Aligned so two workers never write to the same cache line
+	struct alignas(64) sWorker {
+		cRandom rng;
+		double aSum[4];
+		long long nRollouts;
+		long long nMoves;
+	};
+
+	void WorkerThread(int nWorker);
+	void RunRollouts(int nWorker);
+
+private:
+	int m_nRollouts;
+	METRIC m_nMetric;
+	vector<sWorker> m_aWorkers;
+	vector<thread> m_aThreads;
+	sRolloutStats m_stats;
+
+	// Current job, only written while all workers are waiting
+	board_t m_aAfterstates[4];
+	int m_aMoveScores[4];
+	bool m_aIsLegal[4];
+
+	mutex m_muxJob;
+	condition_variable m_cvJobStart;
+	condition_variable m_cvJobDone;
+	int m_nJobGeneration = 0;
+	int m_nJobsPending = 0;
+	bool m_bExit = false;
+};
@@ -0,0 +1,213 @@
+#include <algorithm>
+
+#include "cNTuple.h"
+
+static const ROTATION s_aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+// Cell indices of the tuples, y * 4 + x
+static const int s_aTuples[cNTuple::TUPLE_COUNT][cNTuple::TUPLE_SIZE] = {
+	{ 0, 1, 2, 3, 4, 5 },
+	{ 4, 5, 6, 7, 8, 9 },
+	{ 0, 1, 2, 4, 5, 6 },
+	{ 4, 5, 6, 8, 9, 10 }
+};
+
+// Section name in table files, holds the tuple layout
+static const char* s_sWeightsName = "ntuple.4x6x12";
+// Holds the number of games trained, older files do not have it
+static const char* s_sGamesName = "ntuple.games";
+
+cNTuple::cNTuple()
+{
+}
+
+/**
+ * Sets all weights to 0, which is where training starts
+ */
+void cNTuple::Clear()
+{
+	m_file.Close();
+	m_aWeights.assign((size_t)TUPLE_COUNT * TUPLE_ENTRIES, 0.0f);
+	m_pWeights = m_aWeights.data();
+	m_nTrainedGames = 0;
+}
+
+bool cNTuple::ChooseMove(board_t nBoard, ROTATION& nMove)
+{
+	board_t nAfterstate;
+	int nScore;
+	float fValue;
+	return ChooseAfterstate(nBoard, nMove, nAfterstate, nScore, fValue);
+}
+
+bool cNTuple::ChooseAfterstate(board_t nBoard, ROTATION& nMove, board_t& nAfterstate, int& nScore, float& fValue) const
+{
+	bool bFound = false;
+	float fBest = 0.0f;
+
+	for (ROTATION nDir : s_aDirections) {
+		int nMoveScore = 0;
+		board_t nMoved = cBoard::Move(nBoard, nDir, nMoveScore);
+		if (nMoved == nBoard)
+			continue;
+
+		float fMoveValue = Evaluate(nMoved);
+		float fTotal = nMoveScore + fMoveValue;
+		if (!bFound || fTotal > fBest) {
+			bFound = true;
+			fBest = fTotal;
+			nMove = nDir;
+			nAfterstate = nMoved;
+			nScore = nMoveScore;
+			fValue = fMoveValue;
+		}
+	}
+
+	return bFound;
+}
+
+inline int cNTuple::GetIndex(board_t nBoard, int nTuple)
+{
+	int nIndex = 0;
+	for (int k = TUPLE_SIZE - 1; k >= 0; k--)
+		nIndex = nIndex * VALUE_COUNT + (int)((nBoard >> (s_aTuples[nTuple][k] * 4)) & 0xF);
+
+	return nTuple * TUPLE_ENTRIES + nIndex;
+}
+
+float cNTuple::Evaluate(board_t nBoard) const
+{
+	if (m_pWeights == nullptr)
+		return 0.0f;
+
+	board_t aBoards[cBoard::SYMMETRY_COUNT];
+	cBoard::GetSymmetries(nBoard, aBoards);
+
+	const float* pWeights = m_pWeights;
+	float fValue = 0.0f;
+	for (board_t b : aBoards) {
+		for (int t = 0; t < TUPLE_COUNT; t++)
+			fValue += pWeights[GetIndex(b, t)];
+	}
+
+	return fValue;
+}
+
+/**
+ * Adds fDelta to every weight the board uses
+ *
+ * No locking, several threads may update at the same time. Mapped
+ * weights are read only and not changed.
+ */
+void cNTuple::Update(board_t nBoard, float fDelta)
+{
+	if (m_aWeights.empty())
+		return;
+
+	board_t aBoards[cBoard::SYMMETRY_COUNT];
+	cBoard::GetSymmetries(nBoard, aBoards);
+
+	float* pWeights = m_aWeights.data();
+	for (board_t b : aBoards) {
+		for (int t = 0; t < TUPLE_COUNT; t++)
+			pWeights[GetIndex(b, t)] += fDelta;
+	}
+}
+
+/**
+ * TD(0) on afterstates: the value of every afterstate is moved towards
+ * the score of the next move plus the value of the next afterstate.
+ * The learning rate is the part of the error which is corrected, it is
+ * split over the 32 weights of the board.
+ */
+int cNTuple::TrainGame(cRandom& rng, float fLearningRate, int& nMaxExponent)
+{
+	float fStep = fLearningRate / (cBoard::SYMMETRY_COUNT * TUPLE_COUNT);
+
+	board_t nBoard = 0;
+	for (int i = 0; i < 2; i++)
+		nBoard = cBoard::AddTile(nBoard, (int)rng.NextBelow(cBoard::CountEmpty(nBoard)), rng.NextBelow(10) == 0 ? 2 : 1);
+
+	int nScore = 0;
+	nMaxExponent = 0;
+
+	bool bHasPrevious = false;
+	board_t nPrevious = 0;
+	float fPreviousValue = 0.0f;
+
+	while (true) {
+		nMaxExponent = max(nMaxExponent, cBoard::GetMaxExponent(nBoard));
+
+		ROTATION nMove;
+		board_t nAfterstate;
+		int nMoveScore;
+		float fValue;
+		if (!ChooseAfterstate(nBoard, nMove, nAfterstate, nMoveScore, fValue))
+			break;
+
+		if (bHasPrevious)
+			Update(nPrevious, fStep * (nMoveScore + fValue - fPreviousValue));
+
+		bHasPrevious = true;
+		nPrevious = nAfterstate;
+		fPreviousValue = fValue;
+		nScore += nMoveScore;
+
+		int nEmpty = cBoard::CountEmpty(nAfterstate);
+		nBoard = nAfterstate;
+		if (nEmpty > 0)
+			nBoard = cBoard::AddTile(nBoard, (int)rng.NextBelow(nEmpty), rng.NextBelow(10) == 0 ? 2 : 1);
+	}
+
+	// Nothing follows the last afterstate
+	if (bHasPrevious)
+		Update(nPrevious, -fStep * fPreviousValue);
+
+	return nScore;
+}
+
+/**
+ * Maps the weights from a table file, all players which load the same
+ * file share the memory. With bCopy the weights are copied instead, so
+ * they can be trained further.
+ */
+bool cNTuple::Load(const char* sFileName, bool bCopy)
+{
+	cTableFile file;
+	if (!file.Open(sFileName))
+		return false;
+
+	const float* pWeights = (const float*)file.Find(s_sWeightsName, (uint64_t)TUPLE_COUNT * TUPLE_ENTRIES * sizeof(float));
+	if (pWeights == nullptr)
+		return false;
+
+	const int64_t* pGames = (const int64_t*)file.Find(s_sGamesName, sizeof(int64_t));
+	m_nTrainedGames = pGames != nullptr ? *pGames : 0;
+
+	if (bCopy) {
+		m_file.Close();
+		m_aWeights.assign(pWeights, pWeights + (size_t)TUPLE_COUNT * TUPLE_ENTRIES);
+		m_pWeights = m_aWeights.data();
+	}
+	else {
+		m_aWeights.clear();
+		m_aWeights.shrink_to_fit();
+		m_file.Swap(file);
+		m_pWeights = pWeights;
+	}
+
+	return true;
+}
+
+bool cNTuple::Save(const char* sFileName) const
+{
+	if (m_pWeights == nullptr)
+		return false;
+
+	int64_t nGames = m_nTrainedGames;
+	vector<sTableData> aTables = {
+		{ s_sWeightsName, m_pWeights, (uint64_t)TUPLE_COUNT * TUPLE_ENTRIES * sizeof(float) },
+		{ s_sGamesName, &nGames, sizeof(nGames) }
+	};
+	return cTableFile::Write(sFileName, aTables);
+}
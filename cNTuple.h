@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "cPlayer.h"
+#include "cTableFile.h"
+
+/**
+ * N-tuple network value function
+ *
+ * Four 6-cell tuples (two row-and-a-half shapes, two 2x3 rectangles)
+ * are each looked at in all 8 rotations and mirrors of the board.
+ * Every tuple maps the exponents of its cells to a weight, and the
+ * value of a board is the sum of those 32 weights. Exponents never
+ * exceed MAX_EXPONENT, so a tuple has 12^6 entries and the whole
+ * network is 48 MB.
+ *
+ * Trained weights are saved as a cTableFile. Loading maps them read
+ * only, so all players in a process (and all processes on a host) which
+ * load the same file share one copy.
+ *
+ * As a player it picks the move with the best score plus value of the
+ * board after the move (the afterstate), which takes microseconds.
+ *
+ * TrainGame plays one game and learns the afterstate values by
+ * temporal difference. Several threads may train the same network at
+ * once without any locking (Hogwild), lost updates are rare and do no
+ * harm.
+ */
+class cNTuple : public cPlayer
+{
+public:
+	static const int TUPLE_COUNT = 4;
+	static const int TUPLE_SIZE = 6;
+	static const int VALUE_COUNT = cBoard::MAX_EXPONENT + 1;
+	static const int TUPLE_ENTRIES = VALUE_COUNT * VALUE_COUNT * VALUE_COUNT * VALUE_COUNT * VALUE_COUNT * VALUE_COUNT;
+
+public:
+	cNTuple();
+	virtual bool ChooseMove(board_t nBoard, ROTATION& nMove);
+
+	float Evaluate(board_t nBoard) const;
+	void Update(board_t nBoard, float fDelta);
+
+	// Plays one game with the current weights and learns from it,
+	// returns the score reached
+	int TrainGame(cRandom& rng, float fLearningRate, int& nMaxExponent);
+
+	// Without weights every board is worth 0 and the player is greedy
+	void Clear();
+	bool Load(const char* sFileName, bool bCopy = false);
+	bool Save(const char* sFileName) const;
+	bool HasWeights() const { return m_pWeights != nullptr; }
+
+	// Games the weights were trained with, saved along with them
+	long long GetTrainedGames() const { return m_nTrainedGames; }
+	void SetTrainedGames(long long nGames) { m_nTrainedGames = nGames; }
+
+private:
+	// Best move by score plus afterstate value, returns false if there is none
+	bool ChooseAfterstate(board_t nBoard, ROTATION& nMove, board_t& nAfterstate, int& nScore, float& fValue) const;
+
+	static int GetIndex(board_t nBoard, int nTuple);
+
+private:
+	// Points into m_aWeights while training, or into the mapped file
+	const float* m_pWeights = nullptr;
+	vector<float> m_aWeights;
+	cTableFile m_file;
+	long long m_nTrainedGames = 0;
+};
@@ -0,0 +1,62 @@
+#include "cPlayer.h"
+
+static const ROTATION s_aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+cRandomPlayer::cRandomPlayer(uint64_t nSeed) : m_rng(nSeed)
+{
+}
+
+void cRandomPlayer::NewGame(uint64_t nSeed)
+{
+	m_rng.Seed(nSeed);
+}
+
+bool cRandomPlayer::ChooseMove(board_t nBoard, ROTATION& nMove)
+{
+	ROTATION aMoves[4];
+	int nMoveCount = 0;
+
+	for (ROTATION nDir : s_aDirections) {
+		if (cBoard::Move(nBoard, nDir) != nBoard)
+			aMoves[nMoveCount++] = nDir;
+	}
+
+	if (nMoveCount == 0)
+		return false;
+
+	nMove = aMoves[m_rng.NextBelow(nMoveCount)];
+	return true;
+}
+
+bool cGreedyPlayer::ChooseMove(board_t nBoard, ROTATION& nMove)
+{
+	int nBestScore = -1;
+
+	for (ROTATION nDir : s_aDirections) {
+		int nScore = 0;
+		if (cBoard::Move(nBoard, nDir, nScore) == nBoard)
+			continue;
+
+		if (nScore > nBestScore) {
+			nBestScore = nScore;
+			nMove = nDir;
+		}
+	}
+
+	return nBestScore >= 0;
+}
+
+bool cCornerPlayer::ChooseMove(board_t nBoard, ROTATION& nMove)
+{
+	// Moving up is the very last resort
+	static const ROTATION aPreference[4] = { DOWN, LEFT, RIGHT, TOP };
+
+	for (ROTATION nDir : aPreference) {
+		if (cBoard::Move(nBoard, nDir) != nBoard) {
+			nMove = nDir;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "cBoard.h"
+#include "cRandom.h"
+
+/**
+ * Interface for everything which can choose a move
+ */
+class cPlayer
+{
+public:
+	virtual ~cPlayer() {}
+
+	// Returns false if there is no move left
+	virtual bool ChooseMove(board_t nBoard, ROTATION& nMove) = 0;
+
+	// Called before every game with a seed which is unique for each game
+	virtual void NewGame(uint64_t) {}
+};
+
+/**
+ * Picks any move which changes the board
+ */
+class cRandomPlayer : public cPlayer
+{
+public:
+	cRandomPlayer(uint64_t nSeed = 0);
+	virtual bool ChooseMove(board_t nBoard, ROTATION& nMove);
+	virtual void NewGame(uint64_t nSeed);
+
+private:
+	cRandom m_rng;
+};
+
+/**
+ * Picks the move with the highest immediate score
+ */
+class cGreedyPlayer : public cPlayer
+{
+public:
+	virtual bool ChooseMove(board_t nBoard, ROTATION& nMove);
+};
+
+/**
+ * Keeps the big tiles in the bottom left corner by always
+ * trying the moves in the same order
+ */
+class cCornerPlayer : public cPlayer
+{
+public:
+	virtual bool ChooseMove(board_t nBoard, ROTATION& nMove);
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+using namespace std;
+
+/**
+ * xoshiro256** random number generator
+ *
+ * Small, fast and with a fixed algorithm, so the same seed gives the
+ * same numbers on every platform and compiler. Split hands out
+ * generators whose streams never overlap (they are 2^128 numbers
+ * apart), which gives every thread its own stream from one seed.
+ *
+ * Can be used wherever the standard library expects a generator.
+ */
+class cRandom
+{
+public:
+	typedef uint64_t result_type;
+
+public:
+	cRandom(uint64_t nSeed = 0) { Seed(nSeed); }
+
+	void Seed(uint64_t nSeed);
+	uint64_t Next();
+	uint32_t NextBelow(uint32_t nBound);
+	void Jump();
+	cRandom Split();
+
+	static uint64_t SplitMix64(uint64_t& nState);
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT64_MAX; }
+	result_type operator()() { return Next(); }
+
+private:
+	static uint64_t Rotate(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+private:
+	uint64_t m_aState[4];
+};
+
+/**
+ * Turns any 64 bit seed into a well mixed value and advances it
+ */
+inline uint64_t cRandom::SplitMix64(uint64_t& nState)
+{
+	uint64_t z = (nState += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+inline void cRandom::Seed(uint64_t nSeed)
+{
+	// SplitMix64 never produces an all zero state
+	for (int i = 0; i < 4; i++)
+		m_aState[i] = SplitMix64(nSeed);
+}
+
+inline uint64_t cRandom::Next()
+{
+	uint64_t nResult = Rotate(m_aState[1] * 5, 7) * 9;
+	uint64_t t = m_aState[1] << 17;
+
+	m_aState[2] ^= m_aState[0];
+	m_aState[3] ^= m_aState[1];
+	m_aState[1] ^= m_aState[2];
+	m_aState[0] ^= m_aState[3];
+	m_aState[2] ^= t;
+	m_aState[3] = Rotate(m_aState[3], 45);
+
+	return nResult;
+}
+
+/**
+ * Returns a number in [0, nBound) without a division
+ */
+inline uint32_t cRandom::NextBelow(uint32_t nBound)
+{
+	return (uint32_t)(((Next() >> 32) * nBound) >> 32);
+}
+
+/**
+ * Advances the generator by 2^128 numbers
+ */
+inline void cRandom::Jump()
+{
+	static const uint64_t aJump[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+
+	uint64_t aState[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < 4; i++) {
+		for (int b = 0; b < 64; b++) {
+			if (aJump[i] & (1ULL << b)) {
+				for (int j = 0; j < 4; j++)
+					aState[j] ^= m_aState[j];
+			}
+			Next();
+		}
+	}
+
+	for (int j = 0; j < 4; j++)
+		m_aState[j] = aState[j];
+}
+
+/**
+ * Returns a generator for the current stream and moves
+ * this one on to the next stream
+ */
+inline cRandom cRandom::Split()
+{
+	cRandom child = *this;
+	Jump();
+	return child;
+}
@@ -0,0 +1,536 @@
+#include <cstring>
+
+#include "cReplay.h"
+
+static const char s_sMagic[8] = { '2', '0', '4', '8', 'R', 'P', 'L', 1 };
+
+enum BLOCK_FLAGS {
+	BLOCK_MARKER = 0x80,
+	BLOCK_GAME_START = 0x01,
+	BLOCK_GAME_END = 0x02,
+	BLOCK_NO_LAST_SPAWN = 0x04
+};
+
+// Bits needed for the index of a spawn among n empty cells
+static const int s_aIndexBits[17] = { 0, 0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+
+static void WriteVarint(vector<uint8_t>& aData, uint64_t nValue)
+{
+	while (nValue >= 0x80) {
+		aData.push_back((uint8_t)(nValue | 0x80));
+		nValue >>= 7;
+	}
+	aData.push_back((uint8_t)nValue);
+}
+
+static long long FileTell(FILE* pFile)
+{
+#if defined(_WIN32)
+	return _ftelli64(pFile);
+#else
+	return ftello(pFile);
+#endif
+}
+
+static bool FileSeek(FILE* pFile, long long nOffset, int nOrigin)
+{
+#if defined(_WIN32)
+	return _fseeki64(pFile, nOffset, nOrigin) == 0;
+#else
+	return fseeko(pFile, (off_t)nOffset, nOrigin) == 0;
+#endif
+}
+
+cReplayWriter::~cReplayWriter()
+{
+	Close();
+}
+
+/**
+ * Opens the file for appending and starts a new session in it
+ */
+bool cReplayWriter::Open(const char* sFileName)
+{
+	Close();
+
+	m_pFile = fopen(sFileName, "ab");
+	if (m_pFile == nullptr)
+		return false;
+
+	m_nNextGame = 0;
+	m_bExit = false;
+	m_aPending.assign(s_sMagic, s_sMagic + sizeof(s_sMagic));
+	m_thread = thread(&cReplayWriter::FlushThread, this);
+	m_cvPending.notify_one();
+
+	return true;
+}
+
+/**
+ * Writes everything which is still pending and closes the file
+ */
+void cReplayWriter::Close()
+{
+	if (m_pFile == nullptr)
+		return;
+
+	{
+		unique_lock<mutex> lock(m_muxPending);
+		m_bExit = true;
+	}
+	m_cvPending.notify_one();
+	m_thread.join();
+
+	fclose(m_pFile);
+	m_pFile = nullptr;
+}
+
+void cReplayWriter::Append(const vector<uint8_t>& aBlock)
+{
+	{
+		unique_lock<mutex> lock(m_muxPending);
+		m_aPending.insert(m_aPending.end(), aBlock.begin(), aBlock.end());
+	}
+	m_cvPending.notify_one();
+}
+
+void cReplayWriter::FlushThread()
+{
+	vector<uint8_t> aData;
+
+	while (true) {
+		bool bExit;
+		{
+			unique_lock<mutex> lock(m_muxPending);
+			m_cvPending.wait(lock, [this] { return m_bExit || !m_aPending.empty(); });
+
+			aData.swap(m_aPending);
+			bExit = m_bExit;
+		}
+
+		if (!aData.empty()) {
+			fwrite(aData.data(), 1, aData.size(), m_pFile);
+			fflush(m_pFile);
+			m_nBytesWritten += (long long)aData.size();
+			aData.clear();
+		}
+
+		if (bExit)
+			return;
+	}
+}
+
+void cReplayRecorder::StartGame(uint64_t nSeed)
+{
+	FinishGame();
+	if (m_pWriter == nullptr || !m_pWriter->IsOpen())
+		return;
+
+	m_bInGame = true;
+	m_nGame = m_pWriter->NextGame();
+	m_nSeed = nSeed;
+	m_bFirstBlock = true;
+	m_nBoard = 0;
+	m_nScore = 0;
+	m_nMoves = 0;
+	m_bSpawnPending = false;
+	StartBlock();
+}
+
+void cReplayRecorder::FinishGame()
+{
+	if (!m_bInGame)
+		return;
+
+	FinishBlock(true);
+	m_bInGame = false;
+}
+
+void cReplayRecorder::RecordMove(ROTATION nDir)
+{
+	if (!m_bInGame)
+		return;
+
+	// The last move got no spawn, so this one starts a new keyframe
+	if (m_bSpawnPending || m_nBlockMoves == BLOCK_MOVES)
+		FinishBlock(false);
+
+	if (m_nBlockMoves == 0) {
+		m_nBlockBoard = m_nBoard;
+		m_nBlockScore = m_nScore;
+		m_nBlockFirstMove = m_nMoves;
+	}
+
+	WriteBits((uint64_t)(nDir / 90), 2);
+
+	int nScore = 0;
+	m_nBoard = cBoard::Move(m_nBoard, nDir, nScore);
+	m_nScore += nScore;
+	m_nMoves++;
+	m_nBlockMoves++;
+	m_bSpawnPending = true;
+}
+
+void cReplayRecorder::RecordSpawn(int nCellIndex, int nExponent)
+{
+	if (!m_bInGame)
+		return;
+
+	// Spawns before the first move of a block are part of its keyframe
+	if (m_nBlockMoves == 0) {
+		m_nBoard = cBoard::SetExponent(m_nBoard, nCellIndex, nExponent);
+		return;
+	}
+
+	// Anything but one spawn into an empty cell after a move
+	// does not fit into the block, so a new keyframe is started
+	if (!m_bSpawnPending || cBoard::GetExponent(m_nBoard, nCellIndex) != 0) {
+		FinishBlock(false);
+		m_nBoard = cBoard::SetExponent(m_nBoard, nCellIndex, nExponent);
+		return;
+	}
+
+	uint32_t nEmptyMask = cBoard::GetEmptyMask(m_nBoard);
+	int nEmptyIndex = cBoard::CountBits(nEmptyMask & ((1u << nCellIndex) - 1));
+	WriteBits((uint64_t)nEmptyIndex, s_aIndexBits[cBoard::CountBits(nEmptyMask)]);
+
+	if (nExponent == 1)
+		WriteBits(0, 1);
+	else if (nExponent == 2)
+		WriteBits(1, 2);
+	else
+		WriteBits(3 | ((uint64_t)nExponent << 2), 6);
+
+	m_nBoard = cBoard::SetExponent(m_nBoard, nCellIndex, nExponent);
+	m_bSpawnPending = false;
+}
+
+void cReplayRecorder::RecordBoard(board_t nBoard)
+{
+	if (!m_bInGame || nBoard == m_nBoard)
+		return;
+
+	if (m_nBlockMoves == 0) {
+		m_nBoard = nBoard;
+		return;
+	}
+
+	// Exactly one cell which was empty before
+	board_t nDiff = nBoard ^ m_nBoard;
+	int nCellIndex = cBoard::LowestBit((uint32_t)(nDiff & 0xFFFFFFFF)) / 4;
+	if ((nDiff & 0xFFFFFFFF) == 0)
+		nCellIndex = 8 + cBoard::LowestBit((uint32_t)(nDiff >> 32)) / 4;
+
+	bool bOneCell = (nDiff & ~((board_t)0xF << (nCellIndex * 4))) == 0;
+	if (m_bSpawnPending && bOneCell && cBoard::GetExponent(m_nBoard, nCellIndex) == 0) {
+		RecordSpawn(nCellIndex, cBoard::GetExponent(nBoard, nCellIndex));
+		return;
+	}
+
+	FinishBlock(false);
+	m_nBoard = nBoard;
+}
+
+void cReplayRecorder::StartBlock()
+{
+	m_nBlockBoard = m_nBoard;
+	m_nBlockScore = m_nScore;
+	m_nBlockFirstMove = m_nMoves;
+	m_nBlockMoves = 0;
+	m_aPayload.clear();
+	m_nBitBuffer = 0;
+	m_nBitCount = 0;
+}
+
+/**
+ * Hands the block over to the writer. Blocks without moves are only
+ * written if they start or end a game.
+ */
+void cReplayRecorder::FinishBlock(bool bGameEnd)
+{
+	if (m_nBlockMoves == 0 && !bGameEnd && !m_bFirstBlock)
+		return;
+
+	if (m_nBlockMoves == 0) {
+		m_nBlockBoard = m_nBoard;
+		m_nBlockScore = m_nScore;
+		m_nBlockFirstMove = m_nMoves;
+	}
+
+	if (m_nBitCount > 0)
+		m_aPayload.push_back((uint8_t)m_nBitBuffer);
+
+	uint8_t nFlags = BLOCK_MARKER;
+	if (m_bFirstBlock)
+		nFlags |= BLOCK_GAME_START;
+	if (bGameEnd)
+		nFlags |= BLOCK_GAME_END;
+	if (m_bSpawnPending && m_nBlockMoves > 0)
+		nFlags |= BLOCK_NO_LAST_SPAWN;
+
+	vector<uint8_t> aBlock;
+	aBlock.push_back(nFlags);
+	WriteVarint(aBlock, m_nGame);
+	if (m_bFirstBlock)
+		WriteVarint(aBlock, m_nSeed);
+	WriteVarint(aBlock, m_nBlockFirstMove);
+	for (int i = 0; i < 8; i++)
+		aBlock.push_back((uint8_t)(m_nBlockBoard >> (i * 8)));
+	WriteVarint(aBlock, m_nBlockScore);
+	WriteVarint(aBlock, m_nBlockMoves);
+	WriteVarint(aBlock, m_aPayload.size());
+	aBlock.insert(aBlock.end(), m_aPayload.begin(), m_aPayload.end());
+
+	m_pWriter->Append(aBlock);
+
+	m_bFirstBlock = false;
+	m_bSpawnPending = false;
+	StartBlock();
+}
+
+void cReplayRecorder::WriteBits(uint64_t nBits, int nCount)
+{
+	m_nBitBuffer |= nBits << m_nBitCount;
+	m_nBitCount += nCount;
+
+	while (m_nBitCount >= 8) {
+		m_aPayload.push_back((uint8_t)m_nBitBuffer);
+		m_nBitBuffer >>= 8;
+		m_nBitCount -= 8;
+	}
+}
+
+bool cReplayReader::Open(const char* sFileName)
+{
+	Close();
+
+	m_pFile = fopen(sFileName, "rb");
+	m_nSession = 0;
+	m_bDamaged = false;
+	m_nMovesLeft = 0;
+	m_aIndex.clear();
+
+	return m_pFile != nullptr;
+}
+
+void cReplayReader::Close()
+{
+	if (m_pFile != nullptr)
+		fclose(m_pFile);
+	m_pFile = nullptr;
+}
+
+bool cReplayReader::ReadVarint(uint64_t& nValue)
+{
+	nValue = 0;
+	for (int nShift = 0; nShift < 64; nShift += 7) {
+		int c = fgetc(m_pFile);
+		if (c == EOF)
+			return false;
+
+		nValue |= (uint64_t)(c & 0x7F) << nShift;
+		if ((c & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Reads the next block header, skipping session headers. The payload
+ * is either read or skipped.
+ */
+bool cReplayReader::ReadBlock(sReplayBlock& block, bool bSkipPayload)
+{
+	if (m_pFile == nullptr || m_bDamaged)
+		return false;
+
+	while (true) {
+		long long nOffset = FileTell(m_pFile);
+		int nFlags = fgetc(m_pFile);
+		if (nFlags == EOF)
+			return false;
+
+		if (nFlags == s_sMagic[0]) {
+			char sMagic[8] = { s_sMagic[0] };
+			if (fread(sMagic + 1, 1, 7, m_pFile) != 7 || memcmp(sMagic, s_sMagic, 8) != 0) {
+				m_bDamaged = true;
+				return false;
+			}
+			m_nSession++;
+			continue;
+		}
+
+		uint64_t nGame, nSeed = 0, nFirstMove, nScore, nMoveCount, nPayloadSize;
+		uint8_t aBoard[8];
+
+		bool bOk = (nFlags & BLOCK_MARKER) != 0 && m_nSession > 0
+			&& ReadVarint(nGame)
+			&& ((nFlags & BLOCK_GAME_START) == 0 || ReadVarint(nSeed))
+			&& ReadVarint(nFirstMove)
+			&& fread(aBoard, 1, 8, m_pFile) == 8
+			&& ReadVarint(nScore)
+			&& ReadVarint(nMoveCount)
+			&& ReadVarint(nPayloadSize)
+			&& nMoveCount <= cReplayRecorder::BLOCK_MOVES
+			&& nPayloadSize <= (uint64_t)cReplayRecorder::BLOCK_MOVES * 2;
+
+		if (bOk && bSkipPayload)
+			bOk = FileSeek(m_pFile, (long long)nPayloadSize, SEEK_CUR);
+		else if (bOk) {
+			m_aPayload.resize((size_t)nPayloadSize);
+			bOk = fread(m_aPayload.data(), 1, m_aPayload.size(), m_pFile) == m_aPayload.size();
+		}
+
+		if (!bOk) {
+			m_bDamaged = true;
+			return false;
+		}
+
+		block.nSession = m_nSession - 1;
+		block.nGame = nGame;
+		block.nSeed = nSeed;
+		block.bGameStart = (nFlags & BLOCK_GAME_START) != 0;
+		block.bGameEnd = (nFlags & BLOCK_GAME_END) != 0;
+		block.nFirstMove = (uint32_t)nFirstMove;
+		block.nMoveCount = (uint32_t)nMoveCount;
+		block.nBoard = 0;
+		for (int i = 0; i < 8; i++)
+			block.nBoard |= (board_t)aBoard[i] << (i * 8);
+		block.nScore = nScore;
+		block.nFileOffset = nOffset;
+
+		m_nFlags = (uint8_t)nFlags;
+		return true;
+	}
+}
+
+bool cReplayReader::NextBlock(sReplayBlock& block)
+{
+	m_nMovesLeft = 0;
+	if (!ReadBlock(block, false))
+		return false;
+
+	m_block = block;
+	m_nMovesLeft = block.nMoveCount;
+	m_nBoard = block.nBoard;
+	m_nScore = block.nScore;
+	m_nPayloadPos = 0;
+	m_nBitBuffer = 0;
+	m_nBitCount = 0;
+	return true;
+}
+
+inline uint64_t cReplayReader::ReadBits(int nCount)
+{
+	while (m_nBitCount < nCount) {
+		uint64_t nByte = m_nPayloadPos < m_aPayload.size() ? m_aPayload[m_nPayloadPos++] : 0;
+		m_nBitBuffer |= nByte << m_nBitCount;
+		m_nBitCount += 8;
+	}
+
+	uint64_t nBits = m_nBitBuffer & ((1ULL << nCount) - 1);
+	m_nBitBuffer >>= nCount;
+	m_nBitCount -= nCount;
+	return nBits;
+}
+
+bool cReplayReader::NextMove(sReplayMove& move)
+{
+	if (m_nMovesLeft == 0)
+		return false;
+
+	m_nMovesLeft--;
+
+	move.nDir = (ROTATION)(ReadBits(2) * 90);
+
+	int nScore = 0;
+	m_nBoard = cBoard::Move(m_nBoard, move.nDir, nScore);
+	m_nScore += nScore;
+
+	move.nSpawnCell = -1;
+	move.nSpawnExponent = 0;
+
+	uint32_t nEmptyMask = cBoard::GetEmptyMask(m_nBoard);
+	bool bSpawn = nEmptyMask != 0 && !(m_nMovesLeft == 0 && (m_nFlags & BLOCK_NO_LAST_SPAWN));
+
+	if (bSpawn) {
+		int nEmptyIndex = (int)ReadBits(s_aIndexBits[cBoard::CountBits(nEmptyMask)]);
+		move.nSpawnCell = cBoard::SelectBit(nEmptyMask, nEmptyIndex);
+
+		if (ReadBits(1) == 0)
+			move.nSpawnExponent = 1;
+		else if (ReadBits(1) == 0)
+			move.nSpawnExponent = 2;
+		else
+			move.nSpawnExponent = (int)ReadBits(4);
+
+		m_nBoard = cBoard::SetExponent(m_nBoard, move.nSpawnCell, move.nSpawnExponent);
+	}
+
+	move.nBoard = m_nBoard;
+	move.nScore = m_nScore;
+	return true;
+}
+
+/**
+ * Reads all block headers of the file, afterwards the reader
+ * starts at the beginning again
+ */
+bool cReplayReader::BuildIndex()
+{
+	if (m_pFile == nullptr || !FileSeek(m_pFile, 0, SEEK_SET))
+		return false;
+
+	m_aIndex.clear();
+	m_nSession = 0;
+	m_bDamaged = false;
+	m_nMovesLeft = 0;
+
+	sReplayBlock block;
+	while (ReadBlock(block, true))
+		m_aIndex.push_back(block);
+
+	bool bOk = !m_bDamaged;
+	m_nSession = 0;
+	m_bDamaged = false;
+	FileSeek(m_pFile, 0, SEEK_SET);
+	return bOk;
+}
+
+bool cReplayReader::Seek(uint32_t nSession, uint64_t nGame, uint32_t nMove, board_t& nBoard, uint64_t& nScore)
+{
+	if (m_aIndex.empty() && !BuildIndex())
+		return false;
+
+	// The last keyframe of the game at or before the move
+	const sReplayBlock* pBlock = nullptr;
+	for (const sReplayBlock& block : m_aIndex) {
+		if (block.nSession == nSession && block.nGame == nGame && block.nFirstMove <= nMove)
+			pBlock = &block;
+	}
+
+	if (pBlock == nullptr || nMove > pBlock->nFirstMove + pBlock->nMoveCount)
+		return false;
+
+	// Session headers are skipped because the block is read directly
+	m_nSession = pBlock->nSession + 1;
+	m_bDamaged = false;
+
+	sReplayBlock block;
+	if (!FileSeek(m_pFile, pBlock->nFileOffset, SEEK_SET) || !NextBlock(block))
+		return false;
+
+	nBoard = block.nBoard;
+	nScore = block.nScore;
+
+	sReplayMove move;
+	for (uint32_t i = block.nFirstMove; i < nMove; i++) {
+		if (!NextMove(move))
+			return false;
+		nBoard = move.nBoard;
+		nScore = move.nScore;
+	}
+
+	return true;
+}
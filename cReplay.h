@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "cBoard.h"
+
+/**
+ * Replay files
+ *
+ * A replay file is append only. Every process which opens it for
+ * writing starts a session with an 8 byte header, followed by blocks.
+ * A block holds up to cReplayRecorder::BLOCK_MOVES moves of one game
+ * and starts with a keyframe (board, score and number of the first
+ * move), so every block can be decoded on its own and blocks of games
+ * played at the same time may be interleaved.
+ *
+ * Block layout (varints are 7 bits per byte, lowest first):
+ *   flags (1 byte), game (varint), seed (varint, first block only),
+ *   first move (varint), board (8 bytes), score (varint),
+ *   move count (varint), payload size (varint), payload
+ *
+ * Every move in the payload is 2 bits for the direction followed by the
+ * spawn: the index among the empty cells in as many bits as needed for
+ * the number of empty cells, then 0 for a 2, 10 for a 4 or 11 and the
+ * 4 bit exponent for anything else. Most moves take 5 to 7 bits.
+ *
+ * The seed is the one of the game, not of the session: a cGame reset
+ * with it spawns the same tiles for the same moves, whether sim2048 or
+ * the game wrote the file.
+ */
+
+/**
+ * Appends blocks to a replay file
+ *
+ * Blocks can be added from any thread, a background thread writes them
+ * to the file so the game never waits for the disk.
+ */
+class cReplayWriter
+{
+public:
+	cReplayWriter() {}
+	~cReplayWriter();
+
+	bool Open(const char* sFileName);
+	void Close();
+	bool IsOpen() const { return m_pFile != nullptr; }
+
+	uint64_t NextGame() { return m_nNextGame++; }
+	void Append(const vector<uint8_t>& aBlock);
+
+	long long GetBytesWritten() const { return m_nBytesWritten; }
+
+private:
+	void FlushThread();
+
+private:
+	FILE* m_pFile = nullptr;
+	atomic<uint64_t> m_nNextGame{ 0 };
+	atomic<long long> m_nBytesWritten{ 0 };
+
+	mutex m_muxPending;
+	condition_variable m_cvPending;
+	vector<uint8_t> m_aPending;
+	bool m_bExit = false;
+	thread m_thread;
+};
+
+/**
+ * Records one game at a time into blocks for a cReplayWriter
+ *
+ * Not thread safe, every thread which plays games needs its own
+ * recorder. Without a writer nothing is recorded.
+ */
+class cReplayRecorder
+{
+public:
+	static const int BLOCK_MOVES = 256;
+
+public:
+	cReplayRecorder(cReplayWriter* pWriter = nullptr) : m_pWriter(pWriter) {}
+	~cReplayRecorder() { FinishGame(); }
+
+	void SetWriter(cReplayWriter* pWriter) { FinishGame(); m_pWriter = pWriter; }
+
+	void StartGame(uint64_t nSeed);
+	void FinishGame();
+
+	void RecordMove(ROTATION nDir);
+	void RecordSpawn(int nCellIndex, int nExponent);
+
+	// For games which only show the board: finds the spawn by comparing
+	// with the expected board, or starts a new keyframe if it does not fit
+	void RecordBoard(board_t nBoard);
+
+private:
+	void StartBlock();
+	void FinishBlock(bool bGameEnd);
+	void WriteBits(uint64_t nBits, int nCount);
+
+private:
+	cReplayWriter* m_pWriter = nullptr;
+	bool m_bInGame = false;
+
+	uint64_t m_nGame = 0;
+	uint64_t m_nSeed = 0;
+	bool m_bFirstBlock = false;
+	board_t m_nBoard = 0;
+	uint64_t m_nScore = 0;
+	uint32_t m_nMoves = 0;
+	bool m_bSpawnPending = false;
+
+	// Block which is being recorded
+	board_t m_nBlockBoard = 0;
+	uint64_t m_nBlockScore = 0;
+	uint32_t m_nBlockFirstMove = 0;
+	uint32_t m_nBlockMoves = 0;
+	vector<uint8_t> m_aPayload;
+	uint64_t m_nBitBuffer = 0;
+	int m_nBitCount = 0;
+};
+
+struct sReplayBlock {
+	uint32_t nSession;
+	uint64_t nGame;
+	uint64_t nSeed;
+	bool bGameStart;
+	bool bGameEnd;
+	uint32_t nFirstMove;
+	uint32_t nMoveCount;
+	board_t nBoard;
+	uint64_t nScore;
+	long long nFileOffset;
+};
+
+struct sReplayMove {
+	ROTATION nDir;
+	int nSpawnCell;
+	int nSpawnExponent;
+	board_t nBoard;
+	uint64_t nScore;
+};
+
+/**
+ * Reads a replay file block by block and move by move
+ *
+ * The board and score are reconstructed while reading. BuildIndex
+ * collects the keyframes of the whole file without decoding any moves,
+ * and Seek uses them to jump to any move of any game.
+ */
+class cReplayReader
+{
+public:
+	~cReplayReader() { Close(); }
+
+	bool Open(const char* sFileName);
+	void Close();
+
+	// Returns false at the end of the file or if the file is damaged
+	bool NextBlock(sReplayBlock& block);
+	// Returns false at the end of the current block
+	bool NextMove(sReplayMove& move);
+
+	bool BuildIndex();
+	const vector<sReplayBlock>& GetIndex() const { return m_aIndex; }
+
+	// Positions the reader right after move nMove (0 is the start) of a
+	// game, nBoard and nScore receive the position
+	bool Seek(uint32_t nSession, uint64_t nGame, uint32_t nMove, board_t& nBoard, uint64_t& nScore);
+
+	bool IsDamaged() const { return m_bDamaged; }
+
+private:
+	bool ReadVarint(uint64_t& nValue);
+	uint64_t ReadBits(int nCount);
+	bool ReadBlock(sReplayBlock& block, bool bSkipPayload);
+
+private:
+	FILE* m_pFile = nullptr;
+	uint32_t m_nSession = 0;
+	bool m_bDamaged = false;
+	vector<sReplayBlock> m_aIndex;
+
+	// Block which is being decoded
+	sReplayBlock m_block = {};
+	uint8_t m_nFlags = 0;
+	uint32_t m_nMovesLeft = 0;
+	board_t m_nBoard = 0;
+	uint64_t m_nScore = 0;
+	vector<uint8_t> m_aPayload;
+	size_t m_nPayloadPos = 0;
+	uint64_t m_nBitBuffer = 0;
+	int m_nBitCount = 0;
+};
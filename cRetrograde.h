@@ -0,0 +1,565 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "cBoardN.h"
+#include "cStateSet.h"
+#include "cTableFile.h"
+
+struct sRetrogradeOptions {
+	string sTempDir = ".";
+	int nMemoryMB = 512;	// for the states which wait to be sorted
+	int nThreads = 0;		// 0 is one per hardware thread
+	bool bVerbose = false;
+};
+
+struct sRetrogradeStats {
+	uint64_t nStates = 0;
+	uint64_t nTransitions = 0;	// spawns generated by the forward pass
+	int nLayers = 0;
+	int nRuns = 0;				// sorted runs spilled to disk
+	uint64_t nSpilledBytes = 0;
+	uint64_t nTableBytes = 0;
+	double fForwardSeconds = 0.0;
+	double fBackwardSeconds = 0.0;
+};
+
+// Sections of a solved table file
+struct sRetrogradeInfo {
+	uint32_t nWidth;
+	uint32_t nHeight;
+	uint64_t nStateCount;
+	uint32_t nLayerSlots;	// layers are indexed by tile sum / 2
+	uint32_t nReserved;
+};
+
+struct sRetrogradeLayer {
+	uint64_t nFirst;
+	uint64_t nCount;
+};
+
+/**
+ * Exact solver for small boards
+ *
+ * Finds every position which can be reached from the start of a game
+ * and the expected score which is still to come from each of them with
+ * perfect play. The positions are those after the new tile came, up to
+ * the symmetries of the board, so every state is the smallest of its
+ * mirror images.
+ *
+ * Up to 10 cells no tile can get bigger than 2048 and explode, so
+ * every move keeps the sum of the tiles and every new tile adds 2 or 4
+ * to it. The states are solved in layers of the same tile sum: the
+ * forward pass finds the layers from small sums to big ones, and the
+ * backward pass computes the values from big sums to small ones, where
+ * the values of a layer only depend on the two layers above it. Layers
+ * go through disk, so only three of them have to fit into memory.
+ *
+ * The table file has the sections retro_info, retro_layers,
+ * retro_states (sorted within every layer) and retro_values, 12 bytes
+ * for every state.
+ */
+template<int W, int H>
+class cRetrograde
+{
+public:
+	typedef cBoardN<W, H> board;
+	typedef typename board::bits_t bits_t;
+
+	static const int CELL_COUNT = W * H;
+	static const int SYMMETRY_COUNT = W == H ? 8 : 4;
+
+	static_assert(CELL_COUNT <= 10, "board too big to solve");
+
+public:
+	// Must be called once before anything else
+	static void InitTables();
+
+	static bits_t Canonical(bits_t nBoard);
+	static int GetTileSum(bits_t nBoard);
+
+	// Points of the move plus the expected value after the new tile, or
+	// -1 if the move does not change the board. value(nState, nSum)
+	// returns the value of a canonical state with tile sum nSum.
+	template<typename VALUE>
+	static double GetMoveValue(bits_t nBoard, int nSum, ROTATION nDir, const VALUE& value);
+
+	static bool Solve(const string& sFileName, const sRetrogradeOptions& options, sRetrogradeStats& stats);
+
+private:
+	struct sWindowLayer {
+		int nSum = -1;
+		vector<uint64_t> aStates;
+		vector<float> aValues;
+	};
+
+	static string GetLayerFile(const string& sPrefix, int nSum) { return sPrefix + ".layer" + to_string(nSum); }
+	static void SolveLayer(sWindowLayer aWindow[3], int nThreads);
+
+private:
+	static const int ROW_VALUES = 1 << (W * 4);
+
+	// The bits of a row in every mirror image of the board
+	static bool s_bTablesReady;
+	static uint64_t s_aSymmetry[SYMMETRY_COUNT][H][ROW_VALUES];
+};
+
+template<int W, int H>
+bool cRetrograde<W, H>::s_bTablesReady = false;
+
+template<int W, int H>
+uint64_t cRetrograde<W, H>::s_aSymmetry[cRetrograde<W, H>::SYMMETRY_COUNT][H][cRetrograde<W, H>::ROW_VALUES];
+
+/**
+ * Symmetries 0 to 3 mirror x and/or y, 4 to 7 (square boards only)
+ * transpose the board first
+ */
+template<int W, int H>
+void cRetrograde<W, H>::InitTables()
+{
+	board::InitTables();
+	if (s_bTablesReady)
+		return;
+
+	for (int s = 0; s < SYMMETRY_COUNT; s++) {
+		for (int y = 0; y < H; y++) {
+			for (int nRow = 0; nRow < ROW_VALUES; nRow++) {
+				uint64_t nBits = 0;
+				for (int x = 0; x < W; x++) {
+					int tx = s < 4 ? x : y;
+					int ty = s < 4 ? y : x;
+					if (s & 1)
+						tx = W - 1 - tx;
+					if (s & 2)
+						ty = H - 1 - ty;
+
+					nBits |= (uint64_t)((nRow >> (x * 4)) & 0xF) << ((ty * W + tx) * 4);
+				}
+				s_aSymmetry[s][y][nRow] = nBits;
+			}
+		}
+	}
+
+	s_bTablesReady = true;
+}
+
+template<int W, int H>
+inline typename cRetrograde<W, H>::bits_t cRetrograde<W, H>::Canonical(bits_t nBoard)
+{
+	bits_t nBest = nBoard;
+	for (int s = 1; s < SYMMETRY_COUNT; s++) {
+		bits_t nImage = 0;
+		for (int y = 0; y < H; y++)
+			nImage |= s_aSymmetry[s][y][(nBoard >> (y * W * 4)) & (ROW_VALUES - 1)];
+		nBest = min(nBest, nImage);
+	}
+
+	return nBest;
+}
+
+template<int W, int H>
+inline int cRetrograde<W, H>::GetTileSum(bits_t nBoard)
+{
+	int nSum = 0;
+	for (int i = 0; i < CELL_COUNT; i++) {
+		int nExponent = (int)(nBoard >> (i * 4)) & 0xF;
+		if (nExponent > 0)
+			nSum += 1 << nExponent;
+	}
+
+	return nSum;
+}
+
+/**
+ * Every empty cell gets the new tile with the same chance, a 2 with 90%
+ * and a 4 with 10%
+ */
+template<int W, int H>
+template<typename VALUE>
+inline double cRetrograde<W, H>::GetMoveValue(bits_t nBoard, int nSum, ROTATION nDir, const VALUE& value)
+{
+	int nScore = 0;
+	bits_t nMoved = board::Move(nBoard, nDir, nScore);
+	if (nMoved == nBoard)
+		return -1.0;
+
+	// A move which changes a full board merges, so there is an empty cell
+	double fSum = 0.0;
+	int nEmpty = 0;
+	for (int i = 0; i < CELL_COUNT; i++) {
+		if (((nMoved >> (i * 4)) & 0xF) != 0)
+			continue;
+
+		fSum += 0.9 * value(Canonical(nMoved | ((bits_t)1 << (i * 4))), nSum + 2);
+		fSum += 0.1 * value(Canonical(nMoved | ((bits_t)2 << (i * 4))), nSum + 4);
+		nEmpty++;
+	}
+
+	return nScore + fSum / nEmpty;
+}
+
+/**
+ * aWindow holds the layer to solve and the two layers above it, which
+ * are solved already
+ */
+template<int W, int H>
+void cRetrograde<W, H>::SolveLayer(sWindowLayer aWindow[3], int nThreads)
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	const int nSum = aWindow[0].nSum;
+	auto value = [&](uint64_t nState, int nStateSum) -> float {
+		const sWindowLayer& layer = aWindow[(nStateSum - nSum) / 2];
+		if (layer.nSum != nStateSum)
+			return 0.0f;
+
+		auto it = lower_bound(layer.aStates.begin(), layer.aStates.end(), nState);
+		return it != layer.aStates.end() && *it == nState ? layer.aValues[it - layer.aStates.begin()] : 0.0f;
+	};
+
+	auto solve = [&](size_t nBegin, size_t nEnd) {
+		for (size_t i = nBegin; i < nEnd; i++) {
+			double fBest = 0.0;
+			for (ROTATION nDir : aDirections)
+				fBest = max(fBest, GetMoveValue(aWindow[0].aStates[i], nSum, nDir, value));
+			aWindow[0].aValues[i] = (float)fBest;
+		}
+	};
+
+	size_t nCount = aWindow[0].aStates.size();
+	aWindow[0].aValues.assign(nCount, 0.0f);
+
+	// Small layers are not worth the threads
+	if (nThreads <= 1 || nCount < 4096) {
+		solve(0, nCount);
+		return;
+	}
+
+	vector<thread> aThreads;
+	for (int t = 0; t < nThreads; t++)
+		aThreads.emplace_back(solve, nCount * t / nThreads, nCount * (t + 1) / nThreads);
+	for (thread& th : aThreads)
+		th.join();
+}
+
+template<int W, int H>
+bool cRetrograde<W, H>::Solve(const string& sFileName, const sRetrogradeOptions& options, sRetrogradeStats& stats)
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	InitTables();
+	stats = sRetrogradeStats();
+
+	string sPrefix = options.sTempDir + "/solve2048_" + to_string(W) + "x" + to_string(H);
+	int nThreads = options.nThreads > 0 ? options.nThreads : max(1, (int)thread::hardware_concurrency());
+
+	// The forward pass fills the sets of the next two layers at a time
+	size_t nMaxStates = (size_t)max(1, options.nMemoryMB) * (1 << 20) / sizeof(uint64_t) / 2;
+
+	map<int, unique_ptr<cStateSet>> pending;
+	auto getSet = [&](int nSum) -> cStateSet& {
+		unique_ptr<cStateSet>& pSet = pending[nSum];
+		if (!pSet)
+			pSet.reset(new cStateSet(GetLayerFile(sPrefix, nSum), nMaxStates));
+		return *pSet;
+	};
+
+	// Forward pass, starting with every board of two tiles
+	auto tp1 = chrono::steady_clock::now();
+
+	for (int i = 0; i < CELL_COUNT; i++) {
+		for (int j = i + 1; j < CELL_COUNT; j++) {
+			for (int a = 1; a <= 2; a++) {
+				for (int b = 1; b <= 2; b++) {
+					bits_t nBoard = ((bits_t)a << (i * 4)) | ((bits_t)b << (j * 4));
+					getSet(GetTileSum(nBoard)).Add(Canonical(nBoard));
+				}
+			}
+		}
+	}
+
+	vector<pair<int, uint64_t>> aLayers;
+	bool bOk = true;
+
+	while (!pending.empty() && bOk) {
+		int nSum = pending.begin()->first;
+		string sLayerFile = GetLayerFile(sPrefix, nSum);
+
+		uint64_t nCount = 0;
+		cStateSet& set = *pending.begin()->second;
+		bOk = set.Finish(sLayerFile, nCount);
+		stats.nRuns += set.GetRunCount();
+		stats.nSpilledBytes += set.GetSpilledBytes();
+		pending.erase(pending.begin());
+
+		aLayers.push_back(make_pair(nSum, nCount));
+		stats.nStates += nCount;
+
+		cStateReader reader(sLayerFile);
+		bOk = bOk && reader.IsOpen();
+
+		uint64_t nState;
+		while (bOk && reader.Next(nState)) {
+			// Mirror images of the moved board have the same successors
+			bits_t aMoved[4];
+			int nMovedCount = 0;
+
+			for (ROTATION nDir : aDirections) {
+				int nScore = 0;
+				bits_t nMoved = board::Move(nState, nDir, nScore);
+				if (nMoved == nState)
+					continue;
+
+				nMoved = Canonical(nMoved);
+				if (find(aMoved, aMoved + nMovedCount, nMoved) != aMoved + nMovedCount)
+					continue;
+				aMoved[nMovedCount++] = nMoved;
+
+				for (int i = 0; i < CELL_COUNT; i++) {
+					if (((nMoved >> (i * 4)) & 0xF) != 0)
+						continue;
+
+					getSet(nSum + 2).Add(Canonical(nMoved | ((bits_t)1 << (i * 4))));
+					getSet(nSum + 4).Add(Canonical(nMoved | ((bits_t)2 << (i * 4))));
+					stats.nTransitions += 2;
+				}
+			}
+		}
+
+		if (options.bVerbose)
+			printf("forward  sum %5d  %12llu states\n", nSum, (unsigned long long)nCount);
+	}
+
+	auto tp2 = chrono::steady_clock::now();
+	stats.fForwardSeconds = chrono::duration<double>(tp2 - tp1).count();
+	stats.nLayers = (int)aLayers.size();
+
+	// Backward pass, from the biggest sum down
+	string sStatesFile = sPrefix + ".states";
+	string sValuesFile = sPrefix + ".values";
+	FILE* pStates = fopen(sStatesFile.c_str(), "wb");
+	FILE* pValues = fopen(sValuesFile.c_str(), "wb");
+	bOk = bOk && pStates != nullptr && pValues != nullptr;
+
+	int nMaxSum = aLayers.empty() ? 0 : aLayers.back().first;
+	vector<sRetrogradeLayer> aIndex(nMaxSum / 2 + 1, sRetrogradeLayer{ 0, 0 });
+	sWindowLayer aWindow[3];
+	uint64_t nWritten = 0;
+
+	for (auto it = aLayers.rbegin(); it != aLayers.rend() && bOk; ++it) {
+		int nSum = it->first;
+		string sLayerFile = GetLayerFile(sPrefix, nSum);
+
+		swap(aWindow[2], aWindow[1]);
+		swap(aWindow[1], aWindow[0]);
+		aWindow[0].nSum = nSum;
+		bOk = cStateReader::ReadAll(sLayerFile, aWindow[0].aStates);
+		remove(sLayerFile.c_str());
+
+		SolveLayer(aWindow, nThreads);
+
+		size_t nCount = aWindow[0].aStates.size();
+		bOk = bOk && fwrite(aWindow[0].aStates.data(), sizeof(uint64_t), nCount, pStates) == nCount;
+		bOk = bOk && fwrite(aWindow[0].aValues.data(), sizeof(float), nCount, pValues) == nCount;
+		aIndex[nSum / 2] = sRetrogradeLayer{ nWritten, nCount };
+		nWritten += nCount;
+
+		if (options.bVerbose)
+			printf("backward sum %5d  %12llu states\n", nSum, (unsigned long long)nCount);
+	}
+
+	for (const auto& layer : aLayers)
+		remove(GetLayerFile(sPrefix, layer.first).c_str());
+
+	if (pStates != nullptr)
+		bOk = (fclose(pStates) == 0) && bOk;
+	if (pValues != nullptr)
+		bOk = (fclose(pValues) == 0) && bOk;
+
+	if (bOk) {
+		sRetrogradeInfo info = { (uint32_t)W, (uint32_t)H, nWritten, (uint32_t)aIndex.size(), 0 };
+
+		vector<sTableData> aTables;
+		aTables.push_back({ "retro_info", &info, sizeof(info) });
+		aTables.push_back({ "retro_layers", aIndex.data(), aIndex.size() * sizeof(sRetrogradeLayer) });
+		aTables.push_back({ "retro_states", nullptr, nWritten * sizeof(uint64_t), sStatesFile });
+		aTables.push_back({ "retro_values", nullptr, nWritten * sizeof(float), sValuesFile });
+		bOk = cTableFile::Write(sFileName.c_str(), aTables);
+		stats.nTableBytes = nWritten * (sizeof(uint64_t) + sizeof(float));
+	}
+
+	remove(sStatesFile.c_str());
+	remove(sValuesFile.c_str());
+
+	auto tp3 = chrono::steady_clock::now();
+	stats.fBackwardSeconds = chrono::duration<double>(tp3 - tp2).count();
+
+	return bOk;
+}
+
+/**
+ * Solved table of cRetrograde, mapped from its file
+ *
+ * Knows the value of every position that can come up in a game, so it
+ * tells the best move and how much a move costs compared to it.
+ */
+template<int W, int H>
+class cRetrogradeTable
+{
+public:
+	typedef cRetrograde<W, H> solver;
+	typedef typename solver::bits_t bits_t;
+
+public:
+	bool Open(const char* sFileName);
+	const string& GetError() const { return m_sError; }
+	uint64_t GetStateCount() const { return m_pInfo != nullptr ? m_pInfo->nStateCount : 0; }
+
+	// Expected score still to come, false if the board can not be reached
+	bool GetValue(bits_t nBoard, float& fValue) const;
+
+	// Same as cRetrograde::GetMoveValue, -1 if the move is not possible
+	double GetMoveValue(bits_t nBoard, ROTATION nDir) const;
+
+	// Returns false if there is no move
+	bool GetBestMove(bits_t nBoard, ROTATION& nMove, double& fValue) const;
+
+	// Expected score of a game with perfect play
+	double GetStartValue() const;
+
+private:
+	float Lookup(uint64_t nState, int nSum) const;
+
+private:
+	cTableFile m_file;
+	const sRetrogradeInfo* m_pInfo = nullptr;
+	const sRetrogradeLayer* m_pLayers = nullptr;
+	const uint64_t* m_pStates = nullptr;
+	const float* m_pValues = nullptr;
+	string m_sError;
+};
+
+template<int W, int H>
+bool cRetrogradeTable<W, H>::Open(const char* sFileName)
+{
+	solver::InitTables();
+	m_pInfo = nullptr;
+
+	if (!m_file.Open(sFileName)) {
+		m_sError = m_file.GetError();
+		return false;
+	}
+
+	const sRetrogradeInfo* pInfo = (const sRetrogradeInfo*)m_file.Find("retro_info", sizeof(sRetrogradeInfo));
+	if (pInfo == nullptr || pInfo->nWidth != (uint32_t)W || pInfo->nHeight != (uint32_t)H) {
+		m_sError = "not a solved " + to_string(W) + "x" + to_string(H) + " table";
+		return false;
+	}
+
+	m_pLayers = (const sRetrogradeLayer*)m_file.Find("retro_layers", pInfo->nLayerSlots * sizeof(sRetrogradeLayer));
+	m_pStates = (const uint64_t*)m_file.Find("retro_states", pInfo->nStateCount * sizeof(uint64_t));
+	m_pValues = (const float*)m_file.Find("retro_values", pInfo->nStateCount * sizeof(float));
+	if (m_pLayers == nullptr || (pInfo->nStateCount > 0 && (m_pStates == nullptr || m_pValues == nullptr))) {
+		m_sError = "table sections are missing";
+		return false;
+	}
+
+	m_pInfo = pInfo;
+	return true;
+}
+
+template<int W, int H>
+float cRetrogradeTable<W, H>::Lookup(uint64_t nState, int nSum) const
+{
+	if (nSum / 2 >= (int)m_pInfo->nLayerSlots)
+		return 0.0f;
+
+	const sRetrogradeLayer& layer = m_pLayers[nSum / 2];
+	const uint64_t* pBegin = m_pStates + layer.nFirst;
+	const uint64_t* pEnd = pBegin + layer.nCount;
+
+	const uint64_t* p = lower_bound(pBegin, pEnd, nState);
+	return p != pEnd && *p == nState ? m_pValues[p - m_pStates] : 0.0f;
+}
+
+template<int W, int H>
+bool cRetrogradeTable<W, H>::GetValue(bits_t nBoard, float& fValue) const
+{
+	bits_t nState = solver::Canonical(nBoard);
+	int nSum = solver::GetTileSum(nBoard);
+	if (nSum / 2 >= (int)m_pInfo->nLayerSlots)
+		return false;
+
+	const sRetrogradeLayer& layer = m_pLayers[nSum / 2];
+	const uint64_t* pBegin = m_pStates + layer.nFirst;
+	const uint64_t* pEnd = pBegin + layer.nCount;
+
+	const uint64_t* p = lower_bound(pBegin, pEnd, nState);
+	if (p == pEnd || *p != nState)
+		return false;
+
+	fValue = m_pValues[p - m_pStates];
+	return true;
+}
+
+template<int W, int H>
+double cRetrogradeTable<W, H>::GetMoveValue(bits_t nBoard, ROTATION nDir) const
+{
+	return solver::GetMoveValue(nBoard, solver::GetTileSum(nBoard), nDir, [this](uint64_t nState, int nSum) { return Lookup(nState, nSum); });
+}
+
+template<int W, int H>
+bool cRetrogradeTable<W, H>::GetBestMove(bits_t nBoard, ROTATION& nMove, double& fValue) const
+{
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	bool bFound = false;
+	for (ROTATION nDir : aDirections) {
+		double fMoveValue = GetMoveValue(nBoard, nDir);
+		if (fMoveValue >= 0.0 && (!bFound || fMoveValue > fValue)) {
+			nMove = nDir;
+			fValue = fMoveValue;
+			bFound = true;
+		}
+	}
+
+	return bFound;
+}
+
+/**
+ * A game starts with two new tiles, same as cGame
+ */
+template<int W, int H>
+double cRetrogradeTable<W, H>::GetStartValue() const
+{
+	static const int CELL_COUNT = solver::CELL_COUNT;
+	static const double aChance[3] = { 0.0, 0.9, 0.1 };
+
+	double fSum = 0.0;
+	for (int i = 0; i < CELL_COUNT; i++) {
+		for (int j = 0; j < CELL_COUNT; j++) {
+			if (i == j)
+				continue;
+
+			for (int a = 1; a <= 2; a++) {
+				for (int b = 1; b <= 2; b++) {
+					bits_t nBoard = ((bits_t)a << (i * 4)) | ((bits_t)b << (j * 4));
+					float fValue = 0.0f;
+					GetValue(nBoard, fValue);
+					fSum += aChance[a] * aChance[b] * fValue;
+				}
+			}
+		}
+	}
+
+	return fSum / (CELL_COUNT * (CELL_COUNT - 1));
+}
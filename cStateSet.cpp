@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <memory>
+#include <queue>
+
+#include "cStateSet.h"
+
+static void SortUnique(vector<uint64_t>& aStates)
+{
+	sort(aStates.begin(), aStates.end());
+	aStates.erase(unique(aStates.begin(), aStates.end()), aStates.end());
+}
+
+static bool WriteStates(const string& sFileName, const vector<uint64_t>& aStates)
+{
+	FILE* pFile = fopen(sFileName.c_str(), "wb");
+	if (pFile == nullptr)
+		return false;
+
+	bool bOk = fwrite(aStates.data(), sizeof(uint64_t), aStates.size(), pFile) == aStates.size();
+	return (fclose(pFile) == 0) && bOk;
+}
+
+cStateSet::cStateSet(const string& sTempPrefix, size_t nMaxStates)
+	: m_sTempPrefix(sTempPrefix), m_nMaxStates(max((size_t)1, nMaxStates))
+{
+}
+
+cStateSet::~cStateSet()
+{
+	for (const string& sRun : m_aRuns)
+		remove(sRun.c_str());
+}
+
+void cStateSet::Spill()
+{
+	SortUnique(m_aBuffer);
+
+	string sRun = m_sTempPrefix + ".run" + to_string(m_aRuns.size());
+	m_bFailed |= !WriteStates(sRun, m_aBuffer);
+	m_aRuns.push_back(sRun);
+	m_nRunCount++;
+	m_nSpilledBytes += m_aBuffer.size() * sizeof(uint64_t);
+
+	m_aBuffer.clear();
+}
+
+/**
+ * Merges the runs with a heap, which always holds the next state of
+ * every run that is not done yet
+ */
+bool cStateSet::Finish(const string& sFileName, uint64_t& nCount)
+{
+	SortUnique(m_aBuffer);
+	nCount = 0;
+
+	if (m_aRuns.empty()) {
+		nCount = m_aBuffer.size();
+		bool bOk = WriteStates(sFileName, m_aBuffer);
+		vector<uint64_t>().swap(m_aBuffer);
+		return bOk && !m_bFailed;
+	}
+
+	// The buffer takes part in the merge as one more run
+	Spill();
+	vector<uint64_t>().swap(m_aBuffer);
+
+	vector<unique_ptr<cStateReader>> aReaders;
+	typedef pair<uint64_t, size_t> entry_t;
+	priority_queue<entry_t, vector<entry_t>, greater<entry_t>> heap;
+
+	for (const string& sRun : m_aRuns) {
+		aReaders.push_back(unique_ptr<cStateReader>(new cStateReader(sRun)));
+		m_bFailed |= !aReaders.back()->IsOpen();
+
+		uint64_t nState;
+		if (aReaders.back()->IsOpen() && aReaders.back()->Next(nState))
+			heap.push(entry_t(nState, aReaders.size() - 1));
+	}
+
+	FILE* pFile = fopen(sFileName.c_str(), "wb");
+	if (pFile == nullptr)
+		return false;
+
+	vector<uint64_t> aOut;
+	aOut.reserve(1 << 16);
+	bool bOk = true;
+	bool bHasLast = false;
+	uint64_t nLast = 0;
+
+	while (!heap.empty() && bOk) {
+		entry_t top = heap.top();
+		heap.pop();
+
+		if (!bHasLast || top.first != nLast) {
+			aOut.push_back(top.first);
+			nLast = top.first;
+			bHasLast = true;
+			nCount++;
+
+			if (aOut.size() == aOut.capacity()) {
+				bOk = fwrite(aOut.data(), sizeof(uint64_t), aOut.size(), pFile) == aOut.size();
+				aOut.clear();
+			}
+		}
+
+		uint64_t nState;
+		if (aReaders[top.second]->Next(nState))
+			heap.push(entry_t(nState, top.second));
+	}
+
+	bOk = bOk && fwrite(aOut.data(), sizeof(uint64_t), aOut.size(), pFile) == aOut.size();
+	bOk = (fclose(pFile) == 0) && bOk;
+
+	aReaders.clear();
+	for (const string& sRun : m_aRuns)
+		remove(sRun.c_str());
+	m_aRuns.clear();
+
+	return bOk && !m_bFailed;
+}
+
+cStateReader::cStateReader(const string& sFileName) : m_aBuffer(BUFFER_STATES)
+{
+	m_pFile = fopen(sFileName.c_str(), "rb");
+}
+
+cStateReader::~cStateReader()
+{
+	if (m_pFile != nullptr)
+		fclose(m_pFile);
+}
+
+bool cStateReader::Next(uint64_t& nState)
+{
+	if (m_nPosition == m_nCount) {
+		m_nCount = fread(m_aBuffer.data(), sizeof(uint64_t), BUFFER_STATES, m_pFile);
+		m_nPosition = 0;
+		if (m_nCount == 0)
+			return false;
+	}
+
+	nState = m_aBuffer[m_nPosition++];
+	return true;
+}
+
+bool cStateReader::ReadAll(const string& sFileName, vector<uint64_t>& aStates)
+{
+	aStates.clear();
+
+	cStateReader reader(sFileName);
+	if (!reader.IsOpen())
+		return false;
+
+	uint64_t nState;
+	while (reader.Next(nState))
+		aStates.push_back(nState);
+
+	return true;
+}
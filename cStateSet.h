@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Set of 64 bit states which can be bigger than memory
+ *
+ * Add collects states in a buffer of at most nMaxStates. A full buffer
+ * is sorted, cleared of duplicates and written to disk as a run, and
+ * Finish merges all runs and the rest of the buffer into one sorted
+ * file without duplicates. Files are raw states in machine byte order.
+ */
+class cStateSet
+{
+public:
+	// Runs are written to sTempPrefix.runN and removed again
+	cStateSet(const string& sTempPrefix, size_t nMaxStates);
+	~cStateSet();
+
+	cStateSet(const cStateSet&) = delete;
+	cStateSet& operator=(const cStateSet&) = delete;
+
+	void Add(uint64_t nState)
+	{
+		m_aBuffer.push_back(nState);
+		if (m_aBuffer.size() >= m_nMaxStates)
+			Spill();
+	}
+
+	// Returns false if a file could not be written
+	bool Finish(const string& sFileName, uint64_t& nCount);
+
+	int GetRunCount() const { return m_nRunCount; }
+	uint64_t GetSpilledBytes() const { return m_nSpilledBytes; }
+
+private:
+	void Spill();
+
+private:
+	string m_sTempPrefix;
+	size_t m_nMaxStates;
+	vector<uint64_t> m_aBuffer;
+	vector<string> m_aRuns;
+	int m_nRunCount = 0;
+	uint64_t m_nSpilledBytes = 0;
+	bool m_bFailed = false;
+};
+
+/**
+ * Reads a file of states front to back through a buffer
+ */
+class cStateReader
+{
+public:
+	cStateReader(const string& sFileName);
+	~cStateReader();
+
+	cStateReader(const cStateReader&) = delete;
+	cStateReader& operator=(const cStateReader&) = delete;
+
+	bool IsOpen() const { return m_pFile != nullptr; }
+	bool Next(uint64_t& nState);
+
+	// Reads the whole file
+	static bool ReadAll(const string& sFileName, vector<uint64_t>& aStates);
+
+private:
+	static const size_t BUFFER_STATES = 1 << 16;
+
+	FILE* m_pFile = nullptr;
+	vector<uint64_t> m_aBuffer;
+	size_t m_nPosition = 0;
+	size_t m_nCount = 0;
+};
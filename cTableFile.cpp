@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cTableFile.h"
+
+static const char s_sMagic[8] = { '2', '0', '4', '8', 'T', 'B', 'L', 0 };
+
+static const uint64_t K1 = 0x9E3779B97F4A7C15ULL;
+static const uint64_t K2 = 0xFF51AFD7ED558CCDULL;
+
+// Tables from files are read and copied in pieces of this size
+static const size_t COPY_CHUNK = 1 << 20;
+
+/**
+ * cTableFile::Checksum over data which comes in pieces. Every piece but
+ * the last one has to be a multiple of 32 bytes.
+ */
+struct sChecksum {
+	uint64_t aLanes[4];
+
+	sChecksum(uint64_t nSize) : aLanes{ nSize, K1, K2, ~nSize } {}
+
+	void Update(const uint8_t* p, uint64_t nSize)
+	{
+		for (uint64_t i = 0; i + 32 <= nSize; i += 32) {
+			for (int k = 0; k < 4; k++) {
+				uint64_t nWord;
+				memcpy(&nWord, p + i + k * 8, 8);
+				aLanes[k] = (aLanes[k] ^ nWord) * K2;
+				aLanes[k] ^= aLanes[k] >> 29;
+			}
+		}
+	}
+
+	// The last piece, blocks and tail
+	uint64_t Finish(const uint8_t* p, uint64_t nSize)
+	{
+		uint64_t nBlocks = nSize / 32 * 32;
+		Update(p, nBlocks);
+
+		uint64_t nHash = 0;
+		for (int k = 0; k < 4; k++)
+			nHash = (nHash ^ aLanes[k]) * K1;
+
+		for (uint64_t i = nBlocks; i < nSize; i++)
+			nHash = (nHash ^ p[i]) * K2;
+
+		nHash ^= nHash >> 32;
+		return nHash;
+	}
+};
+
+/**
+ * Reads the table from its source file, or hands back pData, in pieces
+ * of at most COPY_CHUNK bytes
+ */
+class cTableReader
+{
+public:
+	cTableReader(const sTableData& table) : m_table(table)
+	{
+		if (table.pData == nullptr && !table.sSourceFile.empty())
+			m_pFile = fopen(table.sSourceFile.c_str(), "rb");
+	}
+
+	~cTableReader()
+	{
+		if (m_pFile != nullptr)
+			fclose(m_pFile);
+	}
+
+	bool IsOpen() const { return m_table.pData != nullptr || m_pFile != nullptr || m_table.nSize == 0; }
+
+	// Returns nullptr at the end or if the file is too short
+	const uint8_t* Next(uint64_t& nSize)
+	{
+		nSize = min((uint64_t)COPY_CHUNK, m_table.nSize - m_nRead);
+		if (nSize == 0)
+			return nullptr;
+
+		const uint8_t* pData;
+		if (m_table.pData != nullptr)
+			pData = (const uint8_t*)m_table.pData + m_nRead;
+		else {
+			m_aBuffer.resize(COPY_CHUNK);
+			if (fread(m_aBuffer.data(), 1, (size_t)nSize, m_pFile) != nSize)
+				return nullptr;
+			pData = m_aBuffer.data();
+		}
+
+		m_nRead += nSize;
+		return pData;
+	}
+
+	bool IsDone() const { return m_nRead == m_table.nSize; }
+
+private:
+	const sTableData& m_table;
+	FILE* m_pFile = nullptr;
+	vector<uint8_t> m_aBuffer;
+	uint64_t m_nRead = 0;
+};
+
+/**
+ * Checksum of a table in memory or in its source file
+ */
+static bool ChecksumTable(const sTableData& table, uint64_t& nChecksum)
+{
+	cTableReader reader(table);
+	if (!reader.IsOpen())
+		return false;
+
+	sChecksum checksum(table.nSize);
+	uint64_t nSize;
+	const uint8_t* pData;
+
+	while ((pData = reader.Next(nSize)) != nullptr) {
+		if (reader.IsDone()) {
+			nChecksum = checksum.Finish(pData, nSize);
+			return true;
+		}
+		checksum.Update(pData, nSize);
+	}
+
+	// Empty table, or the file was too short
+	nChecksum = checksum.Finish(nullptr, 0);
+	return table.nSize == 0;
+}
+
+cTableFile::~cTableFile()
+{
+	Close();
+}
+
+bool cTableFile::Fail(const string& sError)
+{
+	Close();
+	m_sError = sError;
+	return false;
+}
+
+bool cTableFile::Open(const char* sFileName, bool bVerify)
+{
+	Close();
+	m_sError.clear();
+
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA(sFileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return Fail("cannot open file");
+	m_hFile = hFile;
+
+	LARGE_INTEGER nFileSize;
+	if (!GetFileSizeEx(hFile, &nFileSize) || nFileSize.QuadPart < (LONGLONG)sizeof(sHeader))
+		return Fail("file too small");
+
+	m_hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hMapping == nullptr)
+		return Fail("cannot map file");
+
+	m_pData = (const uint8_t*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_pData == nullptr)
+		return Fail("cannot map file");
+	m_nSize = (uint64_t)nFileSize.QuadPart;
+#else
+	int nFile = open(sFileName, O_RDONLY);
+	if (nFile < 0)
+		return Fail("cannot open file");
+
+	struct stat info;
+	if (fstat(nFile, &info) != 0 || info.st_size < (off_t)sizeof(sHeader)) {
+		close(nFile);
+		return Fail("file too small");
+	}
+
+	// The mapping stays valid after the file is closed
+	void* pData = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, nFile, 0);
+	close(nFile);
+	if (pData == MAP_FAILED)
+		return Fail("cannot map file");
+
+	m_pData = (const uint8_t*)pData;
+	m_nSize = (uint64_t)info.st_size;
+#endif
+
+	const sHeader* pHeader = (const sHeader*)m_pData;
+	if (memcmp(pHeader->sMagic, s_sMagic, sizeof(s_sMagic)) != 0)
+		return Fail("not a table file");
+	if (pHeader->nVersion != VERSION)
+		return Fail("wrong version");
+	if (pHeader->nFileSize != m_nSize)
+		return Fail("wrong file size");
+
+	uint64_t nSectionsSize = (uint64_t)pHeader->nSectionCount * sizeof(sSection);
+	if (nSectionsSize > m_nSize - sizeof(sHeader))
+		return Fail("damaged section list");
+
+	const sSection* aSections = GetSections();
+	if (Checksum(aSections, nSectionsSize) != pHeader->nChecksum)
+		return Fail("damaged section list");
+
+	for (uint32_t i = 0; i < pHeader->nSectionCount; i++) {
+		const sSection& section = aSections[i];
+		if (section.sName[MAX_NAME_LENGTH] != 0)
+			return Fail("damaged section list");
+		if (section.nOffset % ALIGNMENT != 0 || section.nOffset > m_nSize || section.nSize > m_nSize - section.nOffset)
+			return Fail(string("damaged section ") + section.sName);
+
+		if (bVerify && Checksum(m_pData + section.nOffset, section.nSize) != section.nChecksum)
+			return Fail(string("wrong checksum in section ") + section.sName);
+	}
+
+	return true;
+}
+
+void cTableFile::Close()
+{
+#if defined(_WIN32)
+	if (m_pData != nullptr)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping != nullptr)
+		CloseHandle(m_hMapping);
+	if (m_hFile != nullptr)
+		CloseHandle(m_hFile);
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+#else
+	if (m_pData != nullptr)
+		munmap((void*)m_pData, (size_t)m_nSize);
+#endif
+
+	m_pData = nullptr;
+	m_nSize = 0;
+}
+
+void cTableFile::Swap(cTableFile& other)
+{
+	swap(m_pData, other.m_pData);
+	swap(m_nSize, other.m_nSize);
+	swap(m_sError, other.m_sError);
+#if defined(_WIN32)
+	swap(m_hFile, other.m_hFile);
+	swap(m_hMapping, other.m_hMapping);
+#endif
+}
+
+const void* cTableFile::Find(const char* sName, uint64_t nSize) const
+{
+	if (m_pData == nullptr)
+		return nullptr;
+
+	const sSection* aSections = GetSections();
+	for (int i = 0; i < GetSectionCount(); i++) {
+		if (strncmp(aSections[i].sName, sName, MAX_NAME_LENGTH + 1) == 0)
+			return aSections[i].nSize == nSize ? m_pData + aSections[i].nOffset : nullptr;
+	}
+
+	return nullptr;
+}
+
+int cTableFile::GetSectionCount() const
+{
+	return m_pData != nullptr ? (int)((const sHeader*)m_pData)->nSectionCount : 0;
+}
+
+const char* cTableFile::GetSectionName(int nSection) const
+{
+	return GetSections()[nSection].sName;
+}
+
+uint64_t cTableFile::GetSectionSize(int nSection) const
+{
+	return GetSections()[nSection].nSize;
+}
+
+const void* cTableFile::GetSectionData(int nSection) const
+{
+	return m_pData + GetSections()[nSection].nOffset;
+}
+
+/**
+ * Writes to a temporary file first, so a file is never half written
+ */
+bool cTableFile::Write(const char* sFileName, const vector<sTableData>& aTables)
+{
+	sHeader header = {};
+	memcpy(header.sMagic, s_sMagic, sizeof(s_sMagic));
+	header.nVersion = VERSION;
+	header.nSectionCount = (uint32_t)aTables.size();
+
+	vector<sSection> aSections(aTables.size());
+	uint64_t nOffset = sizeof(sHeader) + aSections.size() * sizeof(sSection);
+
+	for (size_t i = 0; i < aTables.size(); i++) {
+		if (aTables[i].sName.size() > (size_t)MAX_NAME_LENGTH)
+			return false;
+
+		sSection& section = aSections[i];
+		memset(&section, 0, sizeof(section));
+		memcpy(section.sName, aTables[i].sName.c_str(), aTables[i].sName.size());
+		section.nOffset = (nOffset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+		section.nSize = aTables[i].nSize;
+		if (!ChecksumTable(aTables[i], section.nChecksum))
+			return false;
+		nOffset = section.nOffset + section.nSize;
+	}
+
+	header.nFileSize = nOffset;
+	header.nChecksum = Checksum(aSections.data(), aSections.size() * sizeof(sSection));
+
+	string sTempName = string(sFileName) + ".tmp";
+	FILE* pFile = fopen(sTempName.c_str(), "wb");
+	if (pFile == nullptr)
+		return false;
+
+	bool bOk = fwrite(&header, sizeof(header), 1, pFile) == 1
+		&& fwrite(aSections.data(), sizeof(sSection), aSections.size(), pFile) == aSections.size();
+
+	// Pad every section up to its aligned offset
+	static const uint8_t aZeros[ALIGNMENT] = { 0 };
+	uint64_t nWritten = sizeof(sHeader) + aSections.size() * sizeof(sSection);
+
+	for (size_t i = 0; i < aTables.size() && bOk; i++) {
+		uint64_t nPadding = aSections[i].nOffset - nWritten;
+		bOk = fwrite(aZeros, 1, (size_t)nPadding, pFile) == nPadding;
+
+		cTableReader reader(aTables[i]);
+		uint64_t nSize;
+		const uint8_t* pData;
+		while (bOk && (pData = reader.Next(nSize)) != nullptr)
+			bOk = fwrite(pData, 1, (size_t)nSize, pFile) == nSize;
+
+		bOk = bOk && reader.IsDone();
+		nWritten = aSections[i].nOffset + aSections[i].nSize;
+	}
+
+	bOk = (fclose(pFile) == 0) && bOk;
+
+	if (bOk) {
+		remove(sFileName);
+		bOk = rename(sTempName.c_str(), sFileName) == 0;
+	}
+
+	return bOk;
+}
+
+/**
+ * Fast 64 bit checksum, four independent multiply chains over 32 byte blocks
+ */
+uint64_t cTableFile::Checksum(const void* pData, uint64_t nSize)
+{
+	return sChecksum(nSize).Finish((const uint8_t*)pData, nSize);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Describes one table when a file is written. A table which is too big
+// for memory has no pData and is copied from sSourceFile instead.
+struct sTableData {
+	string sName;
+	const void* pData;
+	uint64_t nSize;
+	string sSourceFile = "";
+};
+
+/**
+ * Read only file of precomputed tables, mapped into memory
+ *
+ * The file starts with a header and a list of sections, followed by the
+ * data of every section. Every section starts at a multiple of
+ * ALIGNMENT, so the tables can be used in place straight from the
+ * mapping, and processes which map the same file share its pages.
+ * Every section has a checksum, and the header has a checksum over the
+ * section list, which are verified when the file is opened.
+ *
+ * Files are written in the byte order of the machine and are rejected
+ * if the version does not match.
+ */
+class cTableFile
+{
+public:
+	static const uint32_t VERSION = 1;
+	static const uint64_t ALIGNMENT = 4096;
+	static const int MAX_NAME_LENGTH = 23;
+
+public:
+	cTableFile() {}
+	~cTableFile();
+
+	cTableFile(const cTableFile&) = delete;
+	cTableFile& operator=(const cTableFile&) = delete;
+
+	// Maps the file, returns false if it is missing or damaged
+	bool Open(const char* sFileName, bool bVerify = true);
+	void Close();
+	void Swap(cTableFile& other);
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	// Returns the section or nullptr if there is none with that name and size
+	const void* Find(const char* sName, uint64_t nSize) const;
+
+	int GetSectionCount() const;
+	const char* GetSectionName(int nSection) const;
+	uint64_t GetSectionSize(int nSection) const;
+	const void* GetSectionData(int nSection) const;
+
+	const string& GetError() const { return m_sError; }
+
+	static bool Write(const char* sFileName, const vector<sTableData>& aTables);
+	static uint64_t Checksum(const void* pData, uint64_t nSize);
+
+private:
+	struct sHeader {
+		char sMagic[8];
+		uint32_t nVersion;
+		uint32_t nSectionCount;
+		uint64_t nFileSize;
+		uint64_t nChecksum;
+	};
+
+	struct sSection {
+		char sName[MAX_NAME_LENGTH + 1];
+		uint64_t nOffset;
+		uint64_t nSize;
+		uint64_t nChecksum;
+	};
+
+	bool Fail(const string& sError);
+	const sSection* GetSections() const { return (const sSection*)(m_pData + sizeof(sHeader)); }
+
+private:
+	const uint8_t* m_pData = nullptr;
+	uint64_t m_nSize = 0;
+	string m_sError;
+
+#if defined(_WIN32)
+	void* m_hFile = nullptr;
+	void* m_hMapping = nullptr;
+#endif
+};
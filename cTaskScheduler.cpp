@@ -0,0 +1,157 @@
+#include "cTaskScheduler.h"
+
+void sSchedulerStats::Add(const sSchedulerStats& other)
+{
+	nTasks += other.nTasks;
+	nSteals += other.nSteals;
+}
+
+cTaskScheduler::cTaskScheduler(int nThreads) : m_aWorkers(nThreads > 0 ? nThreads : max(1, (int)thread::hardware_concurrency()))
+{
+	for (int i = 0; i < GetThreadCount(); i++)
+		m_aWorkers[i].nVictim = (uint32_t)i + 1;
+
+	for (int i = 1; i < GetThreadCount(); i++)
+		m_aThreads.push_back(thread(&cTaskScheduler::WorkerThread, this, i));
+}
+
+cTaskScheduler::~cTaskScheduler()
+{
+	{
+		unique_lock<mutex> lock(m_muxRun);
+		m_bExit = true;
+	}
+	m_cvRun.notify_all();
+
+	for (thread& t : m_aThreads)
+		t.join();
+}
+
+void cTaskScheduler::Run(void (*pRun)(void* pData, int nWorker), void* pData)
+{
+	if (m_aThreads.empty()) {
+		pRun(pData, 0);
+		return;
+	}
+
+	{
+		unique_lock<mutex> lock(m_muxRun);
+		m_bRunning = true;
+		m_nRunGeneration++;
+	}
+	m_cvRun.notify_all();
+
+	pRun(pData, 0);
+
+	// Every task is done once the root returned, but the workers may
+	// still be looking for work and must be out before the next Run
+	m_bRunning = false;
+	while (m_nBusyWorkers.load() > 0)
+		this_thread::yield();
+}
+
+void cTaskScheduler::Fork(int nWorker, const sTask& task)
+{
+	sWorker& worker = m_aWorkers[nWorker];
+	unique_lock<mutex> lock(worker.muxTasks);
+	worker.aTasks.push_back(task);
+}
+
+/**
+ * Runs other tasks until all tasks counted by nPending are done
+ */
+void cTaskScheduler::Join(int nWorker, atomic<int>& nPending)
+{
+	sTask task;
+	while (nPending.load(memory_order_acquire) > 0) {
+		if (PopTask(nWorker, task) || StealTask(nWorker, task))
+			RunTask(task, nWorker);
+		else
+			this_thread::yield();
+	}
+}
+
+sSchedulerStats cTaskScheduler::GetStats() const
+{
+	sSchedulerStats stats;
+	for (const sWorker& worker : m_aWorkers)
+		stats.Add(worker.stats);
+
+	return stats;
+}
+
+bool cTaskScheduler::PopTask(int nWorker, sTask& task)
+{
+	sWorker& worker = m_aWorkers[nWorker];
+	unique_lock<mutex> lock(worker.muxTasks);
+	if (worker.aTasks.empty())
+		return false;
+
+	task = worker.aTasks.back();
+	worker.aTasks.pop_back();
+	worker.stats.nTasks++;
+	return true;
+}
+
+/**
+ * Tries every other worker once, starting at a different one each time
+ */
+bool cTaskScheduler::StealTask(int nWorker, sTask& task)
+{
+	sWorker& thief = m_aWorkers[nWorker];
+	int nCount = GetThreadCount();
+
+	for (int i = 0; i < nCount; i++) {
+		int nVictim = (int)(thief.nVictim++ % (uint32_t)nCount);
+		if (nVictim == nWorker)
+			continue;
+
+		sWorker& victim = m_aWorkers[nVictim];
+		unique_lock<mutex> lock(victim.muxTasks, try_to_lock);
+		if (!lock.owns_lock() || victim.aTasks.empty())
+			continue;
+
+		task = victim.aTasks.front();
+		victim.aTasks.pop_front();
+		thief.stats.nTasks++;
+		thief.stats.nSteals++;
+		return true;
+	}
+
+	return false;
+}
+
+void cTaskScheduler::RunTask(const sTask& task, int nWorker)
+{
+	task.pRun(task.pData, nWorker);
+	task.pPending->fetch_sub(1, memory_order_release);
+}
+
+void cTaskScheduler::WorkerThread(int nWorker)
+{
+	int nGeneration = 0;
+
+	while (true) {
+		{
+			unique_lock<mutex> lock(m_muxRun);
+			m_cvRun.wait(lock, [&] { return m_bExit || m_nRunGeneration != nGeneration; });
+
+			if (m_bExit)
+				return;
+
+			nGeneration = m_nRunGeneration;
+			m_nBusyWorkers++;
+		}
+
+		// Steal until the root is done
+		sTask task;
+		while (m_bRunning.load(memory_order_acquire)) {
+			if (PopTask(nWorker, task) || StealTask(nWorker, task))
+				RunTask(task, nWorker);
+			else
+				this_thread::yield();
+		}
+
+		m_nBusyWorkers--;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+struct sSchedulerStats {
+	long long nTasks = 0;
+	long long nSteals = 0;
+
+	void Add(const sSchedulerStats& other);
+};
+
+/**
+ * Work stealing pool for fork/join tasks
+ *
+ * Every worker has its own deque. A worker pushes the tasks it forks
+ * to the back of its deque and runs them from the back again, idle
+ * workers steal from the front of the other deques, so they take the
+ * oldest and biggest tasks. A worker which waits for its tasks keeps
+ * running tasks meanwhile instead of blocking.
+ *
+ * Worker 0 is the thread which calls Run, so only nThreads - 1
+ * additional threads are started. Between two calls of Run the
+ * workers sleep.
+ */
+class cTaskScheduler
+{
+public:
+	struct sTask {
+		void (*pRun)(void* pData, int nWorker);
+		void* pData;
+		atomic<int>* pPending;	// decremented when the task is done
+	};
+
+public:
+	cTaskScheduler(int nThreads = 0);
+	~cTaskScheduler();
+
+	int GetThreadCount() const { return (int)m_aWorkers.size(); }
+
+	// Runs pRun on the calling thread as worker 0 while all workers
+	// help with the tasks it forks
+	void Run(void (*pRun)(void* pData, int nWorker), void* pData);
+
+	// Only from inside Run, nWorker is the worker which runs the caller
+	void Fork(int nWorker, const sTask& task);
+	void Join(int nWorker, atomic<int>& nPending);
+
+	sSchedulerStats GetStats() const;
+
+private:
+	struct alignas(64) sWorker {
+		mutex muxTasks;
+		deque<sTask> aTasks;
+		sSchedulerStats stats;
+		uint32_t nVictim;
+	};
+
+	bool PopTask(int nWorker, sTask& task);
+	bool StealTask(int nWorker, sTask& task);
+	static void RunTask(const sTask& task, int nWorker);
+	void WorkerThread(int nWorker);
+
+private:
+	vector<sWorker> m_aWorkers;
+	vector<thread> m_aThreads;
+
+	atomic<bool> m_bRunning{ false };
+	mutex m_muxRun;
+	condition_variable m_cvRun;
+	int m_nRunGeneration = 0;
+	atomic<int> m_nBusyWorkers{ 0 };
+	bool m_bExit = false;
+};
@@ -0,0 +1,390 @@
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <cmath>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#include "cTerminal.h"
+
+// Console colours are BGR, the ones of the terminal RGB
+static int GetAnsiColour(int nColour)
+{
+	return ((nColour & 1) << 2) | (nColour & 2) | ((nColour & 4) >> 2);
+}
+
+static void AppendNumber(int n, string& sOut)
+{
+	char aDigits[12];
+	int nDigits = 0;
+	do {
+		aDigits[nDigits++] = (char)('0' + n % 10);
+		n /= 10;
+	} while (n > 0);
+
+	while (nDigits > 0)
+		sOut += aDigits[--nDigits];
+}
+
+// Control characters and what is not a code point are shown as spaces
+static uint32_t GetCodePoint(wchar_t c)
+{
+	uint32_t n = (uint32_t)c;
+	if (n < 0x20 || n == 0x7F || (n >= 0xD800 && n < 0xE000) || n > 0x10FFFF)
+		return ' ';
+	return n;
+}
+
+static int GetGlyphBytes(wchar_t c)
+{
+	uint32_t n = GetCodePoint(c);
+	return n < 0x80 ? 1 : n < 0x800 ? 2 : n < 0x10000 ? 3 : 4;
+}
+
+static void AppendGlyph(wchar_t c, string& sOut)
+{
+	uint32_t n = GetCodePoint(c);
+	if (n < 0x80)
+		sOut += (char)n;
+	else if (n < 0x800) {
+		sOut += (char)(0xC0 | (n >> 6));
+		sOut += (char)(0x80 | (n & 0x3F));
+	}
+	else if (n < 0x10000) {
+		sOut += (char)(0xE0 | (n >> 12));
+		sOut += (char)(0x80 | ((n >> 6) & 0x3F));
+		sOut += (char)(0x80 | (n & 0x3F));
+	}
+	else {
+		sOut += (char)(0xF0 | (n >> 18));
+		sOut += (char)(0x80 | ((n >> 12) & 0x3F));
+		sOut += (char)(0x80 | ((n >> 6) & 0x3F));
+		sOut += (char)(0x80 | (n & 0x3F));
+	}
+}
+
+cTerminal::cTerminal()
+{
+}
+
+cTerminal::~cTerminal()
+{
+	Close();
+}
+
+void cTerminal::SetSize(int nWidth, int nHeight)
+{
+	m_nWidth = nWidth;
+	m_nHeight = nHeight;
+	m_aLast.assign((size_t)nWidth * nHeight, sTerminalCell());
+	Invalidate();
+}
+
+void cTerminal::Invalidate()
+{
+	m_bValid = false;
+}
+
+void cTerminal::MoveCursor(const sTerminalCell* aCells, int x, int y, string& sOut)
+{
+	if (m_nCursorY == y && m_nCursorX == x)
+		return;
+
+	if (m_nCursorY == y && m_nCursorX >= 0 && m_nCursorX < x) {
+		int nGap = x - m_nCursorX;
+		int nJumpBytes = nGap == 1 ? 3 : nGap < 10 ? 4 : 5;
+
+		// Writing the cells in between again is fine if the terminal
+		// shows them already, and if it is shorter and keeps the colours
+		int nGapBytes = 0;
+		bool bSame = true;
+		for (int i = m_nCursorX; i < x && bSame && nGapBytes <= nJumpBytes; i++) {
+			const sTerminalCell& last = m_aLast[y * m_nWidth + i];
+			bSame = (last.Attributes & 0xFF) == m_nAttributes && last.Attributes == aCells[y * m_nWidth + i].Attributes &&
+				last.Char.UnicodeChar == aCells[y * m_nWidth + i].Char.UnicodeChar;
+			nGapBytes += GetGlyphBytes(last.Char.UnicodeChar);
+		}
+
+		if (bSame && nGapBytes <= nJumpBytes) {
+			for (int i = m_nCursorX; i < x; i++)
+				AppendGlyph(m_aLast[y * m_nWidth + i].Char.UnicodeChar, sOut);
+		}
+		else {
+			sOut += "\x1b[";
+			if (nGap > 1)
+				AppendNumber(nGap, sOut);
+			sOut += 'C';
+		}
+	}
+	else {
+		sOut += "\x1b[";
+		AppendNumber(y + 1, sOut);
+		sOut += ';';
+		AppendNumber(x + 1, sOut);
+		sOut += 'H';
+	}
+
+	m_nCursorX = x;
+	m_nCursorY = y;
+}
+
+void cTerminal::SetAttributes(uint16_t nAttributes, string& sOut)
+{
+	int nNew = nAttributes & 0xFF;
+	if (nNew == m_nAttributes)
+		return;
+
+	int nForeground = GetAnsiColour(nNew & 0x0F) + ((nNew & 0x08) ? 90 : 30);
+	int nBackground = GetAnsiColour(nNew >> 4) + ((nNew & 0x80) ? 100 : 40);
+
+	sOut += "\x1b[";
+	if (m_nAttributes < 0 || (m_nAttributes & 0x0F) != (nNew & 0x0F)) {
+		AppendNumber(nForeground, sOut);
+		if (m_nAttributes < 0 || (m_nAttributes & 0xF0) != (nNew & 0xF0))
+			sOut += ';';
+	}
+	if (m_nAttributes < 0 || (m_nAttributes & 0xF0) != (nNew & 0xF0))
+		AppendNumber(nBackground, sOut);
+	sOut += 'm';
+
+	m_nAttributes = nNew;
+}
+
+void cTerminal::Encode(const sTerminalCell* aCells, string& sOut, bool bFull)
+{
+	sDirtyRect all = { 0, 0, m_nWidth, m_nHeight };
+	Encode(aCells, &all, 1, sOut, bFull);
+}
+
+void cTerminal::Encode(const sTerminalCell* aCells, const sDirtyRect* aRects, int nRects, string& sOut, bool bFull)
+{
+	// Nothing of the last frame is known, so the screen is cleared too
+	sDirtyRect all = { 0, 0, m_nWidth, m_nHeight };
+	if (!m_bValid) {
+		sOut += "\x1b[0m\x1b[2J";
+		m_nAttributes = -1;
+		m_nCursorX = -1;
+		m_nCursorY = -1;
+		aRects = &all;
+		nRects = 1;
+		bFull = true;
+	}
+
+	for (int r = 0; r < nRects; r++) {
+		const sDirtyRect& rect = aRects[r];
+		for (int y = rect.y1; y < rect.y2; y++) {
+			for (int x = rect.x1; x < rect.x2; x++) {
+				const sTerminalCell& cell = aCells[y * m_nWidth + x];
+				sTerminalCell& last = m_aLast[y * m_nWidth + x];
+
+				if (!bFull && cell.Char.UnicodeChar == last.Char.UnicodeChar && cell.Attributes == last.Attributes)
+					continue;
+
+				MoveCursor(aCells, x, y, sOut);
+				SetAttributes(cell.Attributes, sOut);
+				AppendGlyph(cell.Char.UnicodeChar, sOut);
+				last = cell;
+				m_stats.nCells++;
+
+				// Where the cursor goes after the last column differs
+				m_nCursorX = x + 1 < m_nWidth ? x + 1 : -1;
+				if (m_nCursorX < 0)
+					m_nCursorY = -1;
+			}
+		}
+	}
+
+	m_bValid = true;
+	m_stats.nFrames++;
+}
+
+void cTerminal::SetTitle(const wstring& sTitle)
+{
+	string sNew;
+	for (wchar_t c : sTitle)
+		AppendGlyph(c, sNew);
+
+	if (sNew != m_sTitle) {
+		m_sTitle = sNew;
+		m_bTitleChanged = true;
+	}
+}
+
+bool cTerminal::Present(const sTerminalCell* aCells)
+{
+	sDirtyRect all = { 0, 0, m_nWidth, m_nHeight };
+	return Present(aCells, &all, 1);
+}
+
+bool cTerminal::Present(const sTerminalCell* aCells, const sDirtyRect* aRects, int nRects)
+{
+	m_sFrame.clear();
+	Encode(aCells, aRects, nRects, m_sFrame);
+
+	if (m_bTitleChanged) {
+		m_sFrame += "\x1b]0;";
+		m_sFrame += m_sTitle;
+		m_sFrame += '\x07';
+		m_bTitleChanged = false;
+	}
+
+	if (m_sFrame.empty())
+		return true;
+
+	m_stats.nWrites++;
+	m_stats.nBytes += m_sFrame.size();
+	return Write(m_sFrame);
+}
+
+#if defined(_WIN32)
+
+bool cTerminal::Open(int nWidth, int nHeight)
+{
+	return false;
+}
+
+void cTerminal::Close()
+{
+}
+
+int cTerminal::ReadKeys(int* aKeys, int nMaxKeys)
+{
+	return 0;
+}
+
+bool cTerminal::WaitForInput(float fSeconds)
+{
+	return false;
+}
+
+bool cTerminal::Write(const string& sData)
+{
+	return false;
+}
+
+#else
+
+bool cTerminal::Open(int nWidth, int nHeight)
+{
+	Close();
+
+	termios mode;
+	if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &mode) != 0)
+		return false;
+	m_aSavedMode.assign((const uint8_t*)&mode, (const uint8_t*)&mode + sizeof(mode));
+
+	// Keys come without echo or waiting for a line, reads never block
+	// and Ctrl+C still raises its signal
+	mode.c_lflag &= ~(ICANON | ECHO);
+	mode.c_iflag &= ~(IXON | ICRNL);
+	mode.c_cc[VMIN] = 0;
+	mode.c_cc[VTIME] = 0;
+	if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &mode) != 0)
+		return false;
+
+	m_bOpen = true;
+	m_bFocused = true;
+	m_sInput.clear();
+	SetSize(nWidth, nHeight);
+
+	// Alternate screen, no cursor, no wrapping at the last column and
+	// focus reports
+	return Write("\x1b[?1049h\x1b[?25l\x1b[?7l\x1b[?1004h");
+}
+
+void cTerminal::Close()
+{
+	if (!m_bOpen)
+		return;
+
+	Write("\x1b[0m\x1b[?1004l\x1b[?7h\x1b[?25h\x1b[?1049l");
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, (const termios*)m_aSavedMode.data());
+	m_bOpen = false;
+}
+
+/**
+ * Arrows and focus reports are escape sequences, which arrive in one
+ * read. An escape at the end of what was read is the escape key.
+ */
+int cTerminal::ReadKeys(int* aKeys, int nMaxKeys)
+{
+	char aBuffer[64];
+	ssize_t nRead;
+	while ((nRead = read(STDIN_FILENO, aBuffer, sizeof(aBuffer))) > 0)
+		m_sInput.append(aBuffer, (size_t)nRead);
+
+	int nKeys = 0;
+	size_t i = 0;
+	while (i < m_sInput.size() && nKeys < nMaxKeys) {
+		unsigned char c = (unsigned char)m_sInput[i];
+
+		if (c == 0x1B && i + 1 < m_sInput.size() && (m_sInput[i + 1] == '[' || m_sInput[i + 1] == 'O')) {
+			size_t nEnd = i + 2;
+			while (nEnd < m_sInput.size() && (m_sInput[nEnd] < 0x40 || m_sInput[nEnd] > 0x7E))
+				nEnd++;
+			if (nEnd == m_sInput.size())
+				break;
+
+			switch (m_sInput[nEnd]) {
+			case 'A': aKeys[nKeys++] = VK_UP; break;
+			case 'B': aKeys[nKeys++] = VK_DOWN; break;
+			case 'C': aKeys[nKeys++] = VK_RIGHT; break;
+			case 'D': aKeys[nKeys++] = VK_LEFT; break;
+			case 'I': m_bFocused |= m_sInput[i + 1] == '['; break;
+			case 'O': m_bFocused &= m_sInput[i + 1] != '['; break;
+			}
+
+			i = nEnd + 1;
+			continue;
+		}
+
+		// Only characters whose virtual key code is the character itself,
+		// '(' would be VK_DOWN
+		int nKey = 0;
+		if (c == 0x1B)
+			nKey = VK_ESCAPE;
+		else if (c >= 'a' && c <= 'z')
+			nKey = c - 'a' + 'A';
+		else if (c == '\r' || c == '\n')
+			nKey = VK_RETURN;
+		else if (c == '\t')
+			nKey = VK_TAB;
+		else if (c == 0x7F || c == 0x08)
+			nKey = VK_BACK;
+		else if (c == ' ' || (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z'))
+			nKey = c;
+
+		if (nKey != 0)
+			aKeys[nKeys++] = nKey;
+		i++;
+	}
+
+	m_sInput.erase(0, i);
+	return nKeys;
+}
+
+bool cTerminal::WaitForInput(float fSeconds)
+{
+	pollfd input = { STDIN_FILENO, POLLIN, 0 };
+	return poll(&input, 1, (int)ceil(fSeconds * 1000.0f)) > 0;
+}
+
+bool cTerminal::Write(const string& sData)
+{
+	size_t nWritten = 0;
+	while (nWritten < sData.size()) {
+		ssize_t n = write(STDOUT_FILENO, sData.data() + nWritten, sData.size() - nWritten);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		nWritten += (size_t)n;
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "cDirtyRects.h"
+
+#if !defined(_WIN32)
+// Windows virtual key codes of the keys a terminal reports
+#define VK_BACK		0x08
+#define VK_TAB		0x09
+#define VK_RETURN	0x0D
+#define VK_ESCAPE	0x1B
+#define VK_SPACE	0x20
+#define VK_LEFT		0x25
+#define VK_UP		0x26
+#define VK_RIGHT	0x27
+#define VK_DOWN		0x28
+#endif
+
+/**
+ * A character cell of the screen
+ *
+ * The members are named like the ones of the Win32 CHAR_INFO, so the
+ * console engine draws the same way into both.
+ */
+struct sTerminalCell {
+	union {
+		wchar_t UnicodeChar;
+		char AsciiChar;
+	} Char;
+	uint16_t Attributes;
+};
+
+// Frames without a change are not written
+struct sTerminalStats {
+	uint64_t nFrames = 0;
+	uint64_t nWrites = 0;
+	uint64_t nBytes = 0;
+	uint64_t nCells = 0;
+};
+
+/**
+ * VT terminal as the screen of the console engine
+ *
+ * The terminal keeps a copy of the frame it presented last and only
+ * writes the cells which changed since. The cursor is only moved where
+ * it is not at the next changed cell already, short gaps in a row are
+ * written over instead of jumped and colours are only set when they
+ * change, and a frame goes out with a single write(). Attributes are
+ * console colours, 4 bits foreground and 4 bits background.
+ *
+ * Encode also works without a terminal, Open, ReadKeys and Present are
+ * only there on POSIX systems.
+ */
+class cTerminal
+{
+public:
+	cTerminal();
+	~cTerminal();
+
+	cTerminal(const cTerminal&) = delete;
+	cTerminal& operator=(const cTerminal&) = delete;
+
+	// Raw input from stdin, alternate screen and no cursor on stdout
+	bool Open(int nWidth, int nHeight);
+	// Gives the terminal back the way it was
+	void Close();
+
+	// Forgets the last frame, the next one is written completely
+	void SetSize(int nWidth, int nHeight);
+	void Invalidate();
+
+	/**
+	 * Appends what turns the last frame into aCells to sOut, aCells is
+	 * the last frame afterwards. bFull writes every cell, which is what
+	 * a full redraw costs.
+	 */
+	void Encode(const sTerminalCell* aCells, string& sOut, bool bFull = false);
+
+	// Only looks at the cells in aRects, unless the last frame is not known
+	void Encode(const sTerminalCell* aCells, const sDirtyRect* aRects, int nRects, string& sOut, bool bFull = false);
+
+	// The title is written with the next frame if it changed
+	void SetTitle(const wstring& sTitle);
+
+	// Returns false if the frame could not be written
+	bool Present(const sTerminalCell* aCells);
+	bool Present(const sTerminalCell* aCells, const sDirtyRect* aRects, int nRects);
+
+	// Virtual key codes of the keys pressed since the last call
+	int ReadKeys(int* aKeys, int nMaxKeys);
+
+	// Returns false if nothing arrived within fSeconds
+	bool WaitForInput(float fSeconds);
+
+	// The terminal has to report focus changes, else it counts as focused
+	bool IsFocused() const { return m_bFocused; }
+
+	const sTerminalStats& GetStats() const { return m_stats; }
+	int GetWidth() const { return m_nWidth; }
+	int GetHeight() const { return m_nHeight; }
+
+private:
+	void MoveCursor(const sTerminalCell* aCells, int x, int y, string& sOut);
+	void SetAttributes(uint16_t nAttributes, string& sOut);
+	bool Write(const string& sData);
+
+private:
+	int m_nWidth = 0;
+	int m_nHeight = 0;
+
+	// What the terminal shows, the cursor is -1 where it is not known
+	vector<sTerminalCell> m_aLast;
+	bool m_bValid = false;
+	int m_nCursorX = -1;
+	int m_nCursorY = -1;
+	int m_nAttributes = -1;
+
+	string m_sFrame;
+	string m_sTitle;
+	bool m_bTitleChanged = false;
+
+	bool m_bOpen = false;
+	bool m_bFocused = true;
+	string m_sInput;
+	vector<uint8_t> m_aSavedMode;
+	sTerminalStats m_stats;
+};
@@ -0,0 +1,232 @@
+#include <chrono>
+
+#include "cTimeSlicedSearch.h"
+
+static const ROTATION s_aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+// Nodes between two looks at the clock
+static const int CLOCK_INTERVAL = 64;
+
+cTimeSlicedSearch::cTimeSlicedSearch(int nMaxDepth, float fProbabilityCutoff, int nTableSizeMB)
+	: m_nMaxDepth(nMaxDepth), m_fProbabilityCutoff(fProbabilityCutoff), m_pHeuristic(&cHeuristic::GetDefault()), m_table(nTableSizeMB)
+{
+}
+
+bool cTimeSlicedSearch::ChooseMove(board_t nBoard, ROTATION& nMove)
+{
+	Start(nBoard);
+	while (!Step(1.0f))
+		;
+
+	return GetBestMove(nMove);
+}
+
+void cTimeSlicedSearch::Start(board_t nBoard)
+{
+	m_table.NewSearch();
+	m_nBoard = nBoard;
+	m_nIterationDepth = 0;
+	m_nCompletedDepth = 0;
+	m_bHasBestMove = false;
+	m_bSearching = true;
+	m_aStack.clear();
+	m_arena.Reset();
+
+	StartIteration();
+}
+
+void cTimeSlicedSearch::Stop()
+{
+	m_aStack.clear();
+	m_arena.Reset();
+	m_bSearching = false;
+}
+
+bool cTimeSlicedSearch::GetBestMove(ROTATION& nMove) const
+{
+	if (m_bHasBestMove)
+		nMove = m_nBestMove;
+
+	return m_bHasBestMove;
+}
+
+/**
+ * One node per loop: a frame either starts its next child or is done
+ * and hands its value to the frame below
+ */
+bool cTimeSlicedSearch::Step(float fSeconds)
+{
+	if (!m_bSearching)
+		return true;
+
+	auto tp1 = chrono::steady_clock::now();
+	auto tpEnd = tp1 + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<float>(fSeconds));
+	int nNodes = 0;
+
+	while (m_bSearching) {
+		if (++nNodes == CLOCK_INTERVAL) {
+			nNodes = 0;
+			if (chrono::steady_clock::now() >= tpEnd)
+				break;
+		}
+
+		sFrame& frame = m_aStack.back();
+
+		if (frame.nType == FRAME_SPAWN) {
+			if (frame.nNext < frame.nSpawns) {
+				const sSpawn& spawn = frame.aSpawns[frame.nNext];
+				PushMove(FRAME_MOVE, spawn.nBoard, frame.nDepth, frame.fProbability * spawn.fProbability);
+				continue;
+			}
+
+			m_table.Store(frame.nKey, frame.nDepth, frame.fValue, m_stats.table);
+			float fValue = frame.fValue;
+			m_arena.Rewind(frame.mark);
+			m_aStack.pop_back();
+			Return(fValue);
+			continue;
+		}
+
+		// Root and move frames try the directions in turn
+		board_t nMoved = frame.nBoard;
+		while (frame.nNext < 4 && nMoved == frame.nBoard)
+			nMoved = cBoard::Move(frame.nBoard, s_aDirections[frame.nNext++]);
+
+		if (nMoved != frame.nBoard) {
+			PushSpawn(nMoved, frame.nDepth - 1, frame.fProbability);
+			continue;
+		}
+
+		if (frame.nType == FRAME_MOVE) {
+			float fValue = frame.fValue;
+			m_aStack.pop_back();
+			Return(fValue);
+			continue;
+		}
+
+		// The iteration is done
+		m_aStack.pop_back();
+
+		bool bFound = false;
+		float fBest = 0.0f;
+		for (int d = 0; d < 4; d++) {
+			if (m_aRootLegal[d] && (!bFound || m_aRootValues[d] > fBest)) {
+				bFound = true;
+				fBest = m_aRootValues[d];
+				m_nBestMove = s_aDirections[d];
+			}
+		}
+
+		m_bHasBestMove = bFound;
+		if (bFound)
+			m_nCompletedDepth = m_nIterationDepth;
+
+		if (!bFound || m_nIterationDepth >= m_nMaxDepth)
+			m_bSearching = false;
+		else
+			StartIteration();
+	}
+
+	auto tp2 = chrono::steady_clock::now();
+	m_stats.fSeconds += chrono::duration<double>(tp2 - tp1).count();
+	m_stats.arena = m_arena.GetStats();
+
+	return !m_bSearching;
+}
+
+void cTimeSlicedSearch::StartIteration()
+{
+	m_nIterationDepth++;
+
+	// Frames never move while the search runs
+	m_aStack.reserve(2 * m_nIterationDepth + 2);
+
+	for (int d = 0; d < 4; d++) {
+		m_aRootLegal[d] = cBoard::Move(m_nBoard, s_aDirections[d]) != m_nBoard;
+		m_aRootValues[d] = 0.0f;
+	}
+
+	PushMove(FRAME_ROOT, m_nBoard, m_nIterationDepth, 1.0f);
+}
+
+void cTimeSlicedSearch::PushMove(FRAME_TYPE nType, board_t nBoard, int nDepth, float fProbability)
+{
+	if (nType == FRAME_MOVE)
+		m_stats.nNodes++;
+
+	m_aStack.emplace_back();
+	sFrame& frame = m_aStack.back();
+	frame.nType = nType;
+	frame.nBoard = nBoard;
+	frame.nKey = nBoard;
+	frame.nDepth = nDepth;
+	frame.fProbability = fProbability;
+	frame.nNext = 0;
+	frame.fValue = 0.0f;
+	frame.nSpawns = 0;
+	frame.aSpawns = nullptr;
+}
+
+/**
+ * Leaves and cached boards return at once, like in cExpectimax::SearchSpawn
+ */
+void cTimeSlicedSearch::PushSpawn(board_t nBoard, int nDepth, float fProbability)
+{
+	m_stats.nNodes++;
+
+	if (nDepth <= 0 || fProbability < m_fProbabilityCutoff) {
+		Return(m_pHeuristic->Evaluate(nBoard));
+		return;
+	}
+
+	board_t nKey = cBoard::Canonicalize(nBoard);
+	float fValue = 0.0f;
+	if (m_table.Probe(nKey, nDepth, fValue, m_stats.table) == cTranspositionTable::PROBE_HIT) {
+		Return(fValue);
+		return;
+	}
+
+	m_aStack.emplace_back();
+	sFrame& frame = m_aStack.back();
+	frame.mark = m_arena.GetMark();
+	frame.aSpawns = m_arena.Allocate<sSpawn>(cBoard::MAX_SPAWNS);
+	frame.nSpawns = cBoard::GetSpawns(nBoard, frame.aSpawns);
+
+	if (frame.nSpawns == 0) {
+		m_arena.Rewind(frame.mark);
+		m_aStack.pop_back();
+		PushMove(FRAME_MOVE, nBoard, nDepth, fProbability);
+		return;
+	}
+
+	frame.nType = FRAME_SPAWN;
+	frame.nBoard = nBoard;
+	frame.nKey = nKey;
+	frame.nDepth = nDepth;
+	frame.fProbability = fProbability;
+	frame.nNext = 0;
+	frame.fValue = 0.0f;
+}
+
+/**
+ * Hands the value of a finished child to the frame on top of the stack
+ */
+void cTimeSlicedSearch::Return(float fValue)
+{
+	sFrame& frame = m_aStack.back();
+
+	switch (frame.nType) {
+	case FRAME_SPAWN:
+		frame.fValue += frame.aSpawns[frame.nNext++].fProbability * fValue;
+		break;
+
+	case FRAME_MOVE:
+		if (fValue > frame.fValue)
+			frame.fValue = fValue;
+		break;
+
+	case FRAME_ROOT:
+		m_aRootValues[frame.nNext - 1] = fValue;
+		break;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "cArena.h"
+#include "cExpectimax.h"
+#include "cHeuristic.h"
+#include "cPlayer.h"
+#include "cTranspositionTable.h"
+
+/**
+ * Expectimax search which can be paused and resumed
+ *
+ * Same search as cExpectimax, but the recursion is an explicit stack of
+ * frames, so Step can stop after any node when its time is up and the
+ * next Step continues right there. The game runs it a few milliseconds
+ * per frame and never misses a frame while the AI is thinking.
+ *
+ * The search deepens iteratively from depth 1 to the maximum depth.
+ * After the first iteration, which takes microseconds, GetBestMove
+ * always has the move of the deepest completed iteration. All
+ * iterations share one transposition table.
+ */
+class cTimeSlicedSearch : public cPlayer
+{
+public:
+	cTimeSlicedSearch(int nMaxDepth = 4, float fProbabilityCutoff = 0.0001f, int nTableSizeMB = 16);
+
+	// Searches to the maximum depth without pausing
+	virtual bool ChooseMove(board_t nBoard, ROTATION& nMove);
+
+	void Start(board_t nBoard);
+	// Searches for up to fSeconds, returns true once the search is done
+	bool Step(float fSeconds);
+	void Stop();
+
+	bool IsSearching() const { return m_bSearching; }
+	board_t GetBoard() const { return m_nBoard; }
+	bool GetBestMove(ROTATION& nMove) const;
+	int GetCompletedDepth() const { return m_nCompletedDepth; }
+
+	void SetMaxDepth(int nMaxDepth) { m_nMaxDepth = nMaxDepth; }
+	int GetMaxDepth() const { return m_nMaxDepth; }
+	// The heuristic has to live longer than the search
+	void SetHeuristic(const cHeuristic* pHeuristic) { m_pHeuristic = pHeuristic; }
+	const sSearchStats& GetStats() const { return m_stats; }
+
+private:
+	enum FRAME_TYPE {
+		FRAME_ROOT,
+		FRAME_MOVE,
+		FRAME_SPAWN
+	};
+
+	struct sFrame {
+		FRAME_TYPE nType;
+		board_t nBoard;
+		board_t nKey;
+		int nDepth;
+		float fProbability;
+		int nNext;		// next direction or spawn to search
+		float fValue;	// best value or weighted sum so far
+		int nSpawns;
+		sSpawn* aSpawns;	// in m_arena, freed when the frame is done
+		cArena::sMark mark;
+	};
+
+	void StartIteration();
+	void PushMove(FRAME_TYPE nType, board_t nBoard, int nDepth, float fProbability);
+	void PushSpawn(board_t nBoard, int nDepth, float fProbability);
+	void Return(float fValue);
+
+private:
+	int m_nMaxDepth;
+	float m_fProbabilityCutoff;
+	const cHeuristic* m_pHeuristic;
+	cTranspositionTable m_table;
+	sSearchStats m_stats;
+
+	bool m_bSearching = false;
+	board_t m_nBoard = 0;
+	int m_nIterationDepth = 0;
+	vector<sFrame> m_aStack;
+	cArena m_arena;
+
+	// Results of the root moves in the current iteration
+	float m_aRootValues[4];
+	bool m_aRootLegal[4];
+
+	int m_nCompletedDepth = 0;
+	bool m_bHasBestMove = false;
+	ROTATION m_nBestMove = LEFT;
+};
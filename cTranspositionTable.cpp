@@ -0,0 +1,218 @@
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "cTranspositionTable.h"
+
+static const int DEPTH_SHIFT = 32;
+static const int AGE_SHIFT = 40;
+
+void sTableStats::Add(const sTableStats& other)
+{
+	nProbes += other.nProbes;
+	nHits += other.nHits;
+	nMisses += other.nMisses;
+	nCollisions += other.nCollisions;
+	nStores += other.nStores;
+	nReplacements += other.nReplacements;
+}
+
+static uint64_t PackData(float fValue, int nDepth, uint8_t nAge)
+{
+	uint32_t nValueBits;
+	memcpy(&nValueBits, &fValue, sizeof(nValueBits));
+	return nValueBits | ((uint64_t)(uint8_t)nDepth << DEPTH_SHIFT) | ((uint64_t)nAge << AGE_SHIFT);
+}
+
+static float GetValue(uint64_t nData)
+{
+	uint32_t nValueBits = (uint32_t)nData;
+	float fValue;
+	memcpy(&fValue, &nValueBits, sizeof(fValue));
+	return fValue;
+}
+
+static int GetDepth(uint64_t nData) { return (int)(uint8_t)(nData >> DEPTH_SHIFT); }
+static uint8_t GetAge(uint64_t nData) { return (uint8_t)(nData >> AGE_SHIFT); }
+
+cTranspositionTable::cTranspositionTable(int nSizeMB, bool bHugePages)
+{
+	Resize(nSizeMB, bHugePages);
+}
+
+cTranspositionTable::~cTranspositionTable()
+{
+	Free();
+}
+
+/**
+ * Allocates the largest power of two of buckets which fits into the
+ * given memory, at least two so the hash is never shifted by 64. Huge
+ * pages are used if asked for and the system has them, otherwise
+ * normal pages (on Linux with a hint to back them by transparent huge
+ * pages).
+ */
+void cTranspositionTable::Resize(int nSizeMB, bool bHugePages)
+{
+	Free();
+
+	size_t nBuckets = 2;
+	m_nShift = 63;
+	while (nBuckets * 2 * sizeof(sBucket) <= (size_t)max(nSizeMB, 0) * 1024 * 1024) {
+		nBuckets *= 2;
+		m_nShift--;
+	}
+
+	size_t nSize = nBuckets * sizeof(sBucket);
+	void* pMemory = nullptr;
+
+#if defined(_WIN32)
+	// Large pages need the "Lock pages in memory" privilege
+	size_t nLargePage = GetLargePageMinimum();
+	if (bHugePages && nLargePage > 0 && nSize % nLargePage == 0) {
+		pMemory = VirtualAlloc(nullptr, nSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		m_bHugePages = pMemory != nullptr;
+	}
+	if (pMemory == nullptr)
+		pMemory = VirtualAlloc(nullptr, nSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (pMemory == nullptr)
+		throw bad_alloc();
+#else
+#if defined(MAP_HUGETLB)
+	if (bHugePages) {
+		pMemory = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		m_bHugePages = pMemory != MAP_FAILED;
+		if (pMemory == MAP_FAILED)
+			pMemory = nullptr;
+	}
+#endif
+	if (pMemory == nullptr) {
+		pMemory = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pMemory == MAP_FAILED)
+			throw bad_alloc();
+#if defined(MADV_HUGEPAGE)
+		if (bHugePages)
+			madvise(pMemory, nSize, MADV_HUGEPAGE);
+#endif
+	}
+#endif
+
+	// The memory is zeroed, which is an empty entry
+	m_pBuckets = new (pMemory) sBucket[nBuckets];
+	m_nBuckets = nBuckets;
+	m_nAllocated = nSize;
+	Clear();
+}
+
+void cTranspositionTable::Free()
+{
+	if (m_pBuckets == nullptr)
+		return;
+
+#if defined(_WIN32)
+	VirtualFree(m_pBuckets, 0, MEM_RELEASE);
+#else
+	munmap(m_pBuckets, m_nAllocated);
+#endif
+
+	m_pBuckets = nullptr;
+	m_nBuckets = 0;
+	m_nAllocated = 0;
+	m_bHugePages = false;
+}
+
+void cTranspositionTable::Clear()
+{
+	for (size_t i = 0; i < m_nBuckets; i++) {
+		for (sEntry& entry : m_pBuckets[i].aEntries) {
+			entry.nCheck.store(0, memory_order_relaxed);
+			entry.nData.store(0, memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * A cached value is only good enough if it was searched at least as deep
+ */
+cTranspositionTable::PROBE cTranspositionTable::Probe(board_t nBoard, int nDepth, float& fValue, sTableStats& stats) const
+{
+	stats.nProbes++;
+
+	sBucket& bucket = GetBucket(nBoard);
+	int nOccupied = 0;
+
+	for (sEntry& entry : bucket.aEntries) {
+		uint64_t nData = entry.nData.load(memory_order_relaxed);
+		uint64_t nCheck = entry.nCheck.load(memory_order_relaxed);
+
+		if ((nCheck ^ nData) == nBoard) {
+			if (GetDepth(nData) >= nDepth) {
+				fValue = GetValue(nData);
+				stats.nHits++;
+				return PROBE_HIT;
+			}
+			stats.nMisses++;
+			return PROBE_MISS;
+		}
+
+		nOccupied += GetDepth(nData) > 0;
+	}
+
+	stats.nMisses++;
+	if (nOccupied == BUCKET_SIZE) {
+		stats.nCollisions++;
+		return PROBE_COLLISION;
+	}
+
+	return PROBE_MISS;
+}
+
+void cTranspositionTable::Store(board_t nBoard, int nDepth, float fValue, sTableStats& stats)
+{
+	stats.nStores++;
+
+	uint8_t nAge = m_nAge.load(memory_order_relaxed);
+	sBucket& bucket = GetBucket(nBoard);
+
+	sEntry* pVictim = nullptr;
+	int nVictimWorth = 0;
+
+	for (sEntry& entry : bucket.aEntries) {
+		uint64_t nData = entry.nData.load(memory_order_relaxed);
+		uint64_t nCheck = entry.nCheck.load(memory_order_relaxed);
+
+		// Same board: keep the deeper search unless it is from an earlier move
+		if ((nCheck ^ nData) == nBoard && GetDepth(nData) > 0) {
+			if (nDepth < GetDepth(nData) && GetAge(nData) == nAge)
+				return;
+			pVictim = &entry;
+			break;
+		}
+
+		// Every move since the entry was written costs it four plies
+		int nWorth = GetDepth(nData) - 4 * (uint8_t)(nAge - GetAge(nData));
+		if (GetDepth(nData) == 0)
+			nWorth = -1024;
+
+		if (pVictim == nullptr || nWorth < nVictimWorth) {
+			pVictim = &entry;
+			nVictimWorth = nWorth;
+		}
+	}
+
+	uint64_t nOldData = pVictim->nData.load(memory_order_relaxed);
+	uint64_t nOldCheck = pVictim->nCheck.load(memory_order_relaxed);
+	if (GetDepth(nOldData) > 0 && (nOldCheck ^ nOldData) != nBoard)
+		stats.nReplacements++;
+
+	uint64_t nData = PackData(fValue, nDepth, nAge);
+	pVictim->nCheck.store(nBoard ^ nData, memory_order_relaxed);
+	pVictim->nData.store(nData, memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+#include "cBoard.h"
+
+struct sTableStats {
+	long long nProbes = 0;
+	long long nHits = 0;
+	long long nMisses = 0;
+	long long nCollisions = 0;
+	long long nStores = 0;
+	long long nReplacements = 0;
+
+	void Add(const sTableStats& other);
+	double HitRate() const { return nProbes > 0 ? (double)nHits / nProbes : 0.0; }
+};
+
+/**
+ * Transposition table which can be shared by any number of threads
+ *
+ * Entries are grouped in buckets of four, one bucket per cache line.
+ * Every entry is two 64 bit words, the data and the board XOR the data,
+ * which are read and written without locks. An entry which was torn by
+ * two threads writing at the same time does not verify and is treated
+ * like any other board, so no lock is needed for correct results.
+ *
+ * A store replaces the entry of the same board, or the entry which is
+ * worth the least: shallow searches and searches of earlier moves go
+ * first. NewSearch starts a new age, so entries of old moves are
+ * replaced even if they were searched deeper.
+ *
+ * The counters are kept by the caller, one sTableStats per thread,
+ * because shared counters would cost more than the table saves.
+ */
+class cTranspositionTable
+{
+public:
+	static const int BUCKET_SIZE = 4;
+
+	enum PROBE {
+		PROBE_MISS,			// not in the table, or not deep enough
+		PROBE_COLLISION,	// not in the table, and the bucket is full of other boards
+		PROBE_HIT
+	};
+
+public:
+	cTranspositionTable(int nSizeMB = 16, bool bHugePages = false);
+	~cTranspositionTable();
+
+	cTranspositionTable(const cTranspositionTable&) = delete;
+	cTranspositionTable& operator=(const cTranspositionTable&) = delete;
+
+	void Resize(int nSizeMB, bool bHugePages = false);
+	void Clear();
+	void NewSearch() { m_nAge++; }
+
+	PROBE Probe(board_t nBoard, int nDepth, float& fValue, sTableStats& stats) const;
+	void Store(board_t nBoard, int nDepth, float fValue, sTableStats& stats);
+
+	size_t GetEntryCount() const { return m_nBuckets * BUCKET_SIZE; }
+	bool HasHugePages() const { return m_bHugePages; }
+
+private:
+	struct sEntry {
+		atomic<uint64_t> nCheck;	// board ^ data
+		atomic<uint64_t> nData;		// value, depth and age
+	};
+
+	struct alignas(64) sBucket {
+		sEntry aEntries[BUCKET_SIZE];
+	};
+
+	sBucket& GetBucket(board_t nBoard) const { return m_pBuckets[(nBoard * 0x9E3779B97F4A7C15ULL) >> m_nShift]; }
+
+	void Free();
+
+private:
+	sBucket* m_pBuckets = nullptr;
+	size_t m_nBuckets = 0;
+	size_t m_nAllocated = 0;
+	int m_nShift = 63;
+	bool m_bHugePages = false;
+	atomic<uint8_t> m_nAge{ 0 };
+};
@@ -25,13 +25,19 @@ SoundCloud: https://www.soundcloud.com/onelonecoder
 
 #include "olcConsoleGameEngineOOP.h"
 
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
 olcConsoleGameEngineOOP::olcConsoleGameEngineOOP()
 {
 	m_nScreenWidth = 80;
 	m_nScreenHeight = 30;
 
+#if defined(_WIN32)
 	m_hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 	m_hConsoleIn = GetStdHandle(STD_INPUT_HANDLE);
+#endif
 
 	memset(m_keyNewState, 0, 256 * sizeof(short));
 	memset(m_keyOldState, 0, 256 * sizeof(short));
@@ -45,10 +51,16 @@ olcConsoleGameEngineOOP::olcConsoleGameEngineOOP()
 
 olcConsoleGameEngineOOP::~olcConsoleGameEngineOOP()
 {
+#if defined(_WIN32)
 	SetConsoleActiveScreenBuffer(m_hOriginalConsole);
+#else
+	m_terminal.Close();
+#endif
 	delete[] m_bufScreen;
+	delete[] m_bufPresented;
 }
 
+#if defined(_WIN32)
 int olcConsoleGameEngineOOP::ConstructConsole(int width, int height, int fontw, int fonth)
 {
 	if (m_hConsole == INVALID_HANDLE_VALUE)
@@ -121,8 +133,45 @@ int olcConsoleGameEngineOOP::ConstructConsole(int width, int height, int fontw,
 	m_bufScreen = new CHAR_INFO[m_nScreenWidth*m_nScreenHeight];
 	memset(m_bufScreen, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
 
+	// What the screen shows, to present only the cells which changed
+	m_bufPresented = new CHAR_INFO[m_nScreenWidth*m_nScreenHeight];
+	memset(m_bufPresented, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+	m_dirty.SetSize(m_nScreenWidth, m_nScreenHeight);
+	m_changed.SetSize(m_nScreenWidth, m_nScreenHeight);
+	m_dirty.AddAll();
+
+	return 1;
+}
+#else
+// The terminal keeps its font and window, so only the size counts
+int olcConsoleGameEngineOOP::ConstructConsole(int width, int height, int, int)
+{
+	m_nScreenWidth = width;
+	m_nScreenHeight = height;
+
+	if (!m_terminal.Open(m_nScreenWidth, m_nScreenHeight))
+		return Error(L"Not a terminal");
+
+	// Closing the terminal or Ctrl+C ends the game thread like closing the console does
+	struct sigaction action = {};
+	action.sa_handler = &olcConsoleGameEngineOOP::CloseHandler;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+	sigaction(SIGHUP, &action, nullptr);
+
+	m_bufScreen = new CHAR_INFO[m_nScreenWidth*m_nScreenHeight];
+	memset(m_bufScreen, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+
+	// What the screen shows, to present only the cells which changed
+	m_bufPresented = new CHAR_INFO[m_nScreenWidth*m_nScreenHeight];
+	memset(m_bufPresented, 0, sizeof(CHAR_INFO) * m_nScreenWidth * m_nScreenHeight);
+	m_dirty.SetSize(m_nScreenWidth, m_nScreenHeight);
+	m_changed.SetSize(m_nScreenWidth, m_nScreenHeight);
+	m_dirty.AddAll();
+
 	return 1;
 }
+#endif
 
 void olcConsoleGameEngineOOP::Draw(int x, int y, wchar_t c, short col)
 {
@@ -130,30 +179,45 @@ void olcConsoleGameEngineOOP::Draw(int x, int y, wchar_t c, short col)
 	{
 		m_bufScreen[y * m_nScreenWidth + x].Char.UnicodeChar = c;
 		m_bufScreen[y * m_nScreenWidth + x].Attributes = col;
+		m_dirty.Add(x, y, x + 1, y + 1);
 	}
 }
 
+void olcConsoleGameEngineOOP::MarkDirty(int x1, int y1, int x2, int y2)
+{
+	m_dirty.Add(x1, y1, x2, y2);
+}
+
 void olcConsoleGameEngineOOP::Fill(int x1, int y1, int x2, int y2, wchar_t c, short col)
 {
 	Clip(x1, y1);
 	Clip(x2, y2);
+	m_dirty.Add(x1, y1, x2, y2);
 	for (int x = x1; x < x2; x++)
 		for (int y = y1; y < y2; y++)
 			Draw(x, y, c, col);
 }
 
+// Strings are clipped to the screen, instead of running into the next row
 void olcConsoleGameEngineOOP::DrawString(int x, int y, wstring c, short col)
 {
-	for (size_t i = 0; i < c.size(); i++)
+	if (y < 0 || y >= m_nScreenHeight)
+		return;
+
+	for (int i = max(0, -x); i < (int)c.size() && x + i < m_nScreenWidth; i++)
 	{
 		m_bufScreen[y * m_nScreenWidth + x + i].Char.UnicodeChar = c[i];
 		m_bufScreen[y * m_nScreenWidth + x + i].Attributes = col;
 	}
+	m_dirty.Add(x, y, x + (int)c.size(), y + 1);
 }
 
 void olcConsoleGameEngineOOP::DrawStringAlpha(int x, int y, wstring c, short col)
 {
-	for (size_t i = 0; i < c.size(); i++)
+	if (y < 0 || y >= m_nScreenHeight)
+		return;
+
+	for (int i = max(0, -x); i < (int)c.size() && x + i < m_nScreenWidth; i++)
 	{
 		if (c[i] != L' ')
 		{
@@ -161,6 +225,7 @@ void olcConsoleGameEngineOOP::DrawStringAlpha(int x, int y, wstring c, short col
 			m_bufScreen[y * m_nScreenWidth + x + i].Attributes = col;
 		}
 	}
+	m_dirty.Add(x, y, x + (int)c.size(), y + 1);
 }
 
 void olcConsoleGameEngineOOP::Clip(int &x, int &y)
@@ -297,6 +362,7 @@ void olcConsoleGameEngineOOP::DrawSprite(int x, int y, olcSprite *sprite)
 	if (sprite == nullptr)
 		return;
 
+	m_dirty.Add(x, y, x + sprite->nWidth, y + sprite->nHeight);
 	for (int i = 0; i < sprite->nWidth; i++)
 	{
 		for (int j = 0; j < sprite->nHeight; j++)
@@ -312,6 +378,7 @@ void olcConsoleGameEngineOOP::DrawPartialSprite(int x, int y, olcSprite *sprite,
 	if (sprite == nullptr)
 		return;
 
+	m_dirty.Add(x, y, x + w, y + h);
 	for (int i = 0; i < w; i++)
 	{
 		for (int j = 0; j < h; j++)
@@ -376,6 +443,64 @@ void olcConsoleGameEngineOOP::Start()
 	t.join();
 }
 
+void olcConsoleGameEngineOOP::SetPrintStats(bool bPrintStats)
+{
+	m_bPrintStats = bPrintStats;
+}
+
+void olcConsoleGameEngineOOP::SetFrameRate(float fFramesPerSecond, float fUnfocusedFramesPerSecond)
+{
+	m_fFrameRate = fFramesPerSecond;
+	m_fUnfocusedFrameRate = fUnfocusedFramesPerSecond;
+}
+
+void olcConsoleGameEngineOOP::SetFixedTimestep(float fStep)
+{
+	m_fFixedTimestep = fStep;
+}
+
+void olcConsoleGameEngineOOP::WaitForInput(float fMaxSeconds)
+{
+	m_fInputWait = min(fMaxSeconds, MAX_INPUT_WAIT);
+}
+
+/**
+ * Sleeps until the next frame is due, or until input arrives if the
+ * last update had nothing to animate. Frames which are late are not
+ * caught up with.
+ */
+void olcConsoleGameEngineOOP::WaitForNextFrame(chrono::steady_clock::time_point &tpNextFrame)
+{
+	float fInputWait = m_fInputWait;
+	m_fInputWait = -1.0f;
+	if (m_fFrameRate <= 0.0f)
+		return;
+
+	float fFrameRate = m_fFrameRate;
+	if (!m_bConsoleInFocus && m_fUnfocusedFrameRate > 0.0f)
+		fFrameRate = min(fFrameRate, m_fUnfocusedFrameRate);
+
+	auto tpNow = chrono::steady_clock::now();
+	tpNextFrame += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / fFrameRate));
+	if (tpNextFrame < tpNow)
+		tpNextFrame = tpNow;
+
+	if (fInputWait < 0.0f)
+	{
+		this_thread::sleep_until(tpNextFrame);
+		return;
+	}
+
+	auto tpWake = max(tpNextFrame, tpNow + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<float>(fInputWait)));
+	float fSeconds = chrono::duration<float>(tpWake - tpNow).count();
+#if defined(_WIN32)
+	WaitForSingleObject(m_hConsoleIn, (DWORD)ceil(fSeconds * 1000.0f));
+#else
+	m_terminal.WaitForInput(fSeconds);
+#endif
+	tpNextFrame = chrono::steady_clock::now();
+}
+
 int olcConsoleGameEngineOOP::ScreenWidth()
 {
 	return m_nScreenWidth;
@@ -393,6 +518,7 @@ void olcConsoleGameEngineOOP::GameThread()
 		m_bAtomActive = false;
 
 	// Check if sound system should be enabled
+#if defined(_WIN32)
 	if (m_bEnableSound)
 	{
 		if (!CreateAudio())
@@ -401,21 +527,54 @@ void olcConsoleGameEngineOOP::GameThread()
 			m_bEnableSound = false;
 		}
 	}
+#else
+	// There is no sound on a terminal
+	m_bEnableSound = false;
+	float fTitleTime = 0.0f;
+	int nTitleFrames = 0;
+#endif
+
+#if defined(_WIN32)
+	// Sleeps end within a millisecond instead of the 15.6 ms tick
+	timeBeginPeriod(1);
+#endif
 
-	auto tp1 = chrono::system_clock::now();
-	auto tp2 = chrono::system_clock::now();
+	auto tp1 = chrono::steady_clock::now();
+	auto tp2 = chrono::steady_clock::now();
+	auto tpSessionStart = tp1;
+	auto tpNextFrame = tp1;
+	float fAccumulator = 0.0f;
 
 	while (m_bAtomActive)
 	{
-		// Run as fast as possible
+		// Run at the frame rate, or as fast as possible without one
 		while (m_bAtomActive)
 		{
 			// Handle Timing
-			tp2 = chrono::system_clock::now();
+			tp2 = chrono::steady_clock::now();
 			chrono::duration<float> elapsedTime = tp2 - tp1;
 			tp1 = tp2;
 			float fElapsedTime = elapsedTime.count();
 
+			// With a fixed timestep a frame runs the steps its time holds,
+			// input is only read for frames which run one
+			int nSteps = 1;
+			float fStep = fElapsedTime;
+			if (m_fFixedTimestep > 0.0f)
+			{
+				fAccumulator = min(fAccumulator + fElapsedTime, m_fFixedTimestep * MAX_STEPS_PER_FRAME);
+				nSteps = (int)(fAccumulator / m_fFixedTimestep);
+				fAccumulator -= nSteps * m_fFixedTimestep;
+				fStep = m_fFixedTimestep;
+			}
+
+			if (nSteps == 0)
+			{
+				WaitForNextFrame(tpNextFrame);
+				continue;
+			}
+
+#if defined(_WIN32)
 			// Handle Keyboard Input
 			for (int i = 0; i < 256; i++)
 			{
@@ -512,30 +671,110 @@ void olcConsoleGameEngineOOP::GameThread()
 
 				m_mouseOldState[m] = m_mouseNewState[m];
 			}
+#else
+			// A terminal only reports key presses, so every key is pressed
+			// and released in the frame it arrives in
+			for (int i = 0; i < 256; i++)
+			{
+				m_keys[i].bPressed = false;
+				m_keys[i].bReleased = false;
+			}
+
+			int aKeys[64];
+			int nKeys = m_terminal.ReadKeys(aKeys, 64);
+			for (int i = 0; i < nKeys; i++)
+			{
+				m_keys[aKeys[i]].bPressed = true;
+				m_keys[aKeys[i]].bReleased = true;
+			}
 
+			m_bConsoleInFocus = m_terminal.IsFocused();
+#endif
 
-			// Handle Frame Update
-			if (!OnUserUpdate(fElapsedTime))
-				m_bAtomActive = false;
+
+			// Handle Frame Update, only the first step sees keys and
+			// buttons being pressed and released
+			for (int nStep = 0; nStep < nSteps && m_bAtomActive; nStep++)
+			{
+				m_fInputWait = -1.0f;
+				if (!OnUserUpdate(fStep))
+					m_bAtomActive = false;
+
+				for (sKeyState &key : m_keys)
+					key.bPressed = key.bReleased = false;
+				for (sKeyState &button : m_mouse)
+					button.bPressed = button.bReleased = false;
+			}
+
+			// Only the rows of the drawn regions which changed are presented
+			m_changed.Clear();
+			m_changed.AddChanged(m_dirty, m_bufScreen, m_bufPresented);
+			m_dirty.Clear();
 
 			// Update Title & Present Screen Buffer
+#if defined(_WIN32)
 			wchar_t s[256];
 			swprintf_s(s, 256, L"OneLoneCoder.com - CGE - %s - FPS: %3.2f - %d ", m_sAppName.c_str(), 1.0f / fElapsedTime, events);
 			SetConsoleTitle(s);
-			WriteConsoleOutput(m_hConsole, m_bufScreen, { (short)m_nScreenWidth, (short)m_nScreenHeight }, { 0,0 }, &m_rectWindow);
+			for (int i = 0; i < m_changed.GetCount(); i++)
+			{
+				const sDirtyRect &rect = m_changed.GetRects()[i];
+				SMALL_RECT rectWrite = { (short)rect.x1, (short)rect.y1, (short)(rect.x2 - 1), (short)(rect.y2 - 1) };
+				WriteConsoleOutput(m_hConsole, m_bufScreen, { (short)m_nScreenWidth, (short)m_nScreenHeight }, { (short)rect.x1, (short)rect.y1 }, &rectWrite);
+			}
+#else
+			// The title costs bytes on every change, so the FPS is only
+			// updated once a second
+			fTitleTime += fElapsedTime;
+			nTitleFrames++;
+			if (fTitleTime >= 1.0f)
+			{
+				wchar_t s[256];
+				swprintf(s, 256, L"OneLoneCoder.com - CGE - %ls - FPS: %3.2f", m_sAppName.c_str(), nTitleFrames / fTitleTime);
+				m_terminal.SetTitle(s);
+				fTitleTime = 0.0f;
+				nTitleFrames = 0;
+			}
+
+			if (!m_terminal.Present(m_bufScreen, m_changed.GetRects(), m_changed.GetCount()))
+				m_bAtomActive = false;
+#endif
+
+			WaitForNextFrame(tpNextFrame);
 		}
 
+#if defined(_WIN32)
 		if (m_bEnableSound)
 		{
 			// Close and Clean up audio system
 		}
+#endif
 
 		if (OnUserDestroy())
 		{
 			// User has permitted destroy, so exit and clean up
 
 			//delete[] m_bufScreen;
+#if defined(_WIN32)
 			SetConsoleActiveScreenBuffer(m_hOriginalConsole);
+#else
+			m_terminal.Close();
+
+			// CPU time of all threads, the AI's included
+			if (m_bPrintStats)
+			{
+				rusage usage;
+				getrusage(RUSAGE_SELF, &usage);
+				double fCpuSeconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+				double fSessionSeconds = chrono::duration<double>(chrono::steady_clock::now() - tpSessionStart).count();
+				printf("%.1f s with %.2f s of CPU time (%.1f%%)\n", fSessionSeconds, fCpuSeconds, 100.0 * fCpuSeconds / max(fSessionSeconds, 1e-9));
+			}
+
+			const sTerminalStats& stats = m_terminal.GetStats();
+			if (m_bPrintStats && stats.nWrites > 0)
+				printf("%llu frames, %llu written with %.1f bytes and %.1f changed cells each\n", (unsigned long long)stats.nFrames,
+					(unsigned long long)stats.nWrites, (double)stats.nBytes / stats.nWrites, (double)stats.nCells / stats.nWrites);
+#endif
 			m_cvGameFinished.notify_one();
 		}
 		else
@@ -544,6 +783,10 @@ void olcConsoleGameEngineOOP::GameThread()
 			m_bAtomActive = true;
 		}
 	}
+
+#if defined(_WIN32)
+	timeEndPeriod(1);
+#endif
 }
 
 
@@ -553,6 +796,7 @@ bool olcConsoleGameEngineOOP::OnUserDestroy()
 	return true;
 }
 
+#if defined(_WIN32)
 int olcConsoleGameEngineOOP::Error(const wchar_t *msg)
 {
 	wchar_t buf[256];
@@ -578,6 +822,24 @@ BOOL olcConsoleGameEngineOOP::CloseHandler(DWORD evt)
 	return true;
 }
 
+#else
+int olcConsoleGameEngineOOP::Error(const wchar_t *msg)
+{
+	int nError = errno;
+	m_terminal.Close();
+	fwprintf(stderr, L"ERROR: %ls\n\t%s\n", msg, strerror(nError));
+	return 0;
+}
+
+void olcConsoleGameEngineOOP::CloseHandler(int)
+{
+	// Only the flag is safe to touch in a signal handler, the game
+	// thread cleans up once it sees it
+	m_bAtomActive = false;
+}
+#endif
+
+#if defined(_WIN32)
 unsigned int olcConsoleGameEngineOOP::LoadAudioSample(std::wstring sWavFile)
 {
 	if (!m_bEnableSound)
@@ -805,6 +1067,7 @@ float olcConsoleGameEngineOOP::GetMixerOutput(int nChannel, float fGlobalTime, f
 	// Return the sample via an optional user override to filter the sound
 	return onUserSoundFilter(nChannel, fGlobalTime, fMixerSample);
 }
+#endif
 
 
 atomic<bool> olcConsoleGameEngineOOP::m_bAtomActive = false;
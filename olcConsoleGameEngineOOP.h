@@ -115,7 +115,9 @@ return (major > 6) || ((major == 6) && (minor >= 2) && (minor < 4));
 */
 
 #pragma once
+#if defined(_WIN32)
 #pragma comment(lib, "winmm.lib")
+#endif
 
 #ifndef UNICODE
 #error Please enable UNICODE for your compiler! VS: Project Properties -> General -> \
@@ -133,7 +135,29 @@ Character Set -> Use Unicode. Thanks! - Javidx9
 #include <streambuf>
 using namespace std;
 
+#include "cDirtyRects.h"
+
+#if defined(_WIN32)
 #include <windows.h>
+#else
+// Elsewhere the screen is a VT terminal, see cTerminal
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include "cTerminal.h"
+
+typedef sTerminalCell CHAR_INFO;
+
+// Sprites are saved and loaded with the narrow name of the file
+inline int _wfopen_s(FILE** pFile, const wchar_t* sFile, const wchar_t* sMode)
+{
+	string sName(sFile, sFile + wcslen(sFile));
+	string sOpenMode(sMode, sMode + wcslen(sMode));
+	*pFile = fopen(sName.c_str(), sOpenMode.c_str());
+	return *pFile == nullptr ? errno : 0;
+}
+#endif
 
 
 enum COLOUR
@@ -313,6 +337,7 @@ public:
 		return true;
 	}
 
+#if defined(_WIN32)
 	bool LoadFromResource(unsigned int id)
 	{
 		HRSRC res = FindResource(NULL, MAKEINTRESOURCE(id), RT_RCDATA);
@@ -347,6 +372,7 @@ public:
 
 		return true;
 	}
+#endif
 
 };
 
@@ -360,6 +386,17 @@ public:
 public:
 	int ConstructConsole(int width, int height, int fontw, int fonth);
 	void Start();
+
+	// Prints what the frames cost when the game ends, on POSIX systems
+	void SetPrintStats(bool bPrintStats);
+
+	// Frames per second, and frames per second while the console is not
+	// in focus. 0 runs the frames as fast as possible
+	void SetFrameRate(float fFramesPerSecond, float fUnfocusedFramesPerSecond = 0.0f);
+
+	// OnUserUpdate gets steps of fStep seconds, as many as fit into the
+	// time since the last frame. 0 gives it the time since the last frame
+	void SetFixedTimestep(float fStep);
 	
 public:
 	virtual void Draw(int x, int y, wchar_t c = 0x2588, short col = 0x000F);
@@ -373,11 +410,16 @@ public:
 	void DrawSprite(int x, int y, olcSprite *sprite);
 	void DrawPartialSprite(int x, int y, olcSprite *sprite, int ox, int oy, int w, int h);
 	void DrawWireFrameModel(const vector<pair<float, float>> &vecModelCoordinates, float x, float y, float r = 0.0f, float s = 1.0f, short col = FG_WHITE, wchar_t c = PIXEL_SOLID);
+
+	// Only what the draw routines mark is presented, this marks what was
+	// written to m_bufScreen directly
+	void MarkDirty(int x1, int y1, int x2, int y2);
 	int ScreenWidth();
 	int ScreenHeight();
 
 private:
 	void GameThread();
+	void WaitForNextFrame(chrono::steady_clock::time_point &tpNextFrame);
 
 protected:
 	// User MUST OVERRIDE THESE!!
@@ -387,9 +429,17 @@ protected:
 	// Optional for clean up 
 	virtual bool OnUserDestroy();
 
+	// For an update with nothing to animate: the next frame comes when a
+	// key arrives or after fMaxSeconds. Only with a frame rate set
+	void WaitForInput(float fMaxSeconds = MAX_INPUT_WAIT);
+
 
 	int Error(const wchar_t *msg);
+#if defined(_WIN32)
 	static BOOL CloseHandler(DWORD evt);
+#else
+	static void CloseHandler(int nSignal);
+#endif
 
 protected:
 
@@ -412,6 +462,7 @@ public:
 	bool IsFocused() { return m_bConsoleInFocus; }
 
 
+#if defined(_WIN32)
 protected:
 	class olcAudioSample
 	{
@@ -561,24 +612,44 @@ protected:
 	// user gets one final chance to "filter" the sound, perhaps changing the volume
 	// or adding funky effects
 	float GetMixerOutput(int nChannel, float fGlobalTime, float fTimeStep);
+#endif
 
 protected:
 	int m_nScreenWidth;
 	int m_nScreenHeight;
-	CHAR_INFO *m_bufScreen;
+	CHAR_INFO *m_bufScreen = nullptr;
+	CHAR_INFO *m_bufPresented = nullptr;
+	cDirtyRects m_dirty;
+	cDirtyRects m_changed;
 	wstring m_sAppName;
+#if defined(_WIN32)
 	HANDLE m_hOriginalConsole;
 	CONSOLE_SCREEN_BUFFER_INFO m_OriginalConsoleInfo;
 	HANDLE m_hConsole;
 	HANDLE m_hConsoleIn;
 	SMALL_RECT m_rectWindow;
+#else
+	cTerminal m_terminal;
+#endif
 	short m_keyOldState[256] = { 0 };
 	short m_keyNewState[256] = { 0 };
 	bool m_mouseOldState[5] = { 0 };
 	bool m_mouseNewState[5] = { 0 };
 	bool m_bConsoleInFocus = true;
+	bool m_bPrintStats = false;
+
+	// Waits end in time to notice that the console is being closed
+	static constexpr float MAX_INPUT_WAIT = 0.5f;
+	// Updates a frame catches up with at most
+	static const int MAX_STEPS_PER_FRAME = 5;
+
+	float m_fFrameRate = 0.0f;
+	float m_fUnfocusedFrameRate = 0.0f;
+	float m_fFixedTimestep = 0.0f;
+	float m_fInputWait = -1.0f;
 	
 	bool m_bEnableSound = false;
+#if defined(_WIN32)
 	unsigned int m_nSampleRate;
 	unsigned int m_nChannels;
 	unsigned int m_nBlockCount;
@@ -593,6 +664,7 @@ protected:
 	std::condition_variable m_cvBlockNotZero;
 	std::mutex m_muxBlockNotZero;
 	std::atomic<float> m_fGlobalTime = 0.0f;
+#endif
 
 	static atomic<bool> m_bAtomActive;
 	static condition_variable m_cvGameFinished;
@@ -0,0 +1,182 @@
+/**
+ * Replay file reader
+ *
+ * Without options every move of every game in the file is decoded and
+ * the totals and the decoding speed are reported. With --game the
+ * position after --move moves of that game is shown.
+ *
+ * Usage: replay2048 FILE [--session N] [--game N] [--move N]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+using namespace std;
+
+#include "cReplay.h"
+
+struct sOptions {
+	string sFileName;
+	uint32_t nSession = 0;
+	long long nGame = -1;
+	uint32_t nMove = 0;
+};
+
+struct sGameInfo {
+	board_t nBoard = 0;
+	uint64_t nScore = 0;
+	uint32_t nMoves = 0;
+	bool bEnded = false;
+};
+
+static int ShowStats(const sOptions& options)
+{
+	cReplayReader reader;
+	if (!reader.Open(options.sFileName.c_str())) {
+		fprintf(stderr, "Could not open %s\n", options.sFileName.c_str());
+		return 1;
+	}
+
+	// Position at the end of the last block of every game
+	map<pair<uint32_t, uint64_t>, sGameInfo> games;
+	long long nBlocks = 0, nMoves = 0, nResyncs = 0;
+	uint32_t nSessions = 0;
+
+	auto tp1 = chrono::steady_clock::now();
+
+	sReplayBlock block;
+	sReplayMove move;
+	while (reader.NextBlock(block)) {
+		nBlocks++;
+		nSessions = max(nSessions, block.nSession + 1);
+
+		sGameInfo& game = games[make_pair(block.nSession, block.nGame)];
+
+		// A keyframe which does not continue the game means the recorder
+		// saw a position it could not explain by a move and a spawn
+		if (!block.bGameStart && (block.nBoard != game.nBoard || block.nFirstMove != game.nMoves))
+			nResyncs++;
+
+		game.nBoard = block.nBoard;
+		game.nScore = block.nScore;
+		game.nMoves = block.nFirstMove;
+
+		while (reader.NextMove(move)) {
+			game.nBoard = move.nBoard;
+			game.nScore = move.nScore;
+			game.nMoves++;
+			nMoves++;
+		}
+
+		game.bEnded |= block.bGameEnd;
+	}
+
+	auto tp2 = chrono::steady_clock::now();
+	double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+
+	long long nEnded = 0;
+	double fScore = 0.0;
+	for (const auto& game : games) {
+		if (game.second.bEnded) {
+			nEnded++;
+			fScore += (double)game.second.nScore;
+		}
+	}
+
+	FILE* pFile = fopen(options.sFileName.c_str(), "rb");
+	long long nBytes = 0;
+	if (pFile != nullptr) {
+		fseek(pFile, 0, SEEK_END);
+		nBytes = ftell(pFile);
+		fclose(pFile);
+	}
+
+	printf("file         %s\n", options.sFileName.c_str());
+	printf("bytes        %lld\n", nBytes);
+	printf("sessions     %u\n", nSessions);
+	printf("games        %lld (%lld finished)\n", (long long)games.size(), nEnded);
+	printf("blocks       %lld\n", nBlocks);
+	printf("moves        %lld\n", nMoves);
+	printf("bits/move    %.2f\n", 8.0 * nBytes / max(1LL, nMoves));
+	printf("avg score    %.1f\n", fScore / max(1LL, nEnded));
+	printf("resyncs      %lld\n", nResyncs);
+	printf("time         %.3f s\n", fSeconds);
+	printf("moves/sec    %.0f\n", nMoves / fSeconds);
+
+	if (reader.IsDamaged()) {
+		printf("damaged      yes, reading stopped early\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+static int ShowPosition(const sOptions& options)
+{
+	cReplayReader reader;
+	if (!reader.Open(options.sFileName.c_str())) {
+		fprintf(stderr, "Could not open %s\n", options.sFileName.c_str());
+		return 1;
+	}
+
+	board_t nBoard;
+	uint64_t nScore;
+	if (!reader.Seek(options.nSession, (uint64_t)options.nGame, options.nMove, nBoard, nScore)) {
+		fprintf(stderr, "Move %u of game %lld in session %u not found\n", options.nMove, options.nGame, options.nSession);
+		return 1;
+	}
+
+	printf("session %u  game %lld  move %u  score %llu\n\n", options.nSession, options.nGame, options.nMove, (unsigned long long)nScore);
+	for (int y = 0; y < 4; y++) {
+		for (int x = 0; x < 4; x++)
+			printf("%6d", cBoard::GetValue(nBoard, y * 4 + x));
+		printf("\n");
+	}
+
+	return 0;
+}
+
+static bool ParseOptions(int argc, char* argv[], sOptions& options)
+{
+	if (argc < 2)
+		return false;
+
+	options.sFileName = argv[1];
+
+	for (int i = 2; i < argc; i++) {
+		string sArg = argv[i];
+		const char* sValue = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (sValue == nullptr)
+			return false;
+
+		if (sArg == "--session")
+			options.nSession = (uint32_t)atoi(sValue);
+		else if (sArg == "--game")
+			options.nGame = atoll(sValue);
+		else if (sArg == "--move")
+			options.nMove = (uint32_t)atoi(sValue);
+		else
+			return false;
+
+		i++;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	sOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		fprintf(stderr, "Usage: %s FILE [--session N] [--game N] [--move N]\n", argv[0]);
+		return 1;
+	}
+
+	cBoard::InitTables();
+
+	return options.nGame >= 0 ? ShowPosition(options) : ShowStats(options);
+}
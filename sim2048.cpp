@@ -0,0 +1,327 @@
+/**
+ * Headless batch simulator
+ *
+ * Plays lots of games with one of the built in players and reports
+ * the throughput and the distribution of the biggest tiles reached.
+ *
+ * Usage: sim2048 [--policy random|greedy|corner|ai|mc|ntuple] [--seed N]
+ *                [--games N] [--threads N] [--max-moves N]
+ *                [--depth N] [--cutoff P] [--tt-mb N] [--shared-tt 0|1]
+ *                [--huge-pages 0|1] [--ai-threads N] [--tt-symmetry 0|1]
+ *                [--heuristic FILE]
+ *                [--rollouts N] [--mc-threads N] [--mc-metric score|depth]
+ *                [--weights FILE] [--tables FILE] [--record FILE]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "cExpectimax.h"
+#include "cGame.h"
+#include "cMonteCarlo.h"
+#include "cNTuple.h"
+#include "cPlayer.h"
+#include "cRandom.h"
+#include "cReplay.h"
+
+struct sOptions {
+	string sPolicy = "random";
+	uint64_t nSeed = 1;
+	long long nGames = 10000;
+	int nThreads = 0;
+	int nMaxMoves = 0;
+	int nDepth = 3;
+	float fCutoff = 0.0001f;
+	int nTableSizeMB = 16;
+	bool bSharedTable = false;
+	bool bHugePages = false;
+	int nSearchThreads = 1;
+	bool bSymmetricTable = true;
+	string sHeuristicFile;
+	int nRollouts = 1000;
+	int nRolloutThreads = 1;
+	cMonteCarlo::METRIC nMetric = cMonteCarlo::METRIC_SCORE;
+	string sWeightsFile = "ntuple.weights";
+	string sTableFile;
+	string sReplayFile;
+};
+
+struct sStats {
+	long long nGames = 0;
+	long long nMoves = 0;
+	long long nScore = 0;
+	long long aMaxTile[16] = { 0 };
+	sSearchStats search;
+	sRolloutStats rollouts;
+
+	void Add(const sStats& other)
+	{
+		search.Add(other.search);
+		rollouts.Add(other.rollouts);
+		nGames += other.nGames;
+		nMoves += other.nMoves;
+		nScore += other.nScore;
+		for (int i = 0; i < 16; i++)
+			aMaxTile[i] += other.aMaxTile[i];
+	}
+};
+
+static unique_ptr<cPlayer> CreatePlayer(const sOptions& options, cTranspositionTable* pSharedTable, const cHeuristic* pHeuristic)
+{
+	if (options.sPolicy == "random")
+		return unique_ptr<cPlayer>(new cRandomPlayer());
+	if (options.sPolicy == "greedy")
+		return unique_ptr<cPlayer>(new cGreedyPlayer());
+	if (options.sPolicy == "corner")
+		return unique_ptr<cPlayer>(new cCornerPlayer());
+	if (options.sPolicy == "ai") {
+		cExpectimax* pSearch = pSharedTable != nullptr
+			? new cExpectimax(options.nDepth, options.fCutoff, pSharedTable)
+			: new cExpectimax(options.nDepth, options.fCutoff, options.nTableSizeMB);
+		pSearch->SetThreadCount(options.nSearchThreads);
+		pSearch->SetSymmetricTable(options.bSymmetricTable);
+		pSearch->SetHeuristic(pHeuristic);
+		return unique_ptr<cPlayer>(pSearch);
+	}
+	if (options.sPolicy == "mc")
+		return unique_ptr<cPlayer>(new cMonteCarlo(options.nRollouts, options.nRolloutThreads, options.nMetric));
+	if (options.sPolicy == "ntuple") {
+		cNTuple* pNetwork = new cNTuple();
+		if (!pNetwork->Load(options.sWeightsFile.c_str()))
+			fprintf(stderr, "Could not load %s, playing without weights\n", options.sWeightsFile.c_str());
+		return unique_ptr<cPlayer>(pNetwork);
+	}
+
+	return nullptr;
+}
+
+/**
+ * Every game gets its own seed so the results do not depend on
+ * the number of threads
+ */
+static uint64_t GetGameSeed(uint64_t nSeed, long long nGame)
+{
+	uint64_t nState = nSeed ^ ((uint64_t)nGame * 0xD1B54A32D192ED03ULL);
+	return cRandom::SplitMix64(nState);
+}
+
+static void RunGames(const sOptions& options, atomic<long long>& nNextGame, cTranspositionTable* pSharedTable,
+	const cHeuristic* pHeuristic, cReplayWriter* pWriter, sStats& stats)
+{
+	cGame game;
+	unique_ptr<cPlayer> player = CreatePlayer(options, pSharedTable, pHeuristic);
+	cReplayRecorder recorder(pWriter);
+
+	for (long long nGame = nNextGame++; nGame < options.nGames; nGame = nNextGame++) {
+		uint64_t nSeed = GetGameSeed(options.nSeed, nGame);
+		player->NewGame(nSeed ^ 0xA5A5A5A5A5A5A5A5ULL);
+		game.Reset(nSeed);
+
+		recorder.StartGame(nSeed);
+		recorder.RecordBoard(game.GetBoard());
+
+		ROTATION nMove;
+		while (player->ChooseMove(game.GetBoard(), nMove)) {
+			if (game.Move(nMove)) {
+				recorder.RecordMove(nMove);
+				recorder.RecordBoard(game.GetBoard());
+			}
+
+			if (options.nMaxMoves > 0 && game.GetMoveCount() >= options.nMaxMoves)
+				break;
+		}
+
+		recorder.FinishGame();
+
+		stats.nGames++;
+		stats.nMoves += game.GetMoveCount();
+		stats.nScore += game.GetScore();
+		stats.aMaxTile[cBoard::GetMaxExponent(game.GetBoard())]++;
+	}
+
+	cExpectimax* pSearch = dynamic_cast<cExpectimax*>(player.get());
+	if (pSearch != nullptr)
+		stats.search = pSearch->GetStats();
+
+	cMonteCarlo* pMonteCarlo = dynamic_cast<cMonteCarlo*>(player.get());
+	if (pMonteCarlo != nullptr)
+		stats.rollouts = pMonteCarlo->GetStats();
+}
+
+static bool ParseOptions(int argc, char* argv[], sOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		string sArg = argv[i];
+		const char* sValue = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (sValue == nullptr)
+			return false;
+
+		if (sArg == "--policy")
+			options.sPolicy = sValue;
+		else if (sArg == "--seed")
+			options.nSeed = strtoull(sValue, nullptr, 10);
+		else if (sArg == "--games")
+			options.nGames = atoll(sValue);
+		else if (sArg == "--threads")
+			options.nThreads = atoi(sValue);
+		else if (sArg == "--max-moves")
+			options.nMaxMoves = atoi(sValue);
+		else if (sArg == "--depth")
+			options.nDepth = atoi(sValue);
+		else if (sArg == "--cutoff")
+			options.fCutoff = (float)atof(sValue);
+		else if (sArg == "--tt-mb")
+			options.nTableSizeMB = atoi(sValue);
+		else if (sArg == "--shared-tt")
+			options.bSharedTable = atoi(sValue) != 0;
+		else if (sArg == "--huge-pages")
+			options.bHugePages = atoi(sValue) != 0;
+		else if (sArg == "--ai-threads")
+			options.nSearchThreads = atoi(sValue);
+		else if (sArg == "--tt-symmetry")
+			options.bSymmetricTable = atoi(sValue) != 0;
+		else if (sArg == "--heuristic")
+			options.sHeuristicFile = sValue;
+		else if (sArg == "--rollouts")
+			options.nRollouts = atoi(sValue);
+		else if (sArg == "--mc-threads")
+			options.nRolloutThreads = atoi(sValue);
+		else if (sArg == "--mc-metric" && string(sValue) == "score")
+			options.nMetric = cMonteCarlo::METRIC_SCORE;
+		else if (sArg == "--mc-metric" && string(sValue) == "depth")
+			options.nMetric = cMonteCarlo::METRIC_DEPTH;
+		else if (sArg == "--weights")
+			options.sWeightsFile = sValue;
+		else if (sArg == "--tables")
+			options.sTableFile = sValue;
+		else if (sArg == "--record")
+			options.sReplayFile = sValue;
+		else
+			return false;
+
+		i++;
+	}
+
+	if (options.nThreads <= 0)
+		options.nThreads = max(1, (int)thread::hardware_concurrency());
+
+	if (options.nGames < 1)
+		return false;
+
+	return options.sPolicy == "random" || options.sPolicy == "greedy"
+		|| options.sPolicy == "corner" || options.sPolicy == "ai" || options.sPolicy == "mc"
+		|| options.sPolicy == "ntuple";
+}
+
+int main(int argc, char* argv[])
+{
+	sOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		fprintf(stderr, "Usage: %s [--policy random|greedy|corner|ai|mc|ntuple] [--seed N] [--games N]\n"
+			"       [--threads N] [--max-moves N] [--depth N] [--cutoff P] [--tt-mb N]\n"
+			"       [--shared-tt 0|1] [--huge-pages 0|1] [--ai-threads N]\n"
+			"       [--tt-symmetry 0|1] [--heuristic FILE]\n"
+			"       [--rollouts N] [--mc-threads N] [--mc-metric score|depth]\n"
+			"       [--weights FILE] [--tables FILE] [--record FILE]\n", argv[0]);
+		return 1;
+	}
+
+	// Without a table file the move tables are built in memory
+	if (!cBoard::InitTables(options.sTableFile.empty() ? nullptr : options.sTableFile.c_str()))
+		fprintf(stderr, "Could not use %s, building the tables\n", options.sTableFile.c_str());
+
+	// All threads record into the same file
+	cReplayWriter writer;
+	if (!options.sReplayFile.empty() && !writer.Open(options.sReplayFile.c_str())) {
+		fprintf(stderr, "Could not open %s\n", options.sReplayFile.c_str());
+		return 1;
+	}
+
+	// Weights of the expectimax heuristic as written by cHeuristic::SaveWeights
+	cHeuristic heuristic;
+	if (!options.sHeuristicFile.empty() && !heuristic.LoadWeights(options.sHeuristicFile.c_str())) {
+		fprintf(stderr, "Could not load %s\n", options.sHeuristicFile.c_str());
+		return 1;
+	}
+
+	// With --shared-tt all searches use one table of --tt-mb
+	unique_ptr<cTranspositionTable> sharedTable;
+	if (options.bSharedTable)
+		sharedTable.reset(new cTranspositionTable(options.nTableSizeMB, options.bHugePages));
+
+	vector<sStats> aThreadStats(options.nThreads);
+	vector<thread> aThreads;
+	atomic<long long> nNextGame(0);
+
+	auto tp1 = chrono::steady_clock::now();
+
+	for (int i = 0; i < options.nThreads; i++)
+		aThreads.push_back(thread(RunGames, cref(options), ref(nNextGame), sharedTable.get(), &heuristic, writer.IsOpen() ? &writer : nullptr, ref(aThreadStats[i])));
+	for (thread& t : aThreads)
+		t.join();
+
+	auto tp2 = chrono::steady_clock::now();
+	writer.Close();
+	double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+
+	sStats stats;
+	for (const sStats& s : aThreadStats)
+		stats.Add(s);
+
+	printf("policy       %s\n", options.sPolicy.c_str());
+	printf("seed         %llu\n", (unsigned long long)options.nSeed);
+	printf("games        %lld\n", stats.nGames);
+	printf("threads      %d\n", options.nThreads);
+	printf("tables       %s\n", cBoard::AreTablesMapped() ? "mapped" : "built");
+	printf("time         %.3f s\n", fSeconds);
+	printf("games/sec    %.0f\n", stats.nGames / fSeconds);
+	printf("moves/sec    %.0f\n", stats.nMoves / fSeconds);
+	printf("avg moves    %.1f\n", (double)stats.nMoves / stats.nGames);
+	printf("avg score    %.1f\n", (double)stats.nScore / stats.nGames);
+
+	if (!options.sReplayFile.empty()) {
+		printf("replay bytes %lld\n", writer.GetBytesWritten());
+		printf("bits/move    %.2f\n", 8.0 * writer.GetBytesWritten() / max(1LL, stats.nMoves));
+	}
+
+	if (stats.search.nNodes > 0) {
+		// Search time is summed over all threads
+		printf("nodes        %lld\n", stats.search.nNodes);
+		printf("nodes/sec    %.0f per thread\n", stats.search.NodesPerSecond());
+		printf("tt hit rate  %.1f %%\n", 100.0 * stats.search.HitRate());
+		printf("tt collisions %.1f %% of probes, %lld replacements\n",
+			100.0 * stats.search.table.nCollisions / max(1LL, stats.search.table.nProbes), stats.search.table.nReplacements);
+		printf("arena peak   %.1f KB in %lld blocks, %lld resets\n",
+			stats.search.arena.nPeakBytes / 1024.0, stats.search.arena.nBlocks, stats.search.arena.nResets);
+		if (sharedTable)
+			printf("tt shared    %zu entries%s\n", sharedTable->GetEntryCount(), sharedTable->HasHugePages() ? ", huge pages" : "");
+	}
+
+	if (stats.rollouts.nRollouts > 0) {
+		// Rollout time is summed over all game threads
+		printf("rollouts     %lld\n", stats.rollouts.nRollouts);
+		printf("rollouts/sec %.0f per game thread (%d rollout threads)\n", stats.rollouts.RolloutsPerSecond(), options.nRolloutThreads);
+		printf("rollout moves/sec %.0f\n", stats.rollouts.fSeconds > 0.0 ? stats.rollouts.nMoves / stats.rollouts.fSeconds : 0.0);
+	}
+	printf("\n  max tile      games        %%   reached %%\n");
+
+	long long nReached = stats.nGames;
+	for (int i = 1; i < 16; i++) {
+		if (stats.aMaxTile[i] > 0) {
+			printf("  %8d  %9lld  %7.2f   %9.2f\n", 1 << i, stats.aMaxTile[i],
+				100.0 * stats.aMaxTile[i] / stats.nGames, 100.0 * nReached / stats.nGames);
+		}
+		nReached -= stats.aMaxTile[i];
+	}
+
+	return 0;
+}
@@ -0,0 +1,241 @@
+/**
+ * Exact solver for small boards
+ *
+ * solve finds every reachable position of a 2x2 to 3x3 (or 2x4) board
+ * with cRetrograde and writes the expected score of perfect play for
+ * each of them into a table file. --memory is the memory for states
+ * which wait to be sorted, more goes to sorted runs in --temp.
+ *
+ * check maps a solved table and plays seeded games with the perfect
+ * player it gives and with a greedy and a random player, and shows how
+ * much every player loses per move against perfect play. The perfect
+ * player has to score what the table expects for a new game.
+ *
+ * Usage: solve2048 solve WxH --out FILE [--memory MB] [--temp DIR]
+ *                  [--threads N] [--verbose]
+ *        solve2048 check FILE [--games N] [--seed N]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+using namespace std;
+
+#include "cRandom.h"
+#include "cRetrograde.h"
+#include "cTableFile.h"
+
+struct sCheckOptions {
+	int nGames = 10000;
+	uint64_t nSeed = 1;
+};
+
+template<int W, int H>
+static int Solve(const string& sFileName, const sRetrogradeOptions& options)
+{
+	sRetrogradeStats stats;
+	if (!cRetrograde<W, H>::Solve(sFileName, options, stats)) {
+		fprintf(stderr, "Could not solve into %s\n", sFileName.c_str());
+		return 1;
+	}
+
+	double fSeconds = stats.fForwardSeconds + stats.fBackwardSeconds;
+	printf("board            %dx%d\n", W, H);
+	printf("states           %llu in %d layers\n", (unsigned long long)stats.nStates, stats.nLayers);
+	printf("forward pass     %.2f s, %.0f states/s, %.0f spawns/s\n", stats.fForwardSeconds,
+		stats.nStates / max(stats.fForwardSeconds, 1e-9), stats.nTransitions / max(stats.fForwardSeconds, 1e-9));
+	printf("backward pass    %.2f s, %.0f states/s\n", stats.fBackwardSeconds, stats.nStates / max(stats.fBackwardSeconds, 1e-9));
+	printf("total            %.2f s, %.0f states/s\n", fSeconds, stats.nStates / max(fSeconds, 1e-9));
+	printf("spilled          %d runs, %.1f MB\n", stats.nRuns, stats.nSpilledBytes / 1048576.0);
+	printf("table            %.1f MB, %.1f bytes/state\n", stats.nTableBytes / 1048576.0,
+		stats.nStates > 0 ? (double)stats.nTableBytes / stats.nStates : 0.0);
+
+	cRetrogradeTable<W, H> table;
+	if (table.Open(sFileName.c_str()))
+		printf("perfect play     %.2f expected score\n", table.GetStartValue());
+
+	return 0;
+}
+
+/**
+ * Plays the games of one player, which returns its move for a board
+ */
+template<int W, int H, typename PLAYER>
+static void CheckPlayer(const char* sName, const cRetrogradeTable<W, H>& table, const sCheckOptions& options, PLAYER player)
+{
+	typedef cBoardN<W, H> board;
+	typedef typename board::bits_t bits_t;
+
+	cRandom rng(options.nSeed);
+	double fScore = 0.0, fSquares = 0.0, fRegret = 0.0;
+	long long nMoves = 0, nPerfect = 0, nUnknown = 0;
+	auto tp1 = chrono::steady_clock::now();
+
+	for (int nGame = 0; nGame < options.nGames; nGame++) {
+		bits_t nBoard = board::Empty();
+		for (int k = 0; k < 2; k++)
+			nBoard = board::AddTile(nBoard, (int)rng.NextBelow(board::CountEmpty(nBoard)), rng.NextBelow(10) == 0 ? 2 : 1);
+
+		long long nGameScore = 0;
+		ROTATION nBest;
+		double fBest = 0.0;
+
+		while (table.GetBestMove(nBoard, nBest, fBest)) {
+			float fValue;
+			nUnknown += !table.GetValue(nBoard, fValue);
+
+			ROTATION nMove = player(nBoard, rng);
+			double fMove = table.GetMoveValue(nBoard, nMove);
+			fRegret += fBest - fMove;
+			nPerfect += fBest - fMove < 1e-3 * max(1.0, fBest);
+			nMoves++;
+
+			int nMoveScore = 0;
+			nBoard = board::Move(nBoard, nMove, nMoveScore);
+			nGameScore += nMoveScore;
+			nBoard = board::AddTile(nBoard, (int)rng.NextBelow(board::CountEmpty(nBoard)), rng.NextBelow(10) == 0 ? 2 : 1);
+		}
+
+		fScore += nGameScore;
+		fSquares += (double)nGameScore * nGameScore;
+	}
+
+	auto tp2 = chrono::steady_clock::now();
+	double fSeconds = chrono::duration<double>(tp2 - tp1).count();
+
+	double fMean = fScore / options.nGames;
+	double fError = sqrt(max(0.0, fSquares / options.nGames - fMean * fMean) / options.nGames);
+	printf("%-8s %10.2f +- %6.2f %11.1f%% %12.3f %11.0f\n", sName, fMean, fError,
+		100.0 * nPerfect / max(1LL, nMoves), fRegret / max(1LL, nMoves), nMoves / max(fSeconds, 1e-9));
+
+	if (nUnknown > 0)
+		printf("         %lld positions were not in the table\n", nUnknown);
+}
+
+template<int W, int H>
+static int Check(const char* sFileName, const sCheckOptions& options)
+{
+	typedef cBoardN<W, H> board;
+	typedef typename board::bits_t bits_t;
+	static const ROTATION aDirections[4] = { LEFT, TOP, RIGHT, DOWN };
+
+	cRetrogradeTable<W, H> table;
+	if (!table.Open(sFileName)) {
+		fprintf(stderr, "%s: %s\n", sFileName, table.GetError().c_str());
+		return 1;
+	}
+
+	printf("%dx%d table with %llu states, perfect play expects %.2f\n\n", W, H,
+		(unsigned long long)table.GetStateCount(), table.GetStartValue());
+	printf("player        score (mean)   best moves  loss/move     moves/s\n");
+
+	CheckPlayer("perfect", table, options, [&](bits_t nBoard, cRandom&) {
+		ROTATION nMove = LEFT;
+		double fValue;
+		table.GetBestMove(nBoard, nMove, fValue);
+		return nMove;
+	});
+
+	// Most points right now, the first legal move if nothing merges
+	CheckPlayer("greedy", table, options, [&](bits_t nBoard, cRandom&) {
+		ROTATION nMove = LEFT;
+		int nBest = -1;
+		for (ROTATION nDir : aDirections) {
+			int nScore = 0;
+			if (board::Move(nBoard, nDir, nScore) != nBoard && nScore > nBest) {
+				nMove = nDir;
+				nBest = nScore;
+			}
+		}
+		return nMove;
+	});
+
+	CheckPlayer("random", table, options, [&](bits_t nBoard, cRandom& rng) {
+		ROTATION aLegal[4];
+		int nLegal = 0;
+		for (ROTATION nDir : aDirections) {
+			int nScore = 0;
+			if (board::Move(nBoard, nDir, nScore) != nBoard)
+				aLegal[nLegal++] = nDir;
+		}
+		return aLegal[rng.NextBelow(nLegal)];
+	});
+
+	return 0;
+}
+
+// The sizes which can be solved, 2x4 is the same game as 4x2
+#define SOLVE_SIZES(X) X(2, 2) X(2, 3) X(3, 3) X(2, 4)
+
+int main(int argc, char* argv[])
+{
+	string sCommand = argc > 2 ? argv[1] : "";
+	int nResult = -1;
+
+	if (sCommand == "solve") {
+		int nWidth = 0, nHeight = 0;
+		sscanf(argv[2], "%dx%d", &nWidth, &nHeight);
+
+		string sOutFile;
+		sRetrogradeOptions options;
+		for (int i = 3; i < argc; i++) {
+			string sArg = argv[i];
+			bool bHasValue = i + 1 < argc;
+
+			if (sArg == "--out" && bHasValue)
+				sOutFile = argv[++i];
+			else if (sArg == "--memory" && bHasValue)
+				options.nMemoryMB = atoi(argv[++i]);
+			else if (sArg == "--temp" && bHasValue)
+				options.sTempDir = argv[++i];
+			else if (sArg == "--threads" && bHasValue)
+				options.nThreads = atoi(argv[++i]);
+			else if (sArg == "--verbose")
+				options.bVerbose = true;
+			else {
+				sOutFile.clear();
+				break;
+			}
+		}
+
+#define SOLVE_SIZE(w, h) else if (nWidth == w && nHeight == h) nResult = Solve<w, h>(sOutFile, options);
+		if (sOutFile.empty())
+			nResult = -1;
+		SOLVE_SIZES(SOLVE_SIZE)
+#undef SOLVE_SIZE
+	}
+	else if (sCommand == "check") {
+		sCheckOptions options;
+		for (int i = 3; i + 1 < argc; i += 2) {
+			if (string(argv[i]) == "--games")
+				options.nGames = max(1, atoi(argv[i + 1]));
+			else if (string(argv[i]) == "--seed")
+				options.nSeed = strtoull(argv[i + 1], nullptr, 10);
+		}
+
+		// The size comes from the file
+		cTableFile file;
+		const sRetrogradeInfo* pInfo = nullptr;
+		if (file.Open(argv[2], false))
+			pInfo = (const sRetrogradeInfo*)file.Find("retro_info", sizeof(sRetrogradeInfo));
+
+		if (pInfo == nullptr) {
+			fprintf(stderr, "%s is not a solved table\n", argv[2]);
+			nResult = 1;
+		}
+#define CHECK_SIZE(w, h) else if (pInfo->nWidth == w && pInfo->nHeight == h) nResult = Check<w, h>(argv[2], options);
+		SOLVE_SIZES(CHECK_SIZE)
+#undef CHECK_SIZE
+	}
+
+	if (nResult < 0) {
+		fprintf(stderr, "Usage: %s solve WxH --out FILE [--memory MB] [--temp DIR] [--threads N] [--verbose]\n"
+			"       %s check FILE [--games N] [--seed N]\n"
+			"Sizes: 2x2 2x3 3x3 2x4\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	return nResult;
+}
@@ -0,0 +1,91 @@
+/**
+ * Table file tool
+ *
+ * Writes the precomputed move tables into a table file which the other
+ * tools can map with --tables, optionally together with all tables of
+ * other table files (e.g. n-tuple weights), and shows what is inside a
+ * table file.
+ *
+ * Usage: tables2048 write FILE [--add FILE]...
+ *        tables2048 info FILE
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "cBoard.h"
+#include "cTableFile.h"
+
+static int Write(int argc, char* argv[])
+{
+	vector<sTableData> aTables;
+	cBoard::GetTables(aTables);
+
+	// The added files stay mapped until they are written
+	vector<unique_ptr<cTableFile>> aFiles;
+	for (int i = 3; i + 1 < argc; i += 2) {
+		if (string(argv[i]) != "--add")
+			return -1;
+
+		aFiles.push_back(unique_ptr<cTableFile>(new cTableFile()));
+		cTableFile& file = *aFiles.back();
+		if (!file.Open(argv[i + 1])) {
+			fprintf(stderr, "Could not open %s: %s\n", argv[i + 1], file.GetError().c_str());
+			return 1;
+		}
+
+		for (int s = 0; s < file.GetSectionCount(); s++)
+			aTables.push_back({ file.GetSectionName(s), file.GetSectionData(s), file.GetSectionSize(s) });
+	}
+
+	if (!cTableFile::Write(argv[2], aTables)) {
+		fprintf(stderr, "Could not write %s\n", argv[2]);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int Info(const char* sFileName)
+{
+	auto tp1 = chrono::steady_clock::now();
+
+	cTableFile file;
+	if (!file.Open(sFileName)) {
+		fprintf(stderr, "%s: %s\n", sFileName, file.GetError().c_str());
+		return 1;
+	}
+
+	auto tp2 = chrono::steady_clock::now();
+
+	printf("version      %u\n", cTableFile::VERSION);
+	printf("opened in    %.1f ms (checksums verified)\n", chrono::duration<double, milli>(tp2 - tp1).count());
+	printf("\n  %-24s %12s\n", "section", "bytes");
+	for (int s = 0; s < file.GetSectionCount(); s++)
+		printf("  %-24s %12llu\n", file.GetSectionName(s), (unsigned long long)file.GetSectionSize(s));
+
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	string sCommand = argc > 2 ? argv[1] : "";
+
+	int nResult = -1;
+	if (sCommand == "write" && argc % 2 == 1)
+		nResult = Write(argc, argv);
+	else if (sCommand == "info" && argc == 3)
+		nResult = Info(argv[2]);
+
+	if (nResult < 0) {
+		fprintf(stderr, "Usage: %s write FILE [--add FILE]...\n"
+			"       %s info FILE\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	return nResult;
+}
@@ -0,0 +1,159 @@
+/**
+ * N-tuple network trainer
+ *
+ * Plays games against itself and learns the weights of a cNTuple
+ * network by temporal difference. All threads update the same weights
+ * without locking. A checkpoint is written every --checkpoint games and
+ * at the end, and --resume continues from an earlier checkpoint. The
+ * checkpoint knows how many games it was trained with, so a resumed run
+ * plays --games new games after those instead of the same ones again.
+ *
+ * Usage: train2048 [--games N] [--threads N] [--seed N] [--rate R]
+ *                  [--out FILE] [--resume FILE] [--checkpoint N]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "cNTuple.h"
+#include "cRandom.h"
+
+struct sOptions {
+	long long nGames = 100000;
+	int nThreads = 0;
+	uint64_t nSeed = 1;
+	float fLearningRate = 0.1f;
+	string sOutFile = "ntuple.weights";
+	string sResumeFile;
+	long long nCheckpointGames = 10000;
+	long long nFirstGame = 0;	// games of the resumed checkpoint
+};
+
+struct sProgress {
+	atomic<long long> nGames{ 0 };
+	atomic<long long> nScore{ 0 };
+	atomic<long long> nReached2048{ 0 };
+};
+
+static void TrainThread(const sOptions& options, cNTuple& network, atomic<long long>& nNextGame, sProgress& progress)
+{
+	for (long long nGame = nNextGame++; nGame < options.nFirstGame + options.nGames; nGame = nNextGame++) {
+		uint64_t nState = options.nSeed ^ ((uint64_t)nGame * 0xD1B54A32D192ED03ULL);
+		cRandom rng(cRandom::SplitMix64(nState));
+
+		int nMaxExponent = 0;
+		int nScore = network.TrainGame(rng, options.fLearningRate, nMaxExponent);
+
+		progress.nScore += nScore;
+		if (nMaxExponent >= 11)
+			progress.nReached2048++;
+		progress.nGames++;
+	}
+}
+
+static bool ParseOptions(int argc, char* argv[], sOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		string sArg = argv[i];
+		const char* sValue = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (sValue == nullptr)
+			return false;
+
+		if (sArg == "--games")
+			options.nGames = atoll(sValue);
+		else if (sArg == "--threads")
+			options.nThreads = atoi(sValue);
+		else if (sArg == "--seed")
+			options.nSeed = strtoull(sValue, nullptr, 10);
+		else if (sArg == "--rate")
+			options.fLearningRate = (float)atof(sValue);
+		else if (sArg == "--out")
+			options.sOutFile = sValue;
+		else if (sArg == "--resume")
+			options.sResumeFile = sValue;
+		else if (sArg == "--checkpoint")
+			options.nCheckpointGames = atoll(sValue);
+		else
+			return false;
+
+		i++;
+	}
+
+	if (options.nThreads <= 0)
+		options.nThreads = max(1, (int)thread::hardware_concurrency());
+
+	return options.nGames > 0 && options.fLearningRate > 0.0f;
+}
+
+int main(int argc, char* argv[])
+{
+	sOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		fprintf(stderr, "Usage: %s [--games N] [--threads N] [--seed N] [--rate R]\n"
+			"       [--out FILE] [--resume FILE] [--checkpoint N]\n", argv[0]);
+		return 1;
+	}
+
+	cBoard::InitTables();
+
+	cNTuple network;
+	if (options.sResumeFile.empty())
+		network.Clear();
+	else if (!network.Load(options.sResumeFile.c_str(), true)) {
+		fprintf(stderr, "Could not load %s\n", options.sResumeFile.c_str());
+		return 1;
+	}
+	options.nFirstGame = network.GetTrainedGames();
+
+	sProgress progress;
+	atomic<long long> nNextGame(options.nFirstGame);
+	vector<thread> aThreads;
+
+	auto tp1 = chrono::steady_clock::now();
+
+	for (int i = 0; i < options.nThreads; i++)
+		aThreads.push_back(thread(TrainThread, cref(options), ref(network), ref(nNextGame), ref(progress)));
+
+	// Report and write checkpoints while the workers are busy
+	long long nNextCheckpoint = options.nCheckpointGames > 0 ? options.nCheckpointGames : options.nGames;
+	long long nLastGames = 0, nLastScore = 0, nLastReached = 0;
+
+	while (nLastGames < options.nGames) {
+		this_thread::sleep_for(chrono::milliseconds(100));
+
+		long long nGames = progress.nGames;
+		if (nGames < nNextCheckpoint && nGames < options.nGames)
+			continue;
+
+		long long nScore = progress.nScore;
+		long long nReached = progress.nReached2048;
+		double fSeconds = chrono::duration<double>(chrono::steady_clock::now() - tp1).count();
+
+		printf("games %10lld  avg score %9.1f  2048 %6.2f %%  %7.0f games/sec\n", options.nFirstGame + nGames,
+			(double)(nScore - nLastScore) / max(1LL, nGames - nLastGames),
+			100.0 * (nReached - nLastReached) / max(1LL, nGames - nLastGames), nGames / fSeconds);
+		fflush(stdout);
+
+		network.SetTrainedGames(options.nFirstGame + nGames);
+		if (!network.Save(options.sOutFile.c_str()))
+			fprintf(stderr, "Could not write %s\n", options.sOutFile.c_str());
+
+		nLastGames = nGames;
+		nLastScore = nScore;
+		nLastReached = nReached;
+		while (nNextCheckpoint <= nGames)
+			nNextCheckpoint += max(1LL, options.nCheckpointGames);
+	}
+
+	for (thread& t : aThreads)
+		t.join();
+
+	return 0;
+}
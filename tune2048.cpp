@@ -0,0 +1,437 @@
+/**
+ * Heuristic weight tuner
+ *
+ * Tunes the weights of the expectimax heuristic with a separable CMA-ES
+ * (evolution strategy with a diagonal covariance). Every generation
+ * samples --population weight vectors around the current mean and lets
+ * each of them, and the mean itself, play the same --games seeded games
+ * on all threads. Common random numbers: all candidates of a generation
+ * see the same tiles as long as they play the same moves, so their
+ * scores differ by their weights and much less by luck.
+ *
+ * The weights are tuned as factors of the default weights, on a log
+ * scale. After every generation the state goes to --checkpoint, which
+ * --resume continues, and the best mean so far goes to --out in the
+ * format of cHeuristic::SaveWeights, for `sim2048 --heuristic` and the
+ * game's --heuristic.
+ *
+ * Usage: tune2048 [--generations N] [--population N] [--games N]
+ *                 [--depth N] [--max-moves N] [--threads N] [--seed N]
+ *                 [--sigma S] [--tt-mb N] [--out FILE]
+ *                 [--checkpoint FILE] [--resume FILE]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "cExpectimax.h"
+#include "cGame.h"
+#include "cHeuristic.h"
+#include "cRandom.h"
+#include "cTranspositionTable.h"
+
+// Every weight of sHeuristicWeights is tuned
+static float sHeuristicWeights::* const s_aWeights[] = {
+	&sHeuristicWeights::fLostPenalty,
+	&sHeuristicWeights::fMonotonicityPower,
+	&sHeuristicWeights::fMonotonicityWeight,
+	&sHeuristicWeights::fSumPower,
+	&sHeuristicWeights::fSumWeight,
+	&sHeuristicWeights::fMergesWeight,
+	&sHeuristicWeights::fEmptyWeight,
+};
+
+static const int DIMENSIONS = sizeof(s_aWeights) / sizeof(s_aWeights[0]);
+
+struct sOptions {
+	int nGenerations = 30;
+	int nPopulation = 12;
+	int nGames = 100;
+	int nDepth = 2;
+	int nMaxMoves = 5000;
+	int nThreads = 0;
+	uint64_t nSeed = 1;
+	double fSigma = 0.3;
+	int nTableSizeMB = 4;
+	string sOutFile = "heuristic.weights";
+	string sCheckpointFile = "tune2048.checkpoint";
+	string sResumeFile;
+};
+
+/**
+ * Everything the search needs to continue, as written to the checkpoint
+ */
+struct sState {
+	int nGeneration = 0;
+	double fSigma = 0.3;
+	double aMean[DIMENSIONS] = {};
+	double aVariance[DIMENSIONS] = {};	// diagonal of the covariance
+	double aPathSigma[DIMENSIONS] = {};
+	double aPathC[DIMENSIONS] = {};
+	double fBestFitness = -1.0;
+	double aBest[DIMENSIONS] = {};
+};
+
+/**
+ * Constants of the strategy, from the population size
+ */
+struct sStrategy {
+	int nLambda;
+	int nMu;
+	vector<double> aRecombination;
+	double fMuEff;
+	double fCSigma;
+	double fDSigma;
+	double fCC;
+	double fC1;
+	double fCMu;
+	double fChiN;
+
+	sStrategy(int nPopulation);
+};
+
+sStrategy::sStrategy(int nPopulation)
+{
+	double n = DIMENSIONS;
+
+	nLambda = nPopulation;
+	nMu = nLambda / 2;
+
+	double fSum = 0.0, fSumSquares = 0.0;
+	for (int i = 0; i < nMu; i++) {
+		aRecombination.push_back(log(nMu + 0.5) - log(i + 1.0));
+		fSum += aRecombination[i];
+	}
+	for (double& w : aRecombination) {
+		w /= fSum;
+		fSumSquares += w * w;
+	}
+	fMuEff = 1.0 / fSumSquares;
+
+	fCSigma = (fMuEff + 2.0) / (n + fMuEff + 5.0);
+	fDSigma = 1.0 + 2.0 * max(0.0, sqrt((fMuEff - 1.0) / (n + 1.0)) - 1.0) + fCSigma;
+	fCC = (4.0 + fMuEff / n) / (n + 4.0 + 2.0 * fMuEff / n);
+
+	// A diagonal covariance has only n parameters to learn, so it can
+	// learn (n + 2) / 3 times faster than a full one
+	double fSeparable = (n + 2.0) / 3.0;
+	fC1 = min(1.0, fSeparable * 2.0 / ((n + 1.3) * (n + 1.3) + fMuEff));
+	fCMu = min(1.0 - fC1, fSeparable * 2.0 * (fMuEff - 2.0 + 1.0 / fMuEff) / ((n + 2.0) * (n + 2.0) + fMuEff));
+	fChiN = sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+}
+
+static sHeuristicWeights GetWeights(const double aX[DIMENSIONS])
+{
+	sHeuristicWeights defaults;
+	sHeuristicWeights weights;
+
+	for (int i = 0; i < DIMENSIONS; i++)
+		weights.*s_aWeights[i] = defaults.*s_aWeights[i] * (float)exp(aX[i]);
+
+	return weights;
+}
+
+/**
+ * Standard normal numbers by Box-Muller, the same on every platform
+ * unlike normal_distribution
+ */
+static double NextGaussian(cRandom& rng)
+{
+	double u1 = ((rng.Next() >> 11) + 1.0) / 9007199254740993.0;
+	double u2 = (rng.Next() >> 11) / 9007199254740992.0;
+	return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+static uint64_t Mix(uint64_t nSeed, uint64_t nA, uint64_t nB)
+{
+	uint64_t nState = nSeed ^ (nA * 0xD1B54A32D192ED03ULL) ^ (nB * 0x9E3779B97F4A7C15ULL);
+	return cRandom::SplitMix64(nState);
+}
+
+/**
+ * Plays every game of every candidate. A task is one game, the threads
+ * take the next one until all are done.
+ */
+static void PlayThread(const sOptions& options, int nGeneration, const vector<unique_ptr<cHeuristic>>& aHeuristics,
+	atomic<int>& nNextTask, vector<atomic<long long>>& aScores)
+{
+	cTranspositionTable table(options.nTableSizeMB);
+	cExpectimax search(options.nDepth, 0.0001f, &table);
+	cGame game;
+
+	int nTasks = (int)aHeuristics.size() * options.nGames;
+	for (int nTask = nNextTask++; nTask < nTasks; nTask = nNextTask++) {
+		int nCandidate = nTask / options.nGames;
+		int nGame = nTask % options.nGames;
+
+		// The values in the table belong to the weights which stored them
+		table.Clear();
+		search.SetHeuristic(aHeuristics[nCandidate].get());
+		game.Reset(Mix(options.nSeed, (uint64_t)nGeneration, (uint64_t)nGame));
+
+		ROTATION nMove;
+		while (game.GetMoveCount() < options.nMaxMoves && search.ChooseMove(game.GetBoard(), nMove))
+			game.Move(nMove);
+
+		aScores[nCandidate] += game.GetScore();
+	}
+}
+
+static bool SaveState(const char* sFileName, const sState& state)
+{
+	FILE* pFile = fopen(sFileName, "w");
+	if (pFile == nullptr)
+		return false;
+
+	auto WriteVector = [&](const char* sName, const double aValues[DIMENSIONS]) {
+		fprintf(pFile, "%s", sName);
+		for (int i = 0; i < DIMENSIONS; i++)
+			fprintf(pFile, " %.17g", aValues[i]);
+		fprintf(pFile, "\n");
+	};
+
+	fprintf(pFile, "tune2048 %d\n", DIMENSIONS);
+	fprintf(pFile, "generation %d\n", state.nGeneration);
+	fprintf(pFile, "sigma %.17g\n", state.fSigma);
+	WriteVector("mean", state.aMean);
+	WriteVector("variance", state.aVariance);
+	WriteVector("path_sigma", state.aPathSigma);
+	WriteVector("path_c", state.aPathC);
+	fprintf(pFile, "best_fitness %.17g\n", state.fBestFitness);
+	WriteVector("best", state.aBest);
+
+	return fclose(pFile) == 0;
+}
+
+static bool LoadState(const char* sFileName, sState& state)
+{
+	FILE* pFile = fopen(sFileName, "r");
+	if (pFile == nullptr)
+		return false;
+
+	auto ReadVector = [&](const char* sName, double aValues[DIMENSIONS]) {
+		char sRead[32];
+		if (fscanf(pFile, "%31s", sRead) != 1 || strcmp(sRead, sName) != 0)
+			return false;
+		for (int i = 0; i < DIMENSIONS; i++) {
+			if (fscanf(pFile, "%lf", &aValues[i]) != 1)
+				return false;
+		}
+		return true;
+	};
+
+	int nDimensions = 0;
+	bool bOk = fscanf(pFile, "tune2048 %d generation %d sigma %lf", &nDimensions, &state.nGeneration, &state.fSigma) == 3
+		&& nDimensions == DIMENSIONS
+		&& ReadVector("mean", state.aMean) && ReadVector("variance", state.aVariance)
+		&& ReadVector("path_sigma", state.aPathSigma) && ReadVector("path_c", state.aPathC)
+		&& fscanf(pFile, " best_fitness %lf", &state.fBestFitness) == 1
+		&& ReadVector("best", state.aBest);
+
+	fclose(pFile);
+	return bOk;
+}
+
+/**
+ * Samples, plays and updates the distribution once
+ */
+static void RunGeneration(const sOptions& options, const sStrategy& strategy, sState& state)
+{
+	int n = DIMENSIONS;
+	int nLambda = strategy.nLambda;
+
+	// Steps y of the candidates, x = mean + sigma * y. The random numbers
+	// only depend on the generation, so a resumed run samples the same.
+	cRandom rng(Mix(options.nSeed ^ 0x5A5A5A5A5A5A5A5AULL, (uint64_t)state.nGeneration, 0));
+	vector<vector<double>> aSteps(nLambda, vector<double>(n));
+	vector<unique_ptr<cHeuristic>> aHeuristics;
+
+	for (int k = 0; k < nLambda; k++) {
+		double aX[DIMENSIONS];
+		for (int i = 0; i < n; i++) {
+			aSteps[k][i] = sqrt(state.aVariance[i]) * NextGaussian(rng);
+			aX[i] = state.aMean[i] + state.fSigma * aSteps[k][i];
+		}
+		aHeuristics.push_back(unique_ptr<cHeuristic>(new cHeuristic(GetWeights(aX))));
+	}
+
+	// The mean plays the same games, so it is measured as fair as the rest
+	aHeuristics.push_back(unique_ptr<cHeuristic>(new cHeuristic(GetWeights(state.aMean))));
+
+	vector<atomic<long long>> aScores(aHeuristics.size());
+	for (atomic<long long>& nScore : aScores)
+		nScore = 0;
+
+	atomic<int> nNextTask(0);
+	vector<thread> aThreads;
+	for (int i = 0; i < options.nThreads; i++)
+		aThreads.push_back(thread(PlayThread, cref(options), state.nGeneration, cref(aHeuristics), ref(nNextTask), ref(aScores)));
+	for (thread& t : aThreads)
+		t.join();
+
+	vector<double> aFitness;
+	for (atomic<long long>& nScore : aScores)
+		aFitness.push_back((double)nScore / options.nGames);
+
+	double fMeanFitness = aFitness[nLambda];
+	if (fMeanFitness > state.fBestFitness) {
+		state.fBestFitness = fMeanFitness;
+		copy(state.aMean, state.aMean + n, state.aBest);
+	}
+
+	vector<int> aOrder(nLambda);
+	for (int k = 0; k < nLambda; k++)
+		aOrder[k] = k;
+	stable_sort(aOrder.begin(), aOrder.end(), [&](int a, int b) { return aFitness[a] > aFitness[b]; });
+
+	printf("gen %4d  sigma %.4f  mean %9.1f  best %9.1f  worst %9.1f\n", state.nGeneration, state.fSigma,
+		fMeanFitness, aFitness[aOrder[0]], aFitness[aOrder[nLambda - 1]]);
+
+	// Weighted mean step of the best half
+	vector<double> aStepW(n, 0.0);
+	for (int j = 0; j < strategy.nMu; j++) {
+		for (int i = 0; i < n; i++)
+			aStepW[i] += strategy.aRecombination[j] * aSteps[aOrder[j]][i];
+	}
+
+	double fNormSigma = 0.0;
+	for (int i = 0; i < n; i++) {
+		state.aMean[i] += state.fSigma * aStepW[i];
+		state.aPathSigma[i] = (1.0 - strategy.fCSigma) * state.aPathSigma[i]
+			+ sqrt(strategy.fCSigma * (2.0 - strategy.fCSigma) * strategy.fMuEff) * aStepW[i] / sqrt(state.aVariance[i]);
+		fNormSigma += state.aPathSigma[i] * state.aPathSigma[i];
+	}
+	fNormSigma = sqrt(fNormSigma);
+
+	// The covariance path stalls while the step size path is too long
+	double fDecay = 1.0 - pow(1.0 - strategy.fCSigma, 2.0 * (state.nGeneration + 1));
+	bool bStall = fNormSigma / sqrt(fDecay) >= (1.4 + 2.0 / (n + 1.0)) * strategy.fChiN;
+	double fH = bStall ? 0.0 : 1.0;
+
+	for (int i = 0; i < n; i++) {
+		state.aPathC[i] = (1.0 - strategy.fCC) * state.aPathC[i]
+			+ fH * sqrt(strategy.fCC * (2.0 - strategy.fCC) * strategy.fMuEff) * aStepW[i];
+
+		double fRankMu = 0.0;
+		for (int j = 0; j < strategy.nMu; j++) {
+			double y = aSteps[aOrder[j]][i];
+			fRankMu += strategy.aRecombination[j] * y * y;
+		}
+
+		double fRankOne = state.aPathC[i] * state.aPathC[i] + (1.0 - fH) * strategy.fCC * (2.0 - strategy.fCC) * state.aVariance[i];
+		state.aVariance[i] = (1.0 - strategy.fC1 - strategy.fCMu) * state.aVariance[i] + strategy.fC1 * fRankOne + strategy.fCMu * fRankMu;
+	}
+
+	state.fSigma *= exp((strategy.fCSigma / strategy.fDSigma) * (fNormSigma / strategy.fChiN - 1.0));
+	state.nGeneration++;
+}
+
+static bool ParseOptions(int argc, char* argv[], sOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		string sArg = argv[i];
+		const char* sValue = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (sValue == nullptr)
+			return false;
+
+		if (sArg == "--generations")
+			options.nGenerations = atoi(sValue);
+		else if (sArg == "--population")
+			options.nPopulation = atoi(sValue);
+		else if (sArg == "--games")
+			options.nGames = atoi(sValue);
+		else if (sArg == "--depth")
+			options.nDepth = atoi(sValue);
+		else if (sArg == "--max-moves")
+			options.nMaxMoves = atoi(sValue);
+		else if (sArg == "--threads")
+			options.nThreads = atoi(sValue);
+		else if (sArg == "--seed")
+			options.nSeed = strtoull(sValue, nullptr, 10);
+		else if (sArg == "--sigma")
+			options.fSigma = atof(sValue);
+		else if (sArg == "--tt-mb")
+			options.nTableSizeMB = atoi(sValue);
+		else if (sArg == "--out")
+			options.sOutFile = sValue;
+		else if (sArg == "--checkpoint")
+			options.sCheckpointFile = sValue;
+		else if (sArg == "--resume")
+			options.sResumeFile = sValue;
+		else
+			return false;
+
+		i++;
+	}
+
+	if (options.nThreads <= 0)
+		options.nThreads = max(1, (int)thread::hardware_concurrency());
+
+	return options.nGenerations > 0 && options.nPopulation >= 4 && options.nGames > 0 && options.nDepth > 0
+		&& options.nMaxMoves > 0 && options.fSigma > 0.0;
+}
+
+int main(int argc, char* argv[])
+{
+	sOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		fprintf(stderr, "Usage: %s [--generations N] [--population N] [--games N]\n"
+			"       [--depth N] [--max-moves N] [--threads N] [--seed N]\n"
+			"       [--sigma S] [--tt-mb N] [--out FILE]\n"
+			"       [--checkpoint FILE] [--resume FILE]\n", argv[0]);
+		return 1;
+	}
+
+	cBoard::InitTables();
+
+	sState state;
+	if (!options.sResumeFile.empty()) {
+		if (!LoadState(options.sResumeFile.c_str(), state)) {
+			fprintf(stderr, "Could not load %s\n", options.sResumeFile.c_str());
+			return 1;
+		}
+	}
+	else {
+		// The defaults, with the same spread in every direction
+		state.fSigma = options.fSigma;
+		for (int i = 0; i < DIMENSIONS; i++)
+			state.aVariance[i] = 1.0;
+	}
+
+	sStrategy strategy(options.nPopulation);
+	printf("%d weights, population %d, %d games each, depth %d, %d threads\n", DIMENSIONS, strategy.nLambda,
+		options.nGames, options.nDepth, options.nThreads);
+
+	auto tp1 = chrono::steady_clock::now();
+	long long nGames = 0;
+
+	while (state.nGeneration < options.nGenerations) {
+		RunGeneration(options, strategy, state);
+		nGames += (long long)(strategy.nLambda + 1) * options.nGames;
+		fflush(stdout);
+
+		if (!SaveState(options.sCheckpointFile.c_str(), state))
+			fprintf(stderr, "Could not write %s\n", options.sCheckpointFile.c_str());
+
+		cHeuristic best(GetWeights(state.aBest));
+		if (!best.SaveWeights(options.sOutFile.c_str()))
+			fprintf(stderr, "Could not write %s\n", options.sOutFile.c_str());
+	}
+
+	double fSeconds = chrono::duration<double>(chrono::steady_clock::now() - tp1).count();
+	printf("\n%lld games in %.1f s (%.1f games/sec), best mean %.1f, written to %s\n", nGames, fSeconds,
+		nGames / max(fSeconds, 1e-9), state.fBestFitness, options.sOutFile.c_str());
+
+	return 0;
+}